@@ -0,0 +1,91 @@
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/internet-apps-module.h"
+#include <chrono>
+#include <iostream>
+#include <cstring>
+
+using namespace ns3;
+
+static Ptr<Socket> g_sock;
+static uint32_t g_rx = 0;
+static uint32_t g_clients = 0;
+
+static void
+SendDiscover (uint32_t i)
+{
+  DhcpHeader h;
+  h.ResetOpt ();
+  h.SetTran (i);
+  h.SetType (DhcpHeader::DHCPDISCOVER);
+  h.SetTime ();
+  uint8_t chaddr[16];
+  std::memset (chaddr, 0, 16);
+  chaddr[0] = 0x02;
+  uint32_t c = g_clients ? i % g_clients : i;
+  std::memcpy (chaddr + 2, &c, 4);
+  h.SetChaddr (chaddr, 16);
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader (h);
+  g_sock->SendTo (p, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), 67));
+}
+
+static void
+Recv (Ptr<Socket> s)
+{
+  Address from;
+  while (s->RecvFrom (from))
+    {
+      g_rx++;
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t n = 100000;
+  double simTime = 86400;
+  double lease = 3600;
+  CommandLine cmd;
+  cmd.AddValue ("n", "leases", n);
+  cmd.AddValue ("simTime", "seconds", simTime);
+  cmd.AddValue ("lease", "lease seconds", lease);
+  uint32_t pool = 0;
+  cmd.AddValue ("pool", "pool size (0: n + 10)", pool);
+  cmd.AddValue ("clients", "distinct clients (0: n)", g_clients);
+  cmd.Parse (argc, argv);
+
+  NodeContainer nodes;
+  nodes.Create (2);
+  SimpleNetDeviceHelper sndh;
+  NetDeviceContainer devs = sndh.Install (nodes);
+  InternetStackHelper stack;
+  stack.Install (nodes);
+
+  DhcpHelper dhcp;
+  dhcp.SetServerAttribute ("LeaseTime", TimeValue (Seconds (lease)));
+  ApplicationContainer server = dhcp.InstallDhcpServer (devs.Get (0), Ipv4Address ("10.0.0.1"), Ipv4Mask ("/8"));
+  dhcp.AddAddressPool (&server, Ipv4Address ("10.0.0.0"), Ipv4Mask ("/8"), Ipv4Address ("10.0.0.1"),
+                       Ipv4Address (Ipv4Address ("10.0.0.1").Get () + (pool ? pool : n + 10)));
+  dhcp.InstallFixedAddress (devs.Get (1), Ipv4Address ("10.250.0.1"), Ipv4Mask ("/8"));
+  server.Start (Seconds (0));
+
+  g_sock = Socket::CreateSocket (nodes.Get (1), UdpSocketFactory::GetTypeId ());
+  g_sock->SetAllowBroadcast (true);
+  g_sock->Bind (InetSocketAddress (Ipv4Address::GetAny (), 68));
+  g_sock->BindToNetDevice (devs.Get (1));
+  g_sock->SetRecvCallback (MakeCallback (&Recv));
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Simulator::Schedule (MicroSeconds (1000 + i * 500), &SendDiscover, i);
+    }
+  Simulator::Stop (Seconds (simTime));
+  auto t0 = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  auto t1 = std::chrono::steady_clock::now ();
+  std::cout << "leases=" << n << " simTime=" << simTime << " offers=" << g_rx
+            << " wall=" << std::chrono::duration<double> (t1 - t0).count () << "s" << std::endl;
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,145 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Wall clock time of a DHCP server handing out many leases.
+ *
+ * A node sends one DISCOVER every 500 us, each from a new client, to a
+ * server whose pool holds an address for every client. The server offers
+ * the addresses and keeps their leases until the end of the simulation.
+ * With nClients set, the DISCOVERs come in turn from this number of
+ * clients, which come back after their lease has expired.
+ * The program prints the number of offers received and the wall clock
+ * time of the simulation.
+ *
+ * 100k leases of 1 hour over a simulated day:
+ *
+ *   ./waf --run "dhcp-lease-benchmark --nLeases=100000 --leaseTime=3600 --simTime=86400"
+ *
+ * 100k DISCOVERs from 50k returning clients, with leases of 5 s:
+ *
+ *   ./waf --run "dhcp-lease-benchmark --nLeases=100000 --nClients=50000 --leaseTime=5 --simTime=60"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/internet-apps-module.h"
+#include <cstring>
+#include <iostream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("DhcpLeaseBenchmark");
+
+static Ptr<Socket> g_socket;    //!< Socket of the clients
+static uint32_t g_nOffers = 0;  //!< Number of offers received
+static uint32_t g_nClients = 0; //!< Number of clients, 0 for one per DISCOVER
+
+/**
+ * \brief Send a DISCOVER
+ * \param discover The index of the DISCOVER
+ */
+static void
+SendDiscover (uint32_t discover)
+{
+  uint32_t client = (g_nClients != 0) ? discover % g_nClients : discover;
+  uint8_t chaddr[16];
+  std::memset (chaddr, 0, 16);
+  chaddr[0] = 0x02;
+  std::memcpy (chaddr + 2, &client, 4);
+
+  DhcpHeader header;
+  header.ResetOpt ();
+  header.SetType (DhcpHeader::DHCPDISCOVER);
+  header.SetTran (discover);
+  header.SetTime ();
+  header.SetChaddr (chaddr, 16);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (header);
+  g_socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), 67));
+}
+
+/**
+ * \brief Count the replies of the server
+ * \param socket The socket of the clients
+ */
+static void
+ReceiveOffer (Ptr<Socket> socket)
+{
+  Address from;
+  while (socket->RecvFrom (from))
+    {
+      g_nOffers++;
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nLeases = 100000;
+  double leaseTime = 3600;
+  double simTime = 86400;
+
+  CommandLine cmd;
+  cmd.AddValue ("nLeases", "Number of DISCOVERs sent", nLeases);
+  cmd.AddValue ("nClients", "Number of clients sending the DISCOVERs in turn, 0 for one per DISCOVER", g_nClients);
+  cmd.AddValue ("leaseTime", "LeaseTime of the server (s)", leaseTime);
+  cmd.AddValue ("simTime", "Simulated time (s)", simTime);
+  cmd.Parse (argc, argv);
+
+  NodeContainer nodes;
+  nodes.Create (2);
+  SimpleNetDeviceHelper simpleNetDevice;
+  NetDeviceContainer devNet = simpleNetDevice.Install (nodes);
+  InternetStackHelper tcpip;
+  tcpip.Install (nodes);
+
+  DhcpHelper dhcpHelper;
+  dhcpHelper.SetServerAttribute ("LeaseTime", TimeValue (Seconds (leaseTime)));
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("10.0.0.1"),
+                                                                     Ipv4Mask ("/8"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("10.0.0.0"), Ipv4Mask ("/8"), Ipv4Address ("10.0.0.1"),
+                             Ipv4Address (Ipv4Address ("10.0.0.1").Get () + nLeases + 10));
+  dhcpHelper.InstallFixedAddress (devNet.Get (1), Ipv4Address ("10.250.0.1"), Ipv4Mask ("/8"));
+  dhcpServerApp.Start (Seconds (0.0));
+
+  g_socket = Socket::CreateSocket (nodes.Get (1), UdpSocketFactory::GetTypeId ());
+  g_socket->SetAllowBroadcast (true);
+  g_socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), 68));
+  g_socket->BindToNetDevice (devNet.Get (1));
+  g_socket->SetRecvCallback (MakeCallback (&ReceiveOffer));
+  for (uint32_t i = 0; i < nLeases; i++)
+    {
+      Simulator::Schedule (MicroSeconds (1000 + i * 500), &SendDiscover, i);
+    }
+
+  Simulator::Stop (Seconds (simTime));
+  SystemWallClockMs clock;
+  clock.Start ();
+  Simulator::Run ();
+  int64_t wallTime = clock.End ();
+
+  std::cout << "leases " << nLeases << ", simulated time " << simTime << " s, offers " << g_nOffers
+            << ", wall clock time " << wallTime / 1000.0 << " s" << std::endl;
+
+  g_socket = 0;
+  Simulator::Destroy ();
+  return 0;
+}
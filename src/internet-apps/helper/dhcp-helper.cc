@@ -26,6 +26,7 @@
 #include "ns3/dhcp-server.h"
 #include "ns3/dhcp-client.h"
 #include "ns3/dhcp-relay.h"
+#include "ns3/dhcp-load-generator.h"
 #include "ns3/uinteger.h"
 #include "ns3/names.h"
 #include "ns3/ipv4.h"
@@ -43,6 +44,7 @@ DhcpHelper::DhcpHelper ()
   m_clientFactory.SetTypeId (DhcpClient::GetTypeId ());  
   m_serverFactory.SetTypeId (DhcpServer::GetTypeId ()); 
   m_relayFactory.SetTypeId (DhcpRelay::GetTypeId ());   
+  m_loadGeneratorFactory.SetTypeId (DhcpLoadGenerator::GetTypeId ());
 }
 
 void DhcpHelper::SetClientAttribute (
@@ -81,7 +83,37 @@ ApplicationContainer DhcpHelper::InstallDhcpClient (NetDeviceContainer netDevice
   return apps;
 }
 
+void DhcpHelper::SetLoadGeneratorAttribute (
+  std::string name,
+  const AttributeValue &value)
+{
+  m_loadGeneratorFactory.Set (name, value);
+}
+
+ApplicationContainer DhcpHelper::InstallDhcpLoadGenerator (Ptr<NetDevice> netDevice, uint32_t nClients) const
+{
+  SetUpClientInterface (netDevice);
+
+  Ptr<DhcpLoadGenerator> app = m_loadGeneratorFactory.Create<DhcpLoadGenerator> ();
+  app->SetAttribute ("Clients", UintegerValue (nClients));
+  app->SetDhcpClientNetDevice (netDevice);
+  netDevice->GetNode ()->AddApplication (app);
+
+  return ApplicationContainer (app);
+}
+
 Ptr<Application> DhcpHelper::InstallDhcpClientPriv (Ptr<NetDevice> netDevice) const
+{
+  SetUpClientInterface (netDevice);
+
+  Ptr<DhcpClient> app = DynamicCast <DhcpClient> (m_clientFactory.Create<DhcpClient> ()); 
+  app->SetDhcpClientNetDevice (netDevice);  
+  netDevice->GetNode ()->AddApplication (app);   
+
+  return app;
+}
+
+void DhcpHelper::SetUpClientInterface (Ptr<NetDevice> netDevice) const
 {
   Ptr<Node> node = netDevice->GetNode ();
   NS_ASSERT_MSG (node != 0, "DhcpClientHelper: NetDevice is not not associated with any node -> fail");
@@ -111,12 +143,6 @@ Ptr<Application> DhcpHelper::InstallDhcpClientPriv (Ptr<NetDevice> netDevice) co
       TrafficControlHelper tcHelper = TrafficControlHelper::Default ();  
       tcHelper.Install (netDevice);   
     }
-
-  Ptr<DhcpClient> app = DynamicCast <DhcpClient> (m_clientFactory.Create<DhcpClient> ()); 
-  app->SetDhcpClientNetDevice (netDevice);  
-  node->AddApplication (app);   
-
-  return app;
 }
 
 ApplicationContainer DhcpHelper::InstallDhcpServer (Ptr<NetDevice> netDevice, Ipv4Address serverAddr,Ipv4Mask netMask,
@@ -234,7 +260,6 @@ ApplicationContainer DhcpHelper::InstallDhcpRelay (Ptr<NetDevice> netDevice, Ipv
                                                    Ipv4Mask subMask, Ipv4Address dhcps)
 {
   m_relayFactory.Set ("ServerSideAddress", Ipv4AddressValue (serverSideAddress));
-  m_relayFactory.Set ("SubnetMask", Ipv4MaskValue (subMask)); 
   m_relayFactory.Set ("DhcpServerAddress", Ipv4AddressValue (dhcps));
   
   Ptr<Node> node = netDevice->GetNode ();
@@ -277,4 +302,10 @@ void DhcpHelper::AddRelayInterface (ApplicationContainer * dhcpRelayApp, Ptr<Net
   Ipv4InterfaceContainer relayClient = InstallFixedAddress (netDevice, addr, mask);
 }
 
+void DhcpHelper::AddRelayServer (ApplicationContainer * dhcpRelayApp, Ipv4Address addr)
+{
+  Ptr<DhcpRelay> app = DynamicCast <DhcpRelay> (dhcpRelayApp->Get (0));
+  app->AddDhcpServer (addr);
+}
+
 } // namespace ns3
@@ -66,6 +66,13 @@ public:
    */
   void SetRelayAttribute (std::string name,const AttributeValue &value);
 
+  /**
+   * \brief Set DHCP load generator attributes
+   * \param name Name of the attribute
+   * \param value Value to be set
+   */
+  void SetLoadGeneratorAttribute (std::string name, const AttributeValue &value);
+
   /**
    * \brief Install DHCP client of a nodes / NetDevice
    * \param netDevice The NetDevice that the DHCP client will use
@@ -80,6 +87,14 @@ public:
    */
   ApplicationContainer InstallDhcpClient (NetDeviceContainer netDevices) const;
 
+  /**
+   * \brief Install a DHCP load generator, emulating many clients, on a node / NetDevice
+   * \param netDevice The NetDevice that the emulated clients will use
+   * \param nClients The number of clients emulated
+   * \return The application container with the DHCP load generator installed
+   */
+  ApplicationContainer InstallDhcpLoadGenerator (Ptr<NetDevice> netDevice, uint32_t nClients) const;
+
   /**
    * \brief Install DHCP server of a node / NetDevice
    *
@@ -132,6 +147,13 @@ public:
    */
    void AddRelayInterface (ApplicationContainer * dhcpRelayApp, Ptr<NetDevice> netDevice, Ipv4Address addr, Ipv4Mask mask);
 
+   /**
+   * \brief Add an upstream DHCP server to the DHCP relay, besides the one given at install time
+   * \param dhcpRelayApp Pointer to the DHCP relay application
+   * \param addr Ipv4Address of the DHCP server
+   */
+   void AddRelayServer (ApplicationContainer * dhcpRelayApp, Ipv4Address addr);
+
 private:
   /**
    * \brief Function to install DHCP client on a node
@@ -140,12 +162,19 @@ private:
    */
   Ptr<Application> InstallDhcpClientPriv (Ptr<NetDevice> netDevice) const;
 
+  /**
+   * \brief Prepare the interface of a NetDevice for DHCP clients
+   * \param netDevice The NetDevice the DHCP clients will use
+   */
+  void SetUpClientInterface (Ptr<NetDevice> netDevice) const;
+
   /// Address pool container - pool address / pool mask + min address / max address
   typedef std::list < std::pair < std::pair <Ipv4Address,Ipv4Mask> , std::pair <Ipv4Address,Ipv4Address> > > AddressPool; 
 
   ObjectFactory m_clientFactory;                 //!< DHCP client factory
   ObjectFactory m_serverFactory;                 //!< DHCP server factory
   ObjectFactory m_relayFactory;                  //!< DHCP relay factory
+  ObjectFactory m_loadGeneratorFactory;          //!< DHCP load generator factory
   std::list<Ipv4Address> m_fixedAddresses;       //!< list of fixed addresses already allocated.
   AddressPool m_addressPools;                    //!< list of address pools 
 };
@@ -0,0 +1,268 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "dhcp-address-pool.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("DhcpAddressPool");
+
+/// A bitmap word with every address in use
+static const uint64_t FULL_WORD = ~static_cast<uint64_t> (0);
+
+/**
+ * \brief Find the lowest clear bit of a bitmap word
+ * \param word The word, which must not be full
+ * \return The position of the lowest clear bit
+ */
+static uint32_t
+FindFirstClear (uint64_t word)
+{
+  uint64_t clear = ~word;
+#if defined (__GNUC__)
+  return __builtin_ctzll (clear);
+#else
+  uint32_t bit = 0;
+  while ((clear & 1) == 0)
+    {
+      clear >>= 1;
+      bit++;
+    }
+  return bit;
+#endif
+}
+
+DhcpAddressPool::DhcpAddressPool (Ipv4Address poolAddr, Ipv4Mask poolMask, Ipv4Address minAddr, Ipv4Address maxAddr)
+  : m_poolAddr (poolAddr),
+    m_poolMask (poolMask),
+    m_minAddr (minAddr),
+    m_maxAddr (maxAddr)
+{
+  NS_LOG_FUNCTION (this << poolAddr << poolMask << minAddr << maxAddr);
+  NS_ASSERT_MSG (minAddr.Get () <= maxAddr.Get (), "Invalid Address range");
+
+  m_size = maxAddr.Get () - minAddr.Get () + 1;
+  NS_ASSERT_MSG (m_size != 0, "Address range too big");
+  m_available = m_size;
+
+  // Bits past the end of each level are marked as used, so that the
+  // descent in Allocate never selects them.
+  uint32_t bits = m_size;
+  do
+    {
+      uint32_t words = (bits + 63) / 64;
+      std::vector<uint64_t> level (words, 0);
+      if (bits % 64 != 0)
+        {
+          level.back () = FULL_WORD << (bits % 64);
+        }
+      m_levels.push_back (level);
+      bits = words;
+    }
+  while (bits > 1);
+}
+
+Ipv4Address
+DhcpAddressPool::GetPoolAddress (void) const
+{
+  return m_poolAddr;
+}
+
+Ipv4Mask
+DhcpAddressPool::GetPoolMask (void) const
+{
+  return m_poolMask;
+}
+
+Ipv4Address
+DhcpAddressPool::GetMinAddress (void) const
+{
+  return m_minAddr;
+}
+
+Ipv4Address
+DhcpAddressPool::GetMaxAddress (void) const
+{
+  return m_maxAddr;
+}
+
+bool
+DhcpAddressPool::IsInRange (Ipv4Address addr) const
+{
+  return addr.Get () >= m_minAddr.Get () && addr.Get () <= m_maxAddr.Get ();
+}
+
+uint32_t
+DhcpAddressPool::GetSize (void) const
+{
+  return m_size;
+}
+
+uint32_t
+DhcpAddressPool::GetNAvailable (void) const
+{
+  return m_available;
+}
+
+bool
+DhcpAddressPool::IsAvailable (Ipv4Address addr) const
+{
+  if (!IsInRange (addr))
+    {
+      return false;
+    }
+  uint32_t index = addr.Get () - m_minAddr.Get ();
+  return (m_levels[0][index / 64] & (static_cast<uint64_t> (1) << (index % 64))) == 0;
+}
+
+Ipv4Address
+DhcpAddressPool::Allocate (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_available == 0)
+    {
+      return Ipv4Address ();
+    }
+
+  uint32_t index = 0;
+  for (uint32_t level = m_levels.size (); level-- > 0; )
+    {
+      index = index * 64 + FindFirstClear (m_levels[level][index]);
+    }
+  SetUsed (index);
+
+  Ipv4Address addr = Ipv4Address (m_minAddr.Get () + index);
+  NS_LOG_LOGIC ("Allocated " << addr << ", " << m_available << " left");
+  return addr;
+}
+
+Ipv4Address
+DhcpAddressPool::Allocate (uint32_t start)
+{
+  NS_LOG_FUNCTION (this << start);
+
+  if (m_available == 0)
+    {
+      return Ipv4Address ();
+    }
+
+  uint32_t index = FindFreeFrom (start % m_size);
+  if (index == m_size)
+    {
+      index = FindFreeFrom (0);
+    }
+  SetUsed (index);
+
+  Ipv4Address addr = Ipv4Address (m_minAddr.Get () + index);
+  NS_LOG_LOGIC ("Allocated " << addr << ", " << m_available << " left");
+  return addr;
+}
+
+bool
+DhcpAddressPool::Reserve (Ipv4Address addr)
+{
+  NS_LOG_FUNCTION (this << addr);
+
+  if (!IsAvailable (addr))
+    {
+      return false;
+    }
+  SetUsed (addr.Get () - m_minAddr.Get ());
+  return true;
+}
+
+void
+DhcpAddressPool::Release (Ipv4Address addr)
+{
+  NS_LOG_FUNCTION (this << addr);
+  NS_ASSERT_MSG (IsInRange (addr) && !IsAvailable (addr),
+                 "Releasing an address that is not allocated: " << addr);
+
+  SetFree (addr.Get () - m_minAddr.Get ());
+}
+
+void
+DhcpAddressPool::SetUsed (uint32_t index)
+{
+  m_available--;
+  for (uint32_t level = 0; level < m_levels.size (); level++)
+    {
+      uint64_t &word = m_levels[level][index / 64];
+      word |= static_cast<uint64_t> (1) << (index % 64);
+      if (word != FULL_WORD)
+        {
+          break;
+        }
+      index /= 64;
+    }
+}
+
+void
+DhcpAddressPool::SetFree (uint32_t index)
+{
+  m_available++;
+  for (uint32_t level = 0; level < m_levels.size (); level++)
+    {
+      uint64_t &word = m_levels[level][index / 64];
+      bool wasFull = (word == FULL_WORD);
+      word &= ~(static_cast<uint64_t> (1) << (index % 64));
+      if (!wasFull)
+        {
+          break;
+        }
+      index /= 64;
+    }
+}
+
+uint32_t
+DhcpAddressPool::FindFreeFrom (uint32_t start) const
+{
+  // Climb while the rest of the word holding the position is full, then
+  // descend to the lowest free address below the first free bit found.
+  uint32_t index = start;
+  uint32_t level = 0;
+  for (; level < m_levels.size (); level++)
+    {
+      if (index / 64 >= m_levels[level].size ())
+        {
+          return m_size;
+        }
+      uint64_t word = m_levels[level][index / 64] | ((static_cast<uint64_t> (1) << (index % 64)) - 1);
+      if (word != FULL_WORD)
+        {
+          index = index - index % 64 + FindFirstClear (word);
+          break;
+        }
+      index = index / 64 + 1;
+    }
+  if (level == m_levels.size ())
+    {
+      return m_size;
+    }
+  while (level-- > 0)
+    {
+      index = index * 64 + FindFirstClear (m_levels[level][index]);
+    }
+  return index;
+}
+
+} // namespace ns3
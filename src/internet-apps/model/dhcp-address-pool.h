@@ -0,0 +1,163 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef DHCP_ADDRESS_POOL_H
+#define DHCP_ADDRESS_POOL_H
+
+#include "ns3/ipv4-address.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup dhcp
+ *
+ * \class DhcpAddressPool
+ * \brief Allocation state of one address pool of a DHCP server
+ *
+ * The pool keeps one bit per address of its [minAddr, maxAddr] range.
+ * On top of the bitmap, each summary level holds one bit per word of the
+ * level below, set when that word is full. Finding a free address is a
+ * descent through the levels (O(log64 n)), and creating a pool does not
+ * touch the individual addresses.
+ */
+class DhcpAddressPool
+{
+public:
+  /**
+   * \brief Constructor
+   * \param poolAddr The Ipv4Address (network part) of the address pool
+   * \param poolMask The mask of the address pool
+   * \param minAddr The lower bound of the address pool
+   * \param maxAddr The upper bound of the address pool
+   */
+  DhcpAddressPool (Ipv4Address poolAddr, Ipv4Mask poolMask, Ipv4Address minAddr, Ipv4Address maxAddr);
+
+  /**
+   * \brief Get the network part of the pool
+   * \return The Ipv4Address (network part) of the address pool
+   */
+  Ipv4Address GetPoolAddress (void) const;
+
+  /**
+   * \brief Get the mask of the pool
+   * \return The mask of the address pool
+   */
+  Ipv4Mask GetPoolMask (void) const;
+
+  /**
+   * \brief Get the lower bound of the pool
+   * \return The lower bound of the address pool
+   */
+  Ipv4Address GetMinAddress (void) const;
+
+  /**
+   * \brief Get the upper bound of the pool
+   * \return The upper bound of the address pool
+   */
+  Ipv4Address GetMaxAddress (void) const;
+
+  /**
+   * \brief Check whether an address is in the [minAddr, maxAddr] range
+   * \param addr The address to check
+   * \return true if the address belongs to the pool range
+   */
+  bool IsInRange (Ipv4Address addr) const;
+
+  /**
+   * \brief Get the number of addresses in the pool range
+   * \return The number of addresses in the pool range
+   */
+  uint32_t GetSize (void) const;
+
+  /**
+   * \brief Get the number of addresses that can still be allocated
+   * \return The number of free addresses
+   */
+  uint32_t GetNAvailable (void) const;
+
+  /**
+   * \brief Check whether an address of the pool is free
+   * \param addr The address to check
+   * \return true if the address is in range and not allocated
+   */
+  bool IsAvailable (Ipv4Address addr) const;
+
+  /**
+   * \brief Allocate the lowest free address of the pool
+   * \return The allocated address, or Ipv4Address () if the pool is full
+   */
+  Ipv4Address Allocate (void);
+
+  /**
+   * \brief Allocate the first free address at or after a position of the pool range
+   *
+   * The search wraps around to the start of the range.
+   *
+   * \param start Offset in the pool range where the search starts, reduced modulo the pool size
+   * \return The allocated address, or Ipv4Address () if the pool is full
+   */
+  Ipv4Address Allocate (uint32_t start);
+
+  /**
+   * \brief Allocate a given address of the pool
+   * \param addr The address to allocate
+   * \return true if the address was free and is now allocated
+   */
+  bool Reserve (Ipv4Address addr);
+
+  /**
+   * \brief Give an allocated address back to the pool
+   * \param addr The address to release
+   */
+  void Release (Ipv4Address addr);
+
+private:
+  /**
+   * \brief Mark an address as allocated and update the summary levels
+   * \param index Offset of the address in the pool range
+   */
+  void SetUsed (uint32_t index);
+
+  /**
+   * \brief Mark an address as free and update the summary levels
+   * \param index Offset of the address in the pool range
+   */
+  void SetFree (uint32_t index);
+
+  /**
+   * \brief Find the first free address at or after a position of the pool range
+   * \param start Offset in the pool range where the search starts
+   * \return The offset of the free address, or the pool size if there is none
+   */
+  uint32_t FindFreeFrom (uint32_t start) const;
+
+  Ipv4Address m_poolAddr;                       //!< Network part of the pool
+  Ipv4Mask m_poolMask;                          //!< Mask of the pool
+  Ipv4Address m_minAddr;                        //!< Lower bound of the pool range
+  Ipv4Address m_maxAddr;                        //!< Upper bound of the pool range
+  uint32_t m_size;                              //!< Number of addresses in the range
+  uint32_t m_available;                         //!< Number of free addresses
+  std::vector<std::vector<uint64_t> > m_levels; //!< Bitmap (level 0) and full-word summaries
+};
+
+} // namespace ns3
+
+#endif /* DHCP_ADDRESS_POOL_H */
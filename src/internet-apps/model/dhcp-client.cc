@@ -39,6 +39,8 @@
 #include "ns3/packet.h"
 #include "ns3/ipv4-static-routing-helper.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
 #include "ns3/random-variable-stream.h"
 #include "ns3/pointer.h"
 #include "ns3/string.h"
@@ -58,18 +60,66 @@ DhcpClient::GetTypeId (void)
     .SetParent<Application> ()
     .AddConstructor<DhcpClient> ()
     .SetGroupName ("Internet-Apps")
-    .AddAttribute ("RTRS", "Time for retransmission of Discover message",
-                   TimeValue (Seconds (5)),
+    .AddAttribute ("RTRS", "Time for the first retransmission of the DISCOVER and REQUEST messages, "
+                   "doubled at each retransmission",
+                   TimeValue (Seconds (4)),
                    MakeTimeAccessor (&DhcpClient::m_rtrs),
                    MakeTimeChecker ())
+    .AddAttribute ("MaxRtrs", "Maximum time between two retransmissions. Equal to RTRS, "
+                   "the messages are retransmitted at a fixed interval.",
+                   TimeValue (Seconds (64)),
+                   MakeTimeAccessor (&DhcpClient::m_maxRtrs),
+                   MakeTimeChecker ())
+    .AddAttribute ("RtrsJitter",
+                   "Random time in seconds added to each retransmission delay, so that clients "
+                   "booting together do not stay synchronized",
+                   StringValue ("ns3::UniformRandomVariable[Min=-1.0|Max=1.0]"),
+                   MakePointerAccessor (&DhcpClient::m_rtrsJitter),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddAttribute ("StartDelay",
+                   "Random time in seconds between the start of the client and its first DISCOVER",
+                   StringValue ("ns3::ConstantRandomVariable[Constant=0.0]"),
+                   MakePointerAccessor (&DhcpClient::m_startDelay),
+                   MakePointerChecker<RandomVariableStream> ())
     .AddAttribute ("Collect", "Time for which offer collection starts",
                    TimeValue (Seconds (5)),
                    MakeTimeAccessor (&DhcpClient::m_collect),
                    MakeTimeChecker ())
-    .AddAttribute ("ReRequest", "Time after which request will be resent to next server",
+    .AddAttribute ("ReRequest",
+                   "Time after which a REQUEST without reply is given up for the second best offer, "
+                   "or for a new DISCOVER if there is none",
                    TimeValue (Seconds (10)),
                    MakeTimeAccessor (&DhcpClient::m_nextoffer),
                    MakeTimeChecker ())
+    .AddAttribute ("MaxOffers",
+                   "Number of offers after which the client selects one without waiting for the end of "
+                   "the Collect time. 1 accepts the first offer right away, 0 waits for the end of Collect.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&DhcpClient::m_maxOffers),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("OfferScoring",
+                   "Choice of the offer accepted among those received",
+                   EnumValue (DhcpClient::SCORE_FIRST),
+                   MakeEnumAccessor (&DhcpClient::m_offerScoring),
+                   MakeEnumChecker (DhcpClient::SCORE_FIRST, "First",
+                                    DhcpClient::SCORE_LONGEST_LEASE, "LongestLease",
+                                    DhcpClient::SCORE_PREFERRED_SERVER, "PreferredServer"))
+    .AddAttribute ("PreferredServer",
+                   "Server whose offer is accepted as soon as it comes, with the PreferredServer scoring",
+                   Ipv4AddressValue (Ipv4Address::GetAny ()),
+                   MakeIpv4AddressAccessor (&DhcpClient::m_preferredServer),
+                   MakeIpv4AddressChecker ())
+    .AddAttribute ("RebootTimeout",
+                   "Time to wait for the reply to the REQUEST of the last address sent when the link "
+                   "comes back up, before falling back to a DISCOVER",
+                   TimeValue (Seconds (2)),
+                   MakeTimeAccessor (&DhcpClient::m_rebootTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("RapidCommit",
+                   "Whether the DISCOVER asks for a Rapid Commit ACK, skipping the offer collection and the REQUEST.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&DhcpClient::m_rapidCommit),
+                   MakeBooleanChecker ())
     .AddAttribute ("Transactions",
                    "The possible value of transaction numbers ",
                    StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=1000000.0]"),
@@ -82,7 +132,11 @@ DhcpClient::GetTypeId (void)
     .AddTraceSource ("ExpireLease",
                      "A lease expires",
                      MakeTraceSourceAccessor (&DhcpClient::m_expiry),
-                     "ns3::Ipv4Address::TracedCallback");
+                     "ns3::Ipv4Address::TracedCallback")
+    .AddTraceSource ("Retransmissions",
+                     "Number of DISCOVER and REQUEST messages sent again for lack of reply",
+                     MakeTraceSourceAccessor (&DhcpClient::m_retransmissions),
+                     "ns3::TracedValueCallback::Uint32");
   return tid;
 }
 
@@ -90,12 +144,18 @@ DhcpClient::DhcpClient ()
 {
   NS_LOG_FUNCTION_NOARGS ();
   m_server = Ipv4Address::GetAny ();
+  m_rebootAddress = Ipv4Address::GetAny ();
+  m_nAttempts = 0;
+  m_retransmissions = 0;
+  m_nOffers = 0;
+  m_hasSecondOffer = false;
   m_socket = 0;
   m_refreshEvent = EventId ();
   m_requestEvent = EventId ();
   m_discoverEvent = EventId ();
   m_rebindEvent = EventId ();
   m_nextOfferEvent = EventId ();
+  m_collectEvent = EventId ();
   m_timeout = EventId ();
 }
 
@@ -104,12 +164,18 @@ DhcpClient::DhcpClient (Ptr<NetDevice> netDevice)
   NS_LOG_FUNCTION_NOARGS ();
   m_device = netDevice;
   m_server = Ipv4Address::GetAny ();
+  m_rebootAddress = Ipv4Address::GetAny ();
+  m_nAttempts = 0;
+  m_retransmissions = 0;
+  m_nOffers = 0;
+  m_hasSecondOffer = false;
   m_socket = 0;
   m_refreshEvent = EventId ();
   m_requestEvent = EventId ();
   m_discoverEvent = EventId ();
   m_rebindEvent = EventId ();
   m_nextOfferEvent = EventId ();
+  m_collectEvent = EventId ();
   m_timeout = EventId ();
 }
 
@@ -148,7 +214,9 @@ DhcpClient::AssignStreams (int64_t stream)
 {
   NS_LOG_FUNCTION (this << stream);
   m_ran->SetStream (stream);
-  return 1;
+  m_rtrsJitter->SetStream (stream + 1);
+  m_startDelay->SetStream (stream + 2);
+  return 3;
 }
 
 void
@@ -192,13 +260,21 @@ DhcpClient::StartApplication (void)
       m_socket = Socket::CreateSocket (GetNode (), tid);
       InetSocketAddress local = InetSocketAddress (Ipv4Address::GetAny (), 68);
       m_socket->SetAllowBroadcast (true);
-      m_socket->BindToNetDevice (m_device);
       m_socket->Bind (local);
+      m_socket->BindToNetDevice (m_device);
+      m_device->AddLinkChangeCallback (MakeCallback (&DhcpClient::LinkStateHandler, this));
     }
   m_socket->SetRecvCallback (MakeCallback (&DhcpClient::NetHandler, this));
 
-  m_device->AddLinkChangeCallback (MakeCallback (&DhcpClient::LinkStateHandler, this));
-  Boot ();
+  Time startDelay = Seconds (m_startDelay->GetValue ());
+  if (startDelay.IsStrictlyPositive ())
+    {
+      m_discoverEvent = Simulator::Schedule (startDelay, &DhcpClient::Boot, this);
+    }
+  else
+    {
+      Boot ();
+    }
 
 }
 
@@ -213,8 +289,35 @@ DhcpClient::StopApplication ()
   Simulator::Remove (m_refreshEvent);
   Simulator::Remove (m_timeout);
   Simulator::Remove (m_nextOfferEvent);
+  Simulator::Remove (m_collectEvent);
   Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
 
+  if (m_myAddress != Ipv4Address ("0.0.0.0"))
+    {
+      // give the address back to the server right away. The message is
+      // broadcast (and relayed if needed) like the other client messages,
+      // so that it does not wait for ARP while the address is removed.
+      DhcpHeader header;
+      Ptr<Packet> packet = Create<Packet> ();
+      header.ResetOpt ();
+      m_tran = (uint32_t) (m_ran->GetValue ());
+      header.SetTran (m_tran);
+      header.SetType (DhcpHeader::DHCPRELEASE);
+      header.SetTime ();
+      header.SetCiaddr (m_myAddress);
+      header.SetDhcps (m_remoteAddress);
+      header.SetChaddr (m_chaddr);
+      packet->AddHeader (header);
+      if ((m_socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), DHCP_PEER_PORT))) >= 0)
+        {
+          NS_LOG_INFO ("DHCP RELEASE sent");
+        }
+      else
+        {
+          NS_LOG_INFO ("Error while sending DHCP RELEASE to " << m_remoteAddress);
+        }
+    }
+
   int32_t ifIndex = ipv4->GetInterfaceForDevice (m_device);
   for (uint32_t i = 0; i < ipv4->GetNAddresses (ifIndex); i++)
     {
@@ -237,11 +340,27 @@ void DhcpClient::LinkStateHandler (void)
     {
       NS_LOG_INFO ("Link up at " << Simulator::Now ().As (Time::S));
       m_socket->SetRecvCallback (MakeCallback (&DhcpClient::NetHandler, this));
-      StartApplication ();
+      if (m_rebootAddress != Ipv4Address::GetAny () && m_rebootExpiry > Simulator::Now ())
+        {
+          InitReboot ();
+        }
+      else
+        {
+          StartApplication ();
+        }
     }
   else
     {
       NS_LOG_INFO ("Link down at " << Simulator::Now ().As (Time::S)); //reinitialization
+      // remember the lease, to ask for it again when the link comes back
+      m_rebootAddress = Ipv4Address::GetAny ();
+      if (m_myAddress != Ipv4Address::GetAny () && m_timeout.IsRunning ())
+        {
+          m_rebootAddress = m_myAddress;
+          m_rebootExpiry = Simulator::Now () + Simulator::GetDelayLeft (m_timeout);
+        }
+      Simulator::Remove (m_nextOfferEvent);
+      Simulator::Remove (m_requestEvent);
       Simulator::Remove (m_refreshEvent); //stop refresh timer!!!!
       Simulator::Remove (m_rebindEvent);
       Simulator::Remove (m_timeout);
@@ -292,31 +411,123 @@ void DhcpClient::NetHandler (Ptr<Socket> socket)
     {
       OfferHandler (header);
     }
+  if (m_state == WAIT_ACK && header.GetType () == DhcpHeader::DHCPOFFER && header.GetDhcps () != m_server)
+    {
+      // A late offer, requested if the REQUEST sent gets no reply
+      if (m_nOffers == 0 || IsBetterOffer (header, m_offer))
+        {
+          m_offer = header;
+        }
+      m_nOffers++;
+    }
+  if (m_state == WAIT_OFFER && header.GetType () == DhcpHeader::DHCPACK
+      && m_rapidCommit && header.IsRapidCommit ())
+    {
+      // the lease is committed, no need to wait for other offers
+      Simulator::Remove (m_discoverEvent);
+      Simulator::Remove (m_collectEvent);
+      m_nOffers = 0;
+      ReadOffer (header);
+      AcceptAck (header, from);
+    }
   if (m_state == WAIT_ACK && header.GetType () == DhcpHeader::DHCPACK)
     {
       Simulator::Remove (m_nextOfferEvent);
+      Simulator::Remove (m_requestEvent);
       AcceptAck (header,from);
     }
   if (m_state == WAIT_ACK && header.GetType () == DhcpHeader::DHCPNACK)
     {
       Simulator::Remove (m_nextOfferEvent);
+      Simulator::Remove (m_requestEvent);
       Boot ();
     }
+  if ((m_state == RENEWING || m_state == REBINDING) && header.GetType () == DhcpHeader::DHCPACK)
+    {
+      Simulator::Remove (m_requestEvent);
+      AcceptAck (header,from);
+    }
+  if ((m_state == RENEWING || m_state == REBINDING) && header.GetType () == DhcpHeader::DHCPNACK)
+    {
+      // the lease can not be extended, stop using the address
+      Simulator::Remove (m_requestEvent);
+      RemoveAndStart ();
+    }
 }
 
 void DhcpClient::Boot (void)
 {
   NS_LOG_FUNCTION (this);
 
+  Simulator::Remove (m_requestEvent);
+  m_tran = (uint32_t) (m_ran->GetValue ());
+  m_nAttempts = 0;
+  SendDiscover ();
+}
+
+void DhcpClient::InitReboot (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // The address was removed when the link went down, the REQUEST is sent
+  // from 0.0.0.0 like a DISCOVER
+  m_offeredAddress = m_rebootAddress;
+  m_rebootAddress = Ipv4Address::GetAny ();
+  m_myAddress = Ipv4Address::GetAny ();
+
+  Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
+  uint32_t ifIndex = ipv4->GetInterfaceForDevice (m_device);
+  bool found = false;
+  for (uint32_t i = 0; i < ipv4->GetNAddresses (ifIndex); i++)
+    {
+      if (ipv4->GetAddress (ifIndex, i).GetLocal () == m_myAddress)
+        {
+          found = true;
+        }
+    }
+  if (!found)
+    {
+      ipv4->AddAddress (ifIndex, Ipv4InterfaceAddress (Ipv4Address ("0.0.0.0"),Ipv4Mask ("/0")));
+    }
+
+  DhcpHeader header;
+  Ptr<Packet> packet = Create<Packet> ();
+  header.ResetOpt ();
+  m_tran = (uint32_t) (m_ran->GetValue ());
+  header.SetTran (m_tran);
+  header.SetType (DhcpHeader::DHCPREQ);
+  header.SetTime ();
+  header.SetReq (m_offeredAddress);
+  header.SetChaddr (m_chaddr);
+  packet->AddHeader (header);
+  if ((m_socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), DHCP_PEER_PORT))) >= 0)
+    {
+      NS_LOG_INFO ("DHCP REQUEST (INIT-REBOOT) sent for " << m_offeredAddress);
+    }
+  else
+    {
+      NS_LOG_INFO ("Error while sending DHCP REQUEST (INIT-REBOOT)");
+    }
+  m_state = WAIT_ACK;
+  m_nextOfferEvent = Simulator::Schedule (m_rebootTimeout, &DhcpClient::Boot, this);
+}
+
+void DhcpClient::SendDiscover (void)
+{
+  NS_LOG_FUNCTION (this);
+
   DhcpHeader header;
   Ptr<Packet> packet;
   packet = Create<Packet> ();
   header.ResetOpt ();
-  m_tran = (uint32_t) (m_ran->GetValue ());
   header.SetTran (m_tran);
   header.SetType (DhcpHeader::DHCPDISCOVER);
   header.SetTime ();
   header.SetChaddr (m_chaddr);
+  if (m_rapidCommit)
+    {
+      header.SetRapidCommit ();
+    }
   packet->AddHeader (header);
 
   if ((m_socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), DHCP_PEER_PORT))) >= 0)
@@ -327,21 +538,78 @@ void DhcpClient::Boot (void)
     {
       NS_LOG_INFO ("Error while sending DHCP DISCOVER to " << m_remoteAddress);
     }
+  if (m_nAttempts > 0)
+    {
+      m_retransmissions++;
+    }
   m_state = WAIT_OFFER;
-  m_offered = false;
-  m_discoverEvent = Simulator::Schedule (m_rtrs, &DhcpClient::Boot, this);
+  m_nOffers = 0;
+  m_hasSecondOffer = false;
+  m_discoverEvent = Simulator::Schedule (GetRetransmissionDelay (), &DhcpClient::SendDiscover, this);
+}
+
+Time DhcpClient::GetRetransmissionDelay (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // 4 s, 8 s, 16 s... with the defaults
+  Time delay = m_rtrs;
+  for (uint32_t i = 0; i < m_nAttempts && delay < m_maxRtrs; i++)
+    {
+      delay = delay * 2;
+    }
+  delay = Min (delay, m_maxRtrs) + Seconds (m_rtrsJitter->GetValue ());
+  m_nAttempts++;
+  return Max (delay, Time (0));
 }
 
 void DhcpClient::OfferHandler (DhcpHeader header)
 {
   NS_LOG_FUNCTION (this << header);
 
-  m_offerList.push_back (header);
-  if (m_offered == false)
+  // Only the best offer is kept, and the second best in case the REQUEST
+  // of the best one gets no reply
+  if (m_nOffers == 0)
+    {
+      m_offer = header;
+    }
+  else if (IsBetterOffer (header, m_offer))
+    {
+      m_secondOffer = m_offer;
+      m_hasSecondOffer = true;
+      m_offer = header;
+    }
+  else if (!m_hasSecondOffer || IsBetterOffer (header, m_secondOffer))
+    {
+      m_secondOffer = header;
+      m_hasSecondOffer = true;
+    }
+  m_nOffers++;
+  if (m_nOffers == 1)
     {
       Simulator::Remove (m_discoverEvent);
-      m_offered = true;
-      Simulator::Schedule (m_collect, &DhcpClient::Select, this);
+      m_collectEvent = Simulator::Schedule (m_collect, &DhcpClient::Select, this);
+    }
+
+  bool preferred = (m_offerScoring == SCORE_PREFERRED_SERVER && m_offer.GetDhcps () == m_preferredServer);
+  if (preferred || (m_maxOffers > 0 && m_nOffers >= m_maxOffers))
+    {
+      NS_LOG_LOGIC ("Offer selected after " << m_nOffers << " offers");
+      Simulator::Remove (m_collectEvent);
+      Select ();
+    }
+}
+
+bool DhcpClient::IsBetterOffer (const DhcpHeader &header, const DhcpHeader &other) const
+{
+  switch (m_offerScoring)
+    {
+    case SCORE_LONGEST_LEASE:
+      return header.GetLease () > other.GetLease ();
+    case SCORE_PREFERRED_SERVER:
+      return header.GetDhcps () == m_preferredServer && other.GetDhcps () != m_preferredServer;
+    default:
+      return false;
     }
 }
 
@@ -349,14 +617,25 @@ void DhcpClient::Select (void)
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_offerList.empty ())
+  Simulator::Remove (m_requestEvent);
+  if (m_nOffers == 0)
     {
       Boot ();
       return;
     }
 
-  DhcpHeader header = m_offerList.front ();
-  m_offerList.pop_front ();
+  ReadOffer (m_offer);
+  // The second best offer is the one requested if this REQUEST gets no reply
+  m_offer = m_secondOffer;
+  m_nOffers = m_hasSecondOffer ? 1 : 0;
+  m_hasSecondOffer = false;
+  Request ();
+}
+
+void DhcpClient::ReadOffer (DhcpHeader header)
+{
+  NS_LOG_FUNCTION (this << header);
+
   m_lease = Time (Seconds (header.GetLease ()));
   m_renew = Time (Seconds (header.GetRenew ()));
   m_rebind = Time (Seconds (header.GetRebind ()));
@@ -364,53 +643,105 @@ void DhcpClient::Select (void)
   m_myMask = Ipv4Mask (header.GetMask ());
   m_server = header.GetDhcps ();
   m_gateway = header.GetRouter ();
-  m_offerList.clear ();
-  m_offered = false;
-  Request ();
 }
 
 void DhcpClient::Request (void)
 {
   NS_LOG_FUNCTION (this);
 
+  m_nAttempts = 0;
+  SendRequest ();
+  m_state = WAIT_ACK;
+  m_nextOfferEvent = Simulator::Schedule (m_nextoffer, &DhcpClient::Select, this);
+}
+
+void DhcpClient::SendRequest (void)
+{
+  NS_LOG_FUNCTION (this);
+
   DhcpHeader header;
-  Ptr<Packet> packet;
-  if (m_state != REFRESH_LEASE)
+  Ptr<Packet> packet = Create<Packet> ();
+  header.ResetOpt ();
+  header.SetType (DhcpHeader::DHCPREQ);
+  header.SetTime ();
+  header.SetTran (m_tran);
+  header.SetReq (m_offeredAddress);
+  header.SetChaddr (m_chaddr);
+  // The server identifier tells the other servers their offer was declined
+  header.SetDhcps (m_server);
+  packet->AddHeader (header);
+  m_socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), DHCP_PEER_PORT));
+  if (m_nAttempts > 0)
     {
-      packet = Create<Packet> ();
-      header.ResetOpt ();
-      header.SetType (DhcpHeader::DHCPREQ);
-      header.SetTime ();
-      header.SetTran (m_tran);
-      header.SetReq (m_offeredAddress);
-      header.SetChaddr (m_chaddr);
-      packet->AddHeader (header);
-      m_socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), DHCP_PEER_PORT));
-      m_state = WAIT_ACK;
-      m_nextOfferEvent = Simulator::Schedule (m_nextoffer, &DhcpClient::Select, this);
+      m_retransmissions++;
+    }
+  m_requestEvent = Simulator::Schedule (GetRetransmissionDelay (), &DhcpClient::SendRequest, this);
+}
+
+void DhcpClient::Renew (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_tran = (uint32_t) (m_ran->GetValue ());
+  m_nAttempts = 0;
+  m_offeredAddress = m_myAddress;
+  m_state = RENEWING;
+  SendRenewal ();
+}
+
+void DhcpClient::Rebind (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // the server of the lease did not answer, ask all the servers
+  Simulator::Remove (m_requestEvent);
+  m_tran = (uint32_t) (m_ran->GetValue ());
+  m_nAttempts = 0;
+  m_offeredAddress = m_myAddress;
+  m_state = REBINDING;
+  SendRenewal ();
+}
+
+void DhcpClient::SendRenewal (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  DhcpHeader header;
+  Ptr<Packet> packet = Create<Packet> ();
+  header.ResetOpt ();
+  header.SetTran (m_tran);
+  header.SetTime ();
+  header.SetType (DhcpHeader::DHCPREQ);
+  // A renewing client fills ciaddr, and leaves out option 50 (RFC 2131, section 4.3.2)
+  header.SetCiaddr (m_myAddress);
+  header.SetChaddr (m_chaddr);
+  packet->AddHeader (header);
+
+  Ipv4Address to = Ipv4Address ("255.255.255.255");
+  EventId deadline = m_timeout;
+  if (m_state == RENEWING)
+    {
+      to = m_remoteAddress;
+      deadline = m_rebindEvent;
+    }
+  if ((m_socket->SendTo (packet, 0, InetSocketAddress (to, DHCP_PEER_PORT))) >= 0)
+    {
+      NS_LOG_INFO ("DHCP REQUEST sent to " << to);
     }
   else
     {
-      uint32_t addr = m_myAddress.Get ();
-      packet = Create<Packet> ((uint8_t*)&addr, sizeof(addr));
-      header.ResetOpt ();
-      m_tran = (uint32_t) (m_ran->GetValue ());
-      header.SetTran (m_tran);
-      header.SetTime ();
-      header.SetType (DhcpHeader::DHCPREQ);
-      header.SetReq (m_myAddress);
-      m_offeredAddress = m_myAddress;
-      header.SetChaddr (m_chaddr);
-      packet->AddHeader (header);
-      if ((m_socket->SendTo (packet, 0, InetSocketAddress (m_remoteAddress, DHCP_PEER_PORT))) >= 0)
-        {
-          NS_LOG_INFO ("DHCP REQUEST sent");
-        }
-      else
-        {
-          NS_LOG_INFO ("Error while sending DHCP REQ to " << m_remoteAddress);
-        }
-      m_state = WAIT_ACK;
+      NS_LOG_INFO ("Error while sending DHCP REQ to " << to);
+    }
+  if (m_nAttempts > 0)
+    {
+      m_retransmissions++;
+    }
+  m_nAttempts++;
+
+  Time delay = Seconds (Simulator::GetDelayLeft (deadline).GetSeconds () / 2);
+  if (delay >= m_rtrs)
+    {
+      m_requestEvent = Simulator::Schedule (delay, &DhcpClient::SendRenewal, this);
     }
 }
 
@@ -472,9 +803,9 @@ void DhcpClient::AcceptAck (DhcpHeader header, Address from)
   NS_LOG_INFO("My New Address is "<<m_myAddress);
   NS_LOG_INFO ("Current DHCP Server is " << m_remoteAddress);
 
-  m_offerList.clear ();
-  m_refreshEvent = Simulator::Schedule (m_renew, &DhcpClient::Request, this);
-  m_rebindEvent = Simulator::Schedule (m_rebind, &DhcpClient::Request, this);
+  m_nOffers = 0;
+  m_refreshEvent = Simulator::Schedule (m_renew, &DhcpClient::Renew, this);
+  m_rebindEvent = Simulator::Schedule (m_rebind, &DhcpClient::Rebind, this);
   m_timeout =  Simulator::Schedule (m_lease, &DhcpClient::RemoveAndStart, this);
   m_state = REFRESH_LEASE;
 }
@@ -484,6 +815,7 @@ void DhcpClient::RemoveAndStart ()
   NS_LOG_FUNCTION (this);
 
   Simulator::Remove (m_nextOfferEvent);
+  Simulator::Remove (m_requestEvent);
   Simulator::Remove (m_refreshEvent);
   Simulator::Remove (m_rebindEvent);
   Simulator::Remove (m_timeout);
@@ -32,7 +32,6 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/traced-value.h"
 #include "dhcp-header.h"
-#include <list>
 
 namespace ns3 {
 
@@ -64,6 +63,14 @@ public:
    */
   DhcpClient (Ptr<NetDevice> netDevice);  
 
+  /// Choice of the offer accepted among those received
+  enum OfferScoring
+  {
+    SCORE_FIRST,             //!< The first offer received
+    SCORE_LONGEST_LEASE,     //!< The offer with the longest lease
+    SCORE_PREFERRED_SERVER   //!< The offer of PreferredServer, accepted as soon as it comes, or else the first one
+  };
+
   /**
    * \brief Get the the NetDevice DHCP should work on
    * \return the NetDevice DHCP should work on
@@ -101,6 +108,8 @@ private:
   {
     WAIT_OFFER = 1,             //!< State of a client that waits for the offer
     REFRESH_LEASE = 2,          //!< State of a client that needs to refresh the lease
+    RENEWING = 3,               //!< State of a client renewing its lease with its server
+    REBINDING = 4,              //!< State of a client renewing its lease with any server
     WAIT_ACK = 9                //!< State of a client that waits for acknowledgment
   };
 
@@ -128,26 +137,99 @@ private:
   void NetHandler (Ptr<Socket> socket);
 
   /**
-   * \brief Sends DHCP DISCOVER and changes the client state to WAIT_OFFER
+   * \brief Starts a new transaction with a DHCP DISCOVER
    */
   void Boot (void);
 
   /**
-   * \brief Stores DHCP offers in m_offerList
+   * \brief Asks again for the address of the last lease, after a link flap
+   *
+   * The REQUEST is broadcast without server identifier (INIT-REBOOT state,
+   * RFC 2131 section 4.3.2). The client falls back to a DISCOVER on a NACK,
+   * or when no reply comes within RebootTimeout.
+   */
+  void InitReboot (void);
+
+  /**
+   * \brief Sends DHCP DISCOVER and changes the client state to WAIT_OFFER
+   *
+   * The DISCOVER is sent again until an offer comes, with the same
+   * transaction id, after GetRetransmissionDelay.
+   */
+  void SendDiscover (void);
+
+  /**
+   * \brief Get the time before the next retransmission of a message
+   *
+   * The delay starts at RTRS and doubles at each retransmission, up to
+   * MaxRtrs, and RtrsJitter is added to it (RFC 2131, section 4.1).
+   *
+   * \return The delay, and counts one more attempt of the current message
+   */
+  Time GetRetransmissionDelay (void);
+
+  /**
+   * \brief Keeps a DHCP offer if it is the best one so far, and selects
+   * it right away if no other offer is waited for
    * \param header DhcpHeader of the DHCP OFFER message
    */
   void OfferHandler (DhcpHeader header);
 
   /**
-   * \brief Selects an OFFER from m_offerList
+   * \brief Check whether an offer is better than another one
+   * \param header DhcpHeader of the DHCP OFFER message
+   * \param other DhcpHeader of the offer it is compared with
+   * \return true if the offer is better
+   */
+  bool IsBetterOffer (const DhcpHeader &header, const DhcpHeader &other) const;
+
+  /**
+   * \brief Requests the best offer kept, or starts again if there is none
+   *
+   * Called again if the REQUEST gets no reply within ReRequest, the
+   * second best offer is then requested, or a new DISCOVER sent.
    */
   void Select (void);
 
+  /**
+   * \brief Stores the address and lease parameters given by a server
+   * \param header DhcpHeader of the DHCP OFFER (or Rapid Commit ACK) message
+   */
+  void ReadOffer (DhcpHeader header);
+
   /**
    * \brief Sends the DHCP REQUEST message and changes the client state to WAIT_ACK
    */
   void Request (void);
 
+  /**
+   * \brief Sends the DHCP REQUEST for the selected offer
+   *
+   * The REQUEST is sent again after GetRetransmissionDelay, until an ACK
+   * or a NACK comes or the next offer is tried.
+   */
+  void SendRequest (void);
+
+  /**
+   * \brief Starts renewing the lease with the server that granted it (T1)
+   */
+  void Renew (void);
+
+  /**
+   * \brief Starts renewing the lease with any server (T2)
+   */
+  void Rebind (void);
+
+  /**
+   * \brief Sends the DHCP REQUEST extending the lease
+   *
+   * The REQUEST is unicast to the server of the lease in RENEWING state,
+   * and broadcast in REBINDING state. It is sent again after half the time
+   * left before T2, or before the end of the lease, as long as this is
+   * not shorter than RTRS (RFC 2131, section 4.4.5).
+   */
+  void SendRenewal (void);
+
   /**
    * \brief Receives the DHCP ACK and configures IP address of the client.
    *        It also triggers the timeout, renew and rebind events.
@@ -176,16 +258,31 @@ private:
   EventId m_refreshEvent;                //!< Message refresh event
   EventId m_rebindEvent;                 //!< Message rebind event
   EventId m_nextOfferEvent;              //!< Message next offer event
+  EventId m_collectEvent;                //!< End of the offer collection
   EventId m_timeout;                     //!< The timeout period
   Time m_lease;                          //!< Store the lease time of address
   Time m_renew;                          //!< Store the renew time of address
   Time m_rebind;                         //!< Store the rebind time of address
   Time m_nextoffer;                      //!< Time to try the next offer (if request gets no reply)
+  Time m_rebootTimeout;                  //!< Time to wait for the reply to an INIT-REBOOT REQUEST
+  Ipv4Address m_rebootAddress;           //!< Address of the lease lost when the link went down
+  Time m_rebootExpiry;                   //!< Expiry time of the lease lost when the link went down
   Ptr<RandomVariableStream> m_ran;       //!< Uniform random variable for transaction ID
   Time m_rtrs;                           //!< Defining the time for retransmission
+  Time m_maxRtrs;                        //!< Maximum time between two retransmissions
+  Ptr<RandomVariableStream> m_rtrsJitter; //!< Random time (s) added to each retransmission delay
+  Ptr<RandomVariableStream> m_startDelay; //!< Random time (s) before the first DISCOVER
+  uint32_t m_nAttempts;                  //!< Number of times the current message has been sent
+  TracedValue<uint32_t> m_retransmissions; //!< Number of DISCOVER and REQUEST retransmissions
   Time m_collect;                        //!< Time for which client should collect offers
-  bool m_offered;                        //!< Specify if the client has got any offer
-  std::list<DhcpHeader> m_offerList;     //!< Stores all the offers given to the client
+  bool m_rapidCommit;                    //!< Ask the servers for a Rapid Commit ACK
+  uint32_t m_maxOffers;                  //!< Number of offers after which one is selected, 0 to wait for the end of Collect
+  OfferScoring m_offerScoring;           //!< Choice of the offer accepted
+  Ipv4Address m_preferredServer;         //!< Server whose offer is preferred
+  DhcpHeader m_offer;                    //!< Best offer received in the current transaction, next one to request
+  uint32_t m_nOffers;                    //!< Number of offers received in the current transaction, not yet requested
+  DhcpHeader m_secondOffer;              //!< Second best offer received while collecting the offers
+  bool m_hasSecondOffer;                 //!< Whether m_secondOffer holds an offer
   uint32_t m_tran;                       //!< Stores the current transaction number to be used
   TracedCallback<const Ipv4Address&> m_newLease;//!< Trace of new lease
   TracedCallback<const Ipv4Address&> m_expiry;  //!< Trace of lease expire
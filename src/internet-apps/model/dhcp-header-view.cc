@@ -0,0 +1,312 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+#include "dhcp-header-view.h"
+#include <cstring>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("DhcpHeaderView");
+NS_OBJECT_ENSURE_REGISTERED (DhcpHeaderView);
+
+/// The DHCP magic cookie (99.130.83.99)
+static const uint32_t MAGIC_COOKIE = 0x63825363;
+
+TypeId
+DhcpHeaderView::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DhcpHeaderView")
+    .SetParent<Header> ()
+    .SetGroupName ("Internet-Apps")
+  ;
+  return tid;
+}
+
+TypeId
+DhcpHeaderView::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+DhcpHeaderView::DhcpHeaderView (Ptr<const Packet> packet)
+  : m_packet (packet),
+    m_size (0),
+    m_valid (false),
+    m_indexed (false),
+    m_end (0),
+    m_chaddrRead (false)
+{
+  packet->PeekHeader (*this);
+}
+
+uint32_t
+DhcpHeaderView::Deserialize (Buffer::Iterator start)
+{
+  // Only the position of the message is kept, the fields are read on access
+  m_start = start;
+  m_size = start.GetRemainingSize ();
+  m_valid = false;
+  if (m_size > DhcpHeader::OFFSET_OPTIONS)
+    {
+      Buffer::Iterator i = At (DhcpHeader::OFFSET_COOKIE);
+      m_valid = (i.ReadNtohU32 () == MAGIC_COOKIE);
+    }
+  if (!m_valid)
+    {
+      NS_LOG_WARN ("Malformed Packet");
+    }
+  return m_size;
+}
+
+uint32_t
+DhcpHeaderView::GetSerializedSize (void) const
+{
+  return m_size;
+}
+
+void
+DhcpHeaderView::Serialize (Buffer::Iterator start) const
+{
+  NS_ABORT_MSG ("DhcpHeaderView is read-only, use DhcpHeader to build a message");
+}
+
+void
+DhcpHeaderView::Print (std::ostream &os) const
+{
+  if (m_valid)
+    {
+      os << "(type=" << (uint32_t) GetType () << ")";
+    }
+  else
+    {
+      os << "(malformed)";
+    }
+}
+
+bool
+DhcpHeaderView::IsValid (void) const
+{
+  return m_valid;
+}
+
+Buffer::Iterator
+DhcpHeaderView::At (uint32_t offset) const
+{
+  Buffer::Iterator i = m_start;
+  i.Next (offset);
+  return i;
+}
+
+uint32_t
+DhcpHeaderView::FindOption (uint8_t option) const
+{
+  NS_ASSERT_MSG (m_valid, "Reading a malformed DHCP message");
+
+  if (!m_indexed)
+    {
+      // A single pass over the options, recording where each value starts
+      std::memset (m_options, 0, sizeof (m_options));
+      Buffer::Iterator i = At (DhcpHeader::OFFSET_OPTIONS);
+      uint32_t offset = DhcpHeader::OFFSET_OPTIONS;
+      m_end = m_size;
+      while (offset < m_size)
+        {
+          uint8_t code = i.ReadU8 ();
+          if (code == DhcpHeader::OP_END)
+            {
+              m_end = offset;
+              break;
+            }
+          if (code == 0)
+            {
+              // pad
+              offset++;
+              continue;
+            }
+          if (offset + 2 > m_size)
+            {
+              NS_LOG_WARN ("Malformed Packet");
+              break;
+            }
+          uint8_t len = i.ReadU8 ();
+          if (offset + 2 + len > m_size)
+            {
+              NS_LOG_WARN ("Malformed Packet");
+              break;
+            }
+          m_options[code] = offset + 2;
+          i.Next (len);
+          offset += 2 + len;
+        }
+      m_indexed = true;
+    }
+  return m_options[option];
+}
+
+uint32_t
+DhcpHeaderView::ReadOption32 (uint8_t option) const
+{
+  uint32_t offset = FindOption (option);
+  if (offset == 0 || At (offset - 1).ReadU8 () < 4)
+    {
+      return 0;
+    }
+  return At (offset).ReadNtohU32 ();
+}
+
+uint8_t
+DhcpHeaderView::GetType (void) const
+{
+  uint32_t offset = FindOption (DhcpHeader::OP_MSGTYPE);
+  if (offset == 0)
+    {
+      return 0xff;
+    }
+  return At (offset).ReadU8 () - 1;
+}
+
+uint8_t
+DhcpHeaderView::GetHops (void) const
+{
+  return At (DhcpHeader::OFFSET_HOPS).ReadU8 ();
+}
+
+uint32_t
+DhcpHeaderView::GetTran (void) const
+{
+  // Same byte order as DhcpHeader::Serialize
+  return At (DhcpHeader::OFFSET_XID).ReadU32 ();
+}
+
+const uint8_t *
+DhcpHeaderView::GetChaddrBuffer (void) const
+{
+  if (!m_chaddrRead)
+    {
+      At (DhcpHeader::OFFSET_CHADDR).Read (m_chaddr, 16);
+      m_chaddrRead = true;
+    }
+  return m_chaddr;
+}
+
+Address
+DhcpHeaderView::GetChaddr (void) const
+{
+  Address addr;
+  addr.CopyFrom (GetChaddrBuffer (), 16);
+  return addr;
+}
+
+Ipv4Address
+DhcpHeaderView::GetCiaddr (void) const
+{
+  return Ipv4Address (At (DhcpHeader::OFFSET_CIADDR).ReadNtohU32 ());
+}
+
+Ipv4Address
+DhcpHeaderView::GetYiaddr (void) const
+{
+  return Ipv4Address (At (DhcpHeader::OFFSET_YIADDR).ReadNtohU32 ());
+}
+
+Ipv4Address
+DhcpHeaderView::GetGiAddr (void) const
+{
+  return Ipv4Address (At (DhcpHeader::OFFSET_GIADDR).ReadNtohU32 ());
+}
+
+Ipv4Address
+DhcpHeaderView::GetDhcps (void) const
+{
+  return Ipv4Address (ReadOption32 (DhcpHeader::OP_SERVID));
+}
+
+Ipv4Address
+DhcpHeaderView::GetReq (void) const
+{
+  return Ipv4Address (ReadOption32 (DhcpHeader::OP_ADDREQ));
+}
+
+uint32_t
+DhcpHeaderView::GetMask (void) const
+{
+  return ReadOption32 (DhcpHeader::OP_MASK);
+}
+
+Ipv4Address
+DhcpHeaderView::GetRouter (void) const
+{
+  return Ipv4Address (ReadOption32 (DhcpHeader::OP_ROUTE));
+}
+
+uint32_t
+DhcpHeaderView::GetLease (void) const
+{
+  return ReadOption32 (DhcpHeader::OP_LEASE);
+}
+
+uint32_t
+DhcpHeaderView::GetRenew (void) const
+{
+  return ReadOption32 (DhcpHeader::OP_RENEW);
+}
+
+uint32_t
+DhcpHeaderView::GetRebind (void) const
+{
+  return ReadOption32 (DhcpHeader::OP_REBIND);
+}
+
+bool
+DhcpHeaderView::IsRapidCommit (void) const
+{
+  return FindOption (DhcpHeader::OP_RAPID_COMMIT) != 0;
+}
+
+uint32_t
+DhcpHeaderView::CopyOption (uint8_t option, uint8_t *buffer) const
+{
+  uint32_t offset = FindOption (option);
+  if (offset == 0)
+    {
+      return 0;
+    }
+  uint32_t len = 2 + At (offset - 1).ReadU8 ();
+  At (offset - 2).Read (buffer, len);
+  return len;
+}
+
+uint32_t
+DhcpHeaderView::GetOptionOffset (uint8_t option) const
+{
+  uint32_t offset = FindOption (option);
+  return (offset == 0) ? 0 : offset - 2;
+}
+
+uint32_t
+DhcpHeaderView::GetEndOffset (void) const
+{
+  FindOption (DhcpHeader::OP_END);
+  return m_end;
+}
+
+} // namespace ns3
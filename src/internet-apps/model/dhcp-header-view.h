@@ -0,0 +1,228 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef DHCP_HEADER_VIEW_H
+#define DHCP_HEADER_VIEW_H
+
+#include "ns3/header.h"
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+#include "ns3/address.h"
+#include "ns3/ipv4-address.h"
+#include "dhcp-header.h"
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup dhcp
+ *
+ * \class DhcpHeaderView
+ * \brief Read-only view of the DHCP message held by a packet
+ *
+ * Unlike DhcpHeader, nothing is copied out of the packet when the view is
+ * created: each fixed field is read from its offset when it is accessed,
+ * and the options are indexed on the first access to one of them. The
+ * sname and file fields are never read. The view keeps a reference to
+ * the packet, which must not be modified while the view is in use.
+ *
+ * Unknown options are skipped. Missing options read as zero, like in an
+ * unset DhcpHeader.
+ */
+class DhcpHeaderView : public Header
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Create a view of the DHCP message at the start of a packet
+   * \param packet The packet
+   */
+  explicit DhcpHeaderView (Ptr<const Packet> packet);
+
+  /**
+   * \brief Check that the message is long enough and has the DHCP magic cookie
+   * \return true if the fields of the message can be read
+   */
+  bool IsValid (void) const;
+
+  /**
+   * \brief Return the type of DHCP message
+   * \return The type of message, or 0xff if the message has no type option
+   */
+  uint8_t GetType (void) const;
+
+  /**
+   * \brief Get the number of relay agents the message crossed
+   * \return The hops field
+   */
+  uint8_t GetHops (void) const;
+
+  /**
+   * \brief Get the transaction id
+   * \return The transaction id
+   */
+  uint32_t GetTran (void) const;
+
+  /**
+   * \brief Get the raw chaddr field of the message.
+   * \return Pointer to the 16 bytes of the chaddr field
+   */
+  const uint8_t * GetChaddrBuffer (void) const;
+
+  /**
+   * \brief Get the Address of the client.
+   * \return Address of the client
+   */
+  Address GetChaddr (void) const;
+
+  /**
+   * \brief Get the IPv4Address the client is already using (ciaddr)
+   * \return The client Ipv4Address
+   */
+  Ipv4Address GetCiaddr (void) const;
+
+  /**
+   * \brief Get the IPv4Address of the client
+   * \return The client Ipv4Address
+   */
+  Ipv4Address GetYiaddr (void) const;
+
+  /**
+   * \brief Get the gateway address (giaddr)
+   * \return The gateway address
+   */
+  Ipv4Address GetGiAddr (void) const;
+
+  /**
+   * \brief Get the information about the DHCP server
+   * \return The DHCP server address
+   */
+  Ipv4Address GetDhcps (void) const;
+
+  /**
+   * \brief Get the IPv4Address requested by the client
+   * \return The requested address
+   */
+  Ipv4Address GetReq (void) const;
+
+  /**
+   * \brief Return the mask of the network
+   * \return The mask
+   */
+  uint32_t GetMask (void) const;
+
+  /**
+   * \brief Return the Ipv4Address of gateway to be used
+   * \return The Ipv4Address of the gateway
+   */
+  Ipv4Address GetRouter (void) const;
+
+  /**
+   * \brief Return the lease time of the IPv4Address
+   * \return The lease time
+   */
+  uint32_t GetLease (void) const;
+
+  /**
+   * \brief Return the Renewal time of the address
+   * \return The renewal time
+   */
+  uint32_t GetRenew (void) const;
+
+  /**
+   * \brief Return the Rebind time of the address
+   * \return The rebind time
+   */
+  uint32_t GetRebind (void) const;
+
+  /**
+   * \brief Check whether the Rapid Commit option is present
+   * \return true if the message carries the Rapid Commit option
+   */
+  bool IsRapidCommit (void) const;
+
+  /**
+   * \brief Copy an option as it is encoded in the message
+   * \param option The option code
+   * \param buffer Buffer of at least 257 bytes receiving the code, the length and the value
+   * \return The number of bytes copied, or 0 if the option is absent
+   */
+  uint32_t CopyOption (uint8_t option, uint8_t *buffer) const;
+
+  /**
+   * \brief Get the position of an option in the message
+   * \param option The option code
+   * \return The offset of the option code, or 0 if the option is absent
+   */
+  uint32_t GetOptionOffset (uint8_t option) const;
+
+  /**
+   * \brief Get the position of the End option in the message
+   * \return The offset of the End option, or the size of the message if it has none
+   */
+  uint32_t GetEndOffset (void) const;
+
+  // Inherited
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  /**
+   * \brief Get an iterator on a byte of the message
+   * \param offset The offset of the byte
+   * \return The iterator
+   */
+  Buffer::Iterator At (uint32_t offset) const;
+
+  /**
+   * \brief Find the value of an option, indexing the options if needed
+   * \param option The option code
+   * \return The offset of the option value, or 0 if the option is absent
+   */
+  uint32_t FindOption (uint8_t option) const;
+
+  /**
+   * \brief Read a 4-byte option
+   * \param option The option code
+   * \return The value of the option in host order, or 0 if the option is absent
+   */
+  uint32_t ReadOption32 (uint8_t option) const;
+
+  Ptr<const Packet> m_packet;            //!< The packet holding the message
+  Buffer::Iterator m_start;              //!< Start of the message in the packet
+  uint32_t m_size;                       //!< Size of the message
+  bool m_valid;                          //!< Whether the message has a valid fixed part
+  mutable bool m_indexed;                //!< Whether m_options has been filled
+  mutable uint16_t m_options[256];       //!< Offset of the value of each option, 0 if absent
+  mutable uint32_t m_end;                //!< Offset of the End option
+  mutable bool m_chaddrRead;             //!< Whether m_chaddr has been filled
+  mutable uint8_t m_chaddr[16];          //!< Copy of the chaddr field
+};
+
+} // namespace ns3
+
+#endif /* DHCP_HEADER_VIEW_H */
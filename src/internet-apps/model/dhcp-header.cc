@@ -28,44 +28,35 @@
 #include "ns3/simulator.h"
 #include "dhcp-header.h"
 #include "ns3/address-utils.h"
+#include <cstring>
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("DhcpHeader");
 NS_OBJECT_ENSURE_REGISTERED (DhcpHeader);
 
+/// The DHCP magic cookie (99.130.83.99)
+static const uint32_t MAGIC_COOKIE = 0x63825363;
+
+/// Size of the sname and file fields
+static const uint32_t BOOT_FIELDS_SIZE = 192;
+
 DhcpHeader::DhcpHeader ()
 {
+  m_bootp = 1;
   m_hType = 1;
   m_hLen = 6;
   m_xid = 0;
   m_secs = 0;
   m_hops = 0;
   m_flags = 0;
+  std::memset (m_chaddr, 0, 16);
   Ipv4Address addr = Ipv4Address ("0.0.0.0");
   m_yiAddr = addr;
   m_ciAddr = addr;
   m_siAddr = addr;
   m_giAddr = addr;
-  m_dhcps = addr;
-  m_req = addr;
-  m_route = addr;
-  m_len = 240;
-
-  uint32_t i;
-
-  for (i = 0; i < 64; i++)
-    {
-      m_sname[i] = 0;
-    }
-  for (i = 0; i < 128; i++)
-    {
-      m_file[i] = 0;
-    }
-  m_magic_cookie[0] = 99;
-  m_magic_cookie[1] = 130;
-  m_magic_cookie[2] = 83;
-  m_magic_cookie[3] = 99;
+  m_bootFields = false;
 }
 
 DhcpHeader::~DhcpHeader ()
@@ -74,18 +65,20 @@ DhcpHeader::~DhcpHeader ()
 
 void DhcpHeader::SetType (uint8_t type)
 {
-  if (m_opt[OP_MSGTYPE] == false)
-    {
-      m_len += 3;
-      m_opt[OP_MSGTYPE] = true;
-    }
-  m_op = type;
-  m_bootp = (m_op == 0||m_op == 2) ? 1 : 2;
+  uint8_t value = type + 1;
+  SetOption (OP_MSGTYPE, &value, 1);
+  m_bootp = (type == DHCPOFFER || type == DHCPACK || type == DHCPNACK) ? 2 : 1;
 }
 
 uint8_t DhcpHeader::GetType (void) const
 {
-  return m_op;
+  uint8_t len;
+  const uint8_t *value = GetOption (OP_MSGTYPE, len);
+  if (value == 0 || len < 1)
+    {
+      return 0xff;
+    }
+  return value[0] - 1;
 }
 
 void DhcpHeader::SetHWType (uint8_t htype, uint8_t hlen)
@@ -130,6 +123,21 @@ Address DhcpHeader::GetChaddr ()
   return addr;
 }
 
+const uint8_t * DhcpHeader::GetChaddrBuffer (void) const
+{
+  return m_chaddr;
+}
+
+void DhcpHeader::SetCiaddr (Ipv4Address addr)
+{
+  m_ciAddr = addr;
+}
+
+Ipv4Address DhcpHeader::GetCiaddr (void) const
+{
+  return m_ciAddr;
+}
+
 void DhcpHeader::SetYiaddr (Ipv4Address addr)
 {
   m_yiAddr = addr;
@@ -142,107 +150,166 @@ Ipv4Address DhcpHeader::GetYiaddr (void) const
 
 void DhcpHeader::SetDhcps (Ipv4Address addr)
 {
-  if (m_opt[OP_SERVID] == false)
-    {
-      m_len += 6;
-      m_opt[OP_SERVID] = true;
-    }
-  m_dhcps = addr;
+  SetOption32 (OP_SERVID, addr.Get ());
 }
 
 Ipv4Address DhcpHeader::GetDhcps (void) const
 {
-  return m_dhcps;
+  return Ipv4Address (GetOption32 (OP_SERVID));
 }
 
 void DhcpHeader::SetReq (Ipv4Address addr)
 {
-  if (m_opt[OP_ADDREQ] == false)
-    {
-      m_len += 6;
-      m_opt[OP_ADDREQ] = true;
-    }
-  m_req = addr;
+  SetOption32 (OP_ADDREQ, addr.Get ());
 }
 
 Ipv4Address DhcpHeader::GetReq (void) const
 {
-  return m_req;
+  return Ipv4Address (GetOption32 (OP_ADDREQ));
 }
 
 void DhcpHeader::SetMask (uint32_t addr)
 {
-  if (m_opt[OP_MASK] == false)
-    {
-      m_len += 6;
-      m_opt[OP_MASK] = true;
-    }
-  m_mask = addr;
+  SetOption32 (OP_MASK, addr);
 }
 
 uint32_t DhcpHeader::GetMask (void) const
 {
-  return m_mask;
+  return GetOption32 (OP_MASK);
 }
 
 void DhcpHeader::SetRouter (Ipv4Address addr)
 {
-  if (m_opt[OP_ROUTE] == false)
-    {
-      m_len += 6;
-      m_opt[OP_ROUTE] = true;
-    }
-  m_route = addr;
+  SetOption32 (OP_ROUTE, addr.Get ());
 }
 
 Ipv4Address DhcpHeader::GetRouter (void) const
 {
-  return m_route;
+  return Ipv4Address (GetOption32 (OP_ROUTE));
 }
 
 void DhcpHeader::SetLease (uint32_t time)
 {
-  if (m_opt[OP_LEASE] == false)
-    {
-      m_len += 6;
-      m_opt[OP_LEASE] = true;
-    }
-  m_lease = time;
+  SetOption32 (OP_LEASE, time);
 }
 
 uint32_t DhcpHeader::GetLease (void) const
 {
-  return m_lease;
+  return GetOption32 (OP_LEASE);
 }
 
 void DhcpHeader::SetRenew (uint32_t time)
 {
-  if (m_opt[OP_RENEW] == false)
-    {
-      m_len += 6;
-      m_opt[OP_RENEW] = true;
-    }
-  m_renew = time;
+  SetOption32 (OP_RENEW, time);
 }
 
 uint32_t DhcpHeader::GetRenew (void) const
 {
-  return m_renew;
+  return GetOption32 (OP_RENEW);
 }
 
 void DhcpHeader::SetRebind (uint32_t time)
 {
-  if (m_opt[OP_REBIND] == false)
+  SetOption32 (OP_REBIND, time);
+}
+
+uint32_t DhcpHeader::GetRebind (void) const
+{
+  return GetOption32 (OP_REBIND);
+}
+
+void DhcpHeader::SetRapidCommit (void)
+{
+  SetOption (OP_RAPID_COMMIT, 0, 0);
+}
+
+bool DhcpHeader::IsRapidCommit (void) const
+{
+  return HasOption (OP_RAPID_COMMIT);
+}
+
+uint32_t DhcpHeader::GetOptionsStart (void) const
+{
+  return m_bootFields ? BOOT_FIELDS_SIZE : 0;
+}
+
+uint32_t DhcpHeader::FindOption (uint8_t option) const
+{
+  uint32_t pos = GetOptionsStart ();
+  while (pos < m_data.size () && m_data[pos] != option)
     {
-      m_len += 6;
-      m_opt[OP_REBIND] = true;
+      pos += 2 + m_data[pos + 1];
     }
-  m_rebind = time;
+  return pos;
 }
 
-uint32_t DhcpHeader::GetRebind (void) const
+void DhcpHeader::SetOption (uint8_t option, const uint8_t *value, uint8_t len)
 {
-  return m_rebind;
+  NS_ASSERT_MSG (option != OP_PAD && option != OP_END, "Pad and End are not options with a value");
+
+  uint32_t pos = FindOption (option);
+  if (pos < m_data.size () && m_data[pos + 1] != len)
+    {
+      m_data.erase (m_data.begin () + pos, m_data.begin () + pos + 2 + m_data[pos + 1]);
+      pos = m_data.size ();
+    }
+  if (pos == m_data.size ())
+    {
+      m_data.resize (pos + 2 + len);
+      m_data[pos] = option;
+      m_data[pos + 1] = len;
+    }
+  if (len > 0)
+    {
+      std::memcpy (&m_data[pos + 2], value, len);
+    }
+}
+
+const uint8_t * DhcpHeader::GetOption (uint8_t option, uint8_t &len) const
+{
+  uint32_t pos = FindOption (option);
+  if (pos == m_data.size ())
+    {
+      len = 0;
+      return 0;
+    }
+  len = m_data[pos + 1];
+  return &m_data[pos + 2];
+}
+
+bool DhcpHeader::HasOption (uint8_t option) const
+{
+  return FindOption (option) != m_data.size ();
+}
+
+void DhcpHeader::RemoveOption (uint8_t option)
+{
+  uint32_t pos = FindOption (option);
+  if (pos < m_data.size ())
+    {
+      m_data.erase (m_data.begin () + pos, m_data.begin () + pos + 2 + m_data[pos + 1]);
+    }
+}
+
+void DhcpHeader::SetOption32 (uint8_t option, uint32_t value)
+{
+  uint8_t buf[4];
+  buf[0] = (value >> 24) & 0xff;
+  buf[1] = (value >> 16) & 0xff;
+  buf[2] = (value >> 8) & 0xff;
+  buf[3] = value & 0xff;
+  SetOption (option, buf, 4);
+}
+
+uint32_t DhcpHeader::GetOption32 (uint8_t option) const
+{
+  uint8_t len;
+  const uint8_t *value = GetOption (option, len);
+  if (value == 0 || len < 4)
+    {
+      return 0;
+    }
+  return (value[0] << 24) | (value[1] << 16) | (value[2] << 8) | value[3];
 }
 
 void DhcpHeader::SetGiAddr (Ipv4Address giAddr)
@@ -257,17 +324,12 @@ Ipv4Address DhcpHeader::GetGiAddr ()
 
 void DhcpHeader::ResetOpt ()
 {
-  m_len = 241;
-  int i;
-  for (i = 0; i < OP_END; i++)
-    {
-      m_opt[i] = false;
-    }
+  m_data.resize (GetOptionsStart ());
 }
 
 uint32_t DhcpHeader::GetSerializedSize (void) const
 {
-  return m_len;
+  return OFFSET_OPTIONS + (m_data.size () - GetOptionsStart ()) + 1;
 }
 
 TypeId DhcpHeader::GetTypeId (void)
@@ -287,7 +349,7 @@ TypeId DhcpHeader::GetInstanceTypeId (void) const
 
 void DhcpHeader::Print (std::ostream &os) const
 {
-  os << "(type=" << m_op << ")";
+  os << "(type=" << (uint32_t) GetType () << ")";
 }
 
 void
@@ -306,64 +368,27 @@ DhcpHeader::Serialize (Buffer::Iterator start) const
   WriteTo (i, m_siAddr);
   WriteTo (i, m_giAddr);
   i.Write (m_chaddr, 16);
-  i.Write (m_sname,64);
-  i.Write (m_file,128);
-  i.Write (m_magic_cookie,4);
-  if (m_opt[OP_MASK])
-    {
-      i.WriteU8 (OP_MASK);
-      i.WriteU8 (4);
-      i.WriteHtonU32 (m_mask);
-    }
-  if (m_opt[OP_MSGTYPE])
-    {
-      i.WriteU8 (OP_MSGTYPE);
-      i.WriteU8 (1);
-      i.WriteU8 ((m_op + 1));
-    }
-  if (m_opt[OP_ADDREQ])
-    {
-      i.WriteU8 (OP_ADDREQ);
-      i.WriteU8 (4);
-      WriteTo (i, m_req);
-    }
-  if (m_opt[OP_SERVID])
+  if (m_bootFields)
     {
-      i.WriteU8 (OP_SERVID);
-      i.WriteU8 (4);
-      WriteTo (i, m_dhcps);
+      i.Write (&m_data[0], BOOT_FIELDS_SIZE);
     }
-  if (m_opt[OP_ROUTE])
+  else
     {
-      i.WriteU8 (OP_ROUTE);
-      i.WriteU8 (4);
-      WriteTo (i, m_route);
+      i.WriteU8 (0, BOOT_FIELDS_SIZE);
     }
-  if (m_opt[OP_LEASE])
+  i.WriteHtonU32 (MAGIC_COOKIE);
+  uint32_t optionsStart = GetOptionsStart ();
+  if (m_data.size () > optionsStart)
     {
-      i.WriteU8 (OP_LEASE);
-      i.WriteU8 (4);
-      i.WriteHtonU32 (m_lease);
-    }
-  if (m_opt[OP_RENEW])
-    {
-      i.WriteU8 (OP_RENEW);
-      i.WriteU8 (4);
-      i.WriteHtonU32 (m_renew);
-    }
-  if (m_opt[OP_REBIND])
-    {
-      i.WriteU8 (OP_REBIND);
-      i.WriteU8 (4);
-      i.WriteHtonU32 (m_rebind);
+      i.Write (&m_data[optionsStart], m_data.size () - optionsStart);
     }
   i.WriteU8 (OP_END);
 }
 
 uint32_t DhcpHeader::Deserialize (Buffer::Iterator start)
 {
-  uint32_t len, clen = start.GetSize ();
-  if (clen < 240)
+  uint32_t len, clen = start.GetRemainingSize ();
+  if (clen < OFFSET_OPTIONS)
     {
       NS_LOG_WARN ("Malformed Packet");
       return 0;
@@ -381,147 +406,70 @@ uint32_t DhcpHeader::Deserialize (Buffer::Iterator start)
   ReadFrom (i, m_siAddr);
   ReadFrom (i, m_giAddr);
   i.Read (m_chaddr, 16);
-  i.Read (m_sname, 64);
-  i.Read (m_file, 128);
-  i.Read (m_magic_cookie, 4);
-  if ( m_magic_cookie[0] != 99 || m_magic_cookie[1] != 130 || m_magic_cookie[2] != 83 || m_magic_cookie[3] != 99)
+
+  // sname and file are almost always empty, they are kept only otherwise
+  uint8_t bootFields[BOOT_FIELDS_SIZE];
+  i.Read (bootFields, BOOT_FIELDS_SIZE);
+  m_bootFields = false;
+  for (uint32_t b = 0; b < BOOT_FIELDS_SIZE && !m_bootFields; b++)
+    {
+      m_bootFields = (bootFields[b] != 0);
+    }
+  m_data.clear ();
+  if (m_bootFields)
+    {
+      m_data.assign (bootFields, bootFields + BOOT_FIELDS_SIZE);
+    }
+
+  if (i.ReadNtohU32 () != MAGIC_COOKIE)
     {
       NS_LOG_WARN ("Malformed Packet");
       return 0;
     }
-  len = 240;
-  uint8_t option;
-  bool loop = true;
-  do
+  len = OFFSET_OPTIONS;
+
+  // Every option is kept, whether this class knows it or not
+  while (true)
     {
-      if (len + 1 <= clen)
+      if (len + 1 > clen)
         {
-          option = i.ReadU8 ();
-          len += 1;
+          NS_LOG_WARN ("Malformed Packet");
+          return 0;
         }
-      else
+      uint8_t option = i.ReadU8 ();
+      len += 1;
+      if (option == OP_END)
+        {
+          break;
+        }
+      if (option == OP_PAD)
+        {
+          continue;
+        }
+      if (len + 1 > clen)
         {
           NS_LOG_WARN ("Malformed Packet");
           return 0;
         }
-      switch (option)
+      uint8_t optionLen = i.ReadU8 ();
+      len += 1;
+      if (len + optionLen > clen)
         {
-        case OP_MASK:
-          if (len + 5 < clen)
-            {
-              i.ReadU8 ();
-              m_mask = i.ReadNtohU32 ();
-              len += 5;
-            }
-          else
-            {
-              NS_LOG_WARN ("Malformed Packet");
-              return 0;
-            }
-          break;
-        case OP_ROUTE:
-          if (len + 5 < clen)
-            {
-              i.ReadU8 ();
-              ReadFrom (i, m_route);
-              len += 5;
-            }
-          else
-            {
-              NS_LOG_WARN ("Malformed Packet");
-              return 0;
-            }
-          break;
-        case OP_MSGTYPE:
-          if (len + 2 < clen)
-            {
-              i.ReadU8 ();
-              m_op = (i.ReadU8 () - 1);
-              len += 2;
-            }
-          else
-            {
-              NS_LOG_WARN ("Malformed Packet");
-              return 0;
-            }
-          break;
-        case OP_SERVID:
-          if (len + 5 < clen)
-            {
-              i.ReadU8 ();
-              ReadFrom (i, m_dhcps);
-              len += 5;
-            }
-          else
-            {
-              NS_LOG_WARN ("Malformed Packet");
-              return 0;
-            }
-          break;
-        case OP_ADDREQ:
-          if (len + 5 < clen)
-            {
-              i.ReadU8 ();
-              ReadFrom (i, m_req);
-              len += 5;
-            }
-          else
-            {
-              NS_LOG_WARN ("Malformed Packet");
-              return 0;
-            }
-          break;
-        case OP_LEASE:
-          if (len + 5 < clen)
-            {
-              i.ReadU8 ();
-              m_lease = i.ReadNtohU32 ();
-              len += 5;
-            }
-          else
-            {
-              NS_LOG_WARN ("Malformed Packet");
-              return 0;
-            }
-          break;
-        case OP_RENEW:
-          if (len + 5 < clen)
-            {
-              i.ReadU8 ();
-              m_renew = i.ReadNtohU32 ();
-              len += 5;
-            }
-          else
-            {
-              NS_LOG_WARN ("Malformed Packet");
-              return 0;
-            }
-          break;
-        case OP_REBIND:
-          if (len + 5 < clen)
-            {
-              i.ReadU8 ();
-              m_rebind = i.ReadNtohU32 ();
-              len += 5;
-            }
-          else
-            {
-              NS_LOG_WARN ("Malformed Packet");
-              return 0;
-            }
-          break;
-        case OP_END:
-          loop = false;
-          break;
-        default:
           NS_LOG_WARN ("Malformed Packet");
           return 0;
         }
+      uint32_t pos = m_data.size ();
+      m_data.resize (pos + 2 + optionLen);
+      m_data[pos] = option;
+      m_data[pos + 1] = optionLen;
+      if (optionLen > 0)
+        {
+          i.Read (&m_data[pos + 2], optionLen);
+        }
+      len += optionLen;
     }
-  while (loop);
 
-  m_len = len;
-  return m_len;
+  return len;
 }
 
 } // namespace ns3
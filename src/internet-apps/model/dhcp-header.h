@@ -28,6 +28,7 @@
 #include "ns3/header.h"
 #include <ns3/mac48-address.h>
 #include <ns3/mac64-address.h>
+#include <vector>
 
 namespace ns3 {
 
@@ -43,7 +44,11 @@ namespace ns3 {
  * \brief BOOTP header with DHCP messages supports the following options:
  *        Subnet Mask (1), Address Request (50), Refresh Lease Time (51),
  *        DHCP Message Type (53), DHCP Server ID (54), Renew Time (58),
- *        Rebind Time (59) and End (255) of BOOTP
+ *        Rebind Time (59), Rapid Commit (80) and End (255) of BOOTP
+ *
+ * The options are stored as they appear in the message, so that any other
+ * option is kept by Deserialize and written back by Serialize. They can be
+ * accessed with SetOption, GetOption and RemoveOption.
 
   \verbatim
     0                   1                   2                   3
@@ -102,15 +107,33 @@ public:
   /// BOOTP options
   enum Options
   {
-    OP_MASK = 1,        //!< BOOTP Option 1: Address Mask
-    OP_ROUTE = 3,       //!< BOOTP Option 3: Router Option
-    OP_ADDREQ = 50,     //!< BOOTP Option 50: Requested Address
-    OP_LEASE = 51,      //!< BOOTP Option 51: Address Lease Time
-    OP_MSGTYPE = 53,    //!< BOOTP Option 53: DHCP Message Type
-    OP_SERVID = 54,     //!< BOOTP Option 54: Server Identifier
-    OP_RENEW = 58,      //!< BOOTP Option 58: Address Renewal Time
-    OP_REBIND = 59,     //!< BOOTP Option 59: Address Rebind Time
-    OP_END = 255        //!< BOOTP Option 255: END
+    OP_PAD = 0,           //!< BOOTP Option 0: Pad
+    OP_MASK = 1,          //!< BOOTP Option 1: Address Mask
+    OP_ROUTE = 3,         //!< BOOTP Option 3: Router Option
+    OP_ADDREQ = 50,       //!< BOOTP Option 50: Requested Address
+    OP_LEASE = 51,        //!< BOOTP Option 51: Address Lease Time
+    OP_MSGTYPE = 53,      //!< BOOTP Option 53: DHCP Message Type
+    OP_SERVID = 54,       //!< BOOTP Option 54: Server Identifier
+    OP_RENEW = 58,        //!< BOOTP Option 58: Address Renewal Time
+    OP_REBIND = 59,       //!< BOOTP Option 59: Address Rebind Time
+    OP_RAPID_COMMIT = 80, //!< BOOTP Option 80: Rapid Commit
+    OP_AGENT_INFO = 82,   //!< BOOTP Option 82: Relay Agent Information
+    OP_END = 255          //!< BOOTP Option 255: END
+  };
+
+  /// Offsets of the fixed fields in a serialized message
+  enum Offsets
+  {
+    OFFSET_OP = 0,         //!< BOOTP message type
+    OFFSET_HOPS = 3,       //!< Number of relay agents crossed
+    OFFSET_XID = 4,        //!< Transaction id
+    OFFSET_SECS = 8,       //!< Seconds elapsed
+    OFFSET_CIADDR = 12,    //!< Client IP address
+    OFFSET_YIADDR = 16,    //!< Your (client) IP address
+    OFFSET_GIADDR = 24,    //!< Gateway IP address
+    OFFSET_CHADDR = 28,    //!< Client hardware address
+    OFFSET_COOKIE = 236,   //!< DHCP magic cookie
+    OFFSET_OPTIONS = 240   //!< First option
   };
 
   /// DHCP messages
@@ -119,8 +142,11 @@ public:
     DHCPDISCOVER = 0,     //!< Code for DHCP Discover
     DHCPOFFER = 1,        //!< Code for DHCP Offer
     DHCPREQ = 2,          //!< Code for DHCP Request
+    DHCPDECLINE = 3,      //!< Code for DHCP Decline
     DHCPACK = 4,          //!< Code for DHCP ACK
-    DHCPNACK = 5          //!< Code for DHCP NACK
+    DHCPNACK = 5,         //!< Code for DHCP NACK
+    DHCPRELEASE = 6,      //!< Code for DHCP Release
+    DHCPINFORM = 7        //!< Code for DHCP Inform
   };
 
   /**
@@ -184,6 +210,24 @@ public:
    */
   Address GetChaddr (void);
 
+  /**
+   * \brief Get the raw chaddr field of the message.
+   * \return Pointer to the 16 bytes of the chaddr field
+   */
+  const uint8_t * GetChaddrBuffer (void) const;
+
+  /**
+   * \brief Set the IPv4Address the client is already using (ciaddr)
+   * \param addr The client Ipv4Address
+   */
+  void SetCiaddr (Ipv4Address addr);
+
+  /**
+   * \brief Get the IPv4Address the client is already using (ciaddr)
+   * \return IPv4Address of the client
+   */
+  Ipv4Address GetCiaddr (void) const;
+
   /**
    * \brief Set the IPv4Address of the client
    * \param addr The client Ipv4Address
@@ -280,6 +324,57 @@ public:
    */
   uint32_t GetRebind (void) const;
 
+  /**
+   * \brief Add the Rapid Commit option (RFC 4039)
+   *
+   * In a DISCOVER, the client accepts an ACK straight away. In an ACK, the
+   * server committed the lease without waiting for a REQUEST.
+   */
+  void SetRapidCommit (void);
+
+  /**
+   * \brief Check whether the Rapid Commit option is present
+   * \return true if the message carries the Rapid Commit option
+   */
+  bool IsRapidCommit (void) const;
+
+  /**
+   * \brief Set the value of an option
+   *
+   * The value replaces the one of the option if it is already present,
+   * otherwise the option is added after the others.
+   *
+   * \param option The option code
+   * \param value The value of the option
+   * \param len The length of the value
+   */
+  void SetOption (uint8_t option, const uint8_t *value, uint8_t len);
+
+  /**
+   * \brief Get the value of an option
+   *
+   * The returned pointer is valid until the options of the header are
+   * modified.
+   *
+   * \param option The option code
+   * \param len Set to the length of the value
+   * \return The value of the option, or 0 if the option is absent
+   */
+  const uint8_t * GetOption (uint8_t option, uint8_t &len) const;
+
+  /**
+   * \brief Check whether an option is present
+   * \param option The option code
+   * \return true if the message carries the option
+   */
+  bool HasOption (uint8_t option) const;
+
+  /**
+   * \brief Remove an option, if present
+   * \param option The option code
+   */
+  void RemoveOption (uint8_t option);
+
   /**
    * \brief Set the gateway address for a header
    * \param giAddr Ipv4Address of gateway
@@ -298,20 +393,44 @@ public:
   void ResetOpt ();
 
 private:
+  /**
+   * \brief Get the position of the first option in m_data
+   * \return The position of the first option
+   */
+  uint32_t GetOptionsStart (void) const;
+
+  /**
+   * \brief Find an option in m_data
+   * \param option The option code
+   * \return The position of the option code, or the size of m_data if the option is absent
+   */
+  uint32_t FindOption (uint8_t option) const;
+
+  /**
+   * \brief Set a 4-byte option
+   * \param option The option code
+   * \param value The value of the option in host order
+   */
+  void SetOption32 (uint8_t option, uint32_t value);
+
+  /**
+   * \brief Read a 4-byte option
+   * \param option The option code
+   * \return The value of the option in host order, or 0 if the option is absent
+   */
+  uint32_t GetOption32 (uint8_t option) const;
+
   virtual TypeId GetInstanceTypeId (void) const;
   virtual void Print (std::ostream &os) const;
   virtual uint32_t GetSerializedSize (void) const;
   virtual void Serialize (Buffer::Iterator start) const;
   virtual uint32_t Deserialize (Buffer::Iterator start);
 
-  uint8_t m_op;                          //!< The DHCP Message type
   uint8_t m_bootp;                       //!< The BOOTP Message type
   uint8_t m_hType;                       //!< The hardware type
   uint8_t m_hLen;                        //!< The hardware length
   uint8_t m_hops;                        //!< The number of hops covered by the message
   uint32_t m_xid;                        //!< The transaction number
-  uint32_t m_mask;                       //!< The mask of the network
-  uint32_t m_len;                        //!< The length of the header
   uint16_t m_secs;                       //!< Seconds elapsed
   uint16_t m_flags;                      //!< BOOTP flags
   uint8_t m_chaddr[16];                  //!< The address identifier
@@ -319,16 +438,13 @@ private:
   Ipv4Address m_ciAddr;                  //!< The IP address of the client
   Ipv4Address m_siAddr;                  //!< Next Server IP address
   Ipv4Address m_giAddr;                  //!< Gateway IP address
-  Ipv4Address m_dhcps;                   //!< DHCP server IP address
-  Ipv4Address m_req;                     //!< Requested Address
-  Ipv4Address m_route;                   //!< Router Option Address
-  uint8_t m_sname[64];                   //!< Server name (Padded for now)
-  uint8_t m_file[128];                   //!< File name (Padded for now)
-  uint8_t m_magic_cookie[4];             //!< DHCP Magic Cookie
-  uint32_t m_lease;                      //!< The lease time of the address
-  uint32_t m_renew;                      //!< The renewal time for the client
-  uint32_t m_rebind;                     //!< The rebinding time for the client
-  bool m_opt[255];                       //!< BOOTP option list
+  bool m_bootFields;                     //!< Whether m_data starts with the sname and file fields
+  /**
+   * The sname and file fields (192 bytes), only when one of them is not
+   * empty, followed by the options (code, length and value) in the order
+   * of the message. Pad and End are not stored.
+   */
+  std::vector<uint8_t> m_data;
 };
 
 } // namespace ns3
@@ -0,0 +1,133 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "ns3/output-stream-wrapper.h"
+#include "dhcp-interface-monitor.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("DhcpInterfaceMonitor");
+NS_OBJECT_ENSURE_REGISTERED (DhcpInterfaceMonitor);
+
+TypeId
+DhcpInterfaceMonitor::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DhcpInterfaceMonitor")
+    .SetParent<Ipv4RoutingProtocol> ()
+    .SetGroupName ("Internet-Apps")
+    .AddConstructor<DhcpInterfaceMonitor> ()
+  ;
+  return tid;
+}
+
+DhcpInterfaceMonitor::DhcpInterfaceMonitor ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+DhcpInterfaceMonitor::~DhcpInterfaceMonitor ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DhcpInterfaceMonitor::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_ipv4 = 0;
+  m_interfaceChanged = MakeNullCallback<void, uint32_t> ();
+  Ipv4RoutingProtocol::DoDispose ();
+}
+
+void
+DhcpInterfaceMonitor::SetInterfaceChangedCallback (Callback<void, uint32_t> cb)
+{
+  m_interfaceChanged = cb;
+}
+
+Ptr<Ipv4Route>
+DhcpInterfaceMonitor::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif, Socket::SocketErrno &sockerr)
+{
+  sockerr = Socket::ERROR_NOROUTETOHOST;
+  return 0;
+}
+
+bool
+DhcpInterfaceMonitor::RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                                  UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+                                  LocalDeliverCallback lcb, ErrorCallback ecb)
+{
+  return false;
+}
+
+void
+DhcpInterfaceMonitor::NotifyInterfaceUp (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+  if (!m_interfaceChanged.IsNull ())
+    {
+      m_interfaceChanged (interface);
+    }
+}
+
+void
+DhcpInterfaceMonitor::NotifyInterfaceDown (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+  if (!m_interfaceChanged.IsNull ())
+    {
+      m_interfaceChanged (interface);
+    }
+}
+
+void
+DhcpInterfaceMonitor::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
+{
+  NS_LOG_FUNCTION (this << interface << address);
+  if (!m_interfaceChanged.IsNull ())
+    {
+      m_interfaceChanged (interface);
+    }
+}
+
+void
+DhcpInterfaceMonitor::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
+{
+  NS_LOG_FUNCTION (this << interface << address);
+  if (!m_interfaceChanged.IsNull ())
+    {
+      m_interfaceChanged (interface);
+    }
+}
+
+void
+DhcpInterfaceMonitor::SetIpv4 (Ptr<Ipv4> ipv4)
+{
+  NS_LOG_FUNCTION (this << ipv4);
+  m_ipv4 = ipv4;
+}
+
+void
+DhcpInterfaceMonitor::PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const
+{
+  *stream->GetStream () << "DhcpInterfaceMonitor: no route" << std::endl;
+}
+
+} // namespace ns3
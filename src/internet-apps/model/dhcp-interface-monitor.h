@@ -0,0 +1,85 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef DHCP_INTERFACE_MONITOR_H
+#define DHCP_INTERFACE_MONITOR_H
+
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4.h"
+#include "ns3/callback.h"
+#include "ns3/ptr.h"
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup dhcp
+ *
+ * \class DhcpInterfaceMonitor
+ * \brief Reports the changes of the IPv4 interfaces of a node
+ *
+ * IPv4 notifies the interface state and address changes only to the
+ * routing protocol. This routing protocol has no route: added to the
+ * Ipv4ListRouting of a node with the lowest priority, it does not change
+ * the routing, and calls back its owner for each change of an interface.
+ */
+class DhcpInterfaceMonitor : public Ipv4RoutingProtocol
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  DhcpInterfaceMonitor ();
+  virtual ~DhcpInterfaceMonitor ();
+
+  /**
+   * \brief Set the function called when an interface changes
+   *
+   * The function gets the index of the interface, after the change.
+   *
+   * \param cb The function, or a null callback to stop the notifications
+   */
+  void SetInterfaceChangedCallback (Callback<void, uint32_t> cb);
+
+  // Inherited
+  virtual Ptr<Ipv4Route> RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif, Socket::SocketErrno &sockerr);
+  virtual bool RouteInput  (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                            UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+                            LocalDeliverCallback lcb, ErrorCallback ecb);
+  virtual void NotifyInterfaceUp (uint32_t interface);
+  virtual void NotifyInterfaceDown (uint32_t interface);
+  virtual void NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address);
+  virtual void NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address);
+  virtual void SetIpv4 (Ptr<Ipv4> ipv4);
+  virtual void PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  Ptr<Ipv4> m_ipv4;                                //!< The IPv4 stack of the node
+  Callback<void, uint32_t> m_interfaceChanged;     //!< Called for each change of an interface
+};
+
+} // namespace ns3
+
+#endif /* DHCP_INTERFACE_MONITOR_H */
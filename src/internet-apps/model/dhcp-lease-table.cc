@@ -0,0 +1,243 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "dhcp-lease-table.h"
+#include <cstring>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("DhcpLeaseTable");
+
+const uint32_t DhcpLeaseTable::NONE;
+
+/// Initial number of hash table slots
+static const uint32_t INITIAL_SLOTS = 64;
+
+Address
+DhcpLeaseTable::Lease::GetChaddr (void) const
+{
+  Address addr;
+  addr.CopyFrom (chaddr, 16);
+  return addr;
+}
+
+DhcpLeaseTable::ExpiredQueue::ExpiredQueue ()
+  : head (NONE),
+    tail (NONE)
+{
+}
+
+DhcpLeaseTable::DhcpLeaseTable ()
+  : m_slots (INITIAL_SLOTS, NONE),
+    m_nLeases (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+DhcpLeaseTable::Hash (const uint8_t *chaddr)
+{
+  uint64_t lo;
+  uint64_t hi;
+  std::memcpy (&lo, chaddr, 8);
+  std::memcpy (&hi, chaddr + 8, 8);
+
+  // Multiplicative mixing of both halves, then fold the high bits down
+  uint64_t h = lo * 0x9e3779b97f4a7c15ULL ^ hi * 0xc2b2ae3d27d4eb4fULL;
+  h ^= h >> 29;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 32;
+  return static_cast<uint32_t> (h);
+}
+
+uint32_t
+DhcpLeaseTable::FindSlot (const uint8_t *chaddr) const
+{
+  uint32_t mask = m_slots.size () - 1;
+  uint32_t slot = Hash (chaddr) & mask;
+  while (m_slots[slot] != NONE
+         && std::memcmp (m_leases[m_slots[slot]].chaddr, chaddr, 16) != 0)
+    {
+      slot = (slot + 1) & mask;
+    }
+  return slot;
+}
+
+uint32_t
+DhcpLeaseTable::Find (const uint8_t *chaddr) const
+{
+  return m_slots[FindSlot (chaddr)];
+}
+
+uint32_t
+DhcpLeaseTable::Insert (const uint8_t *chaddr)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (2 * (m_nLeases + 1) > m_slots.size ())
+    {
+      Grow ();
+    }
+
+  uint32_t slot = FindSlot (chaddr);
+  NS_ASSERT_MSG (m_slots[slot] == NONE, "The client has already a lease");
+
+  uint32_t index;
+  if (!m_freeLeases.empty ())
+    {
+      index = m_freeLeases.back ();
+      m_freeLeases.pop_back ();
+    }
+  else
+    {
+      index = m_leases.size ();
+      m_leases.push_back (Lease ());
+    }
+
+  Lease &lease = m_leases[index];
+  std::memcpy (lease.chaddr, chaddr, 16);
+  lease.address = Ipv4Address ();
+  lease.state = LEASE_ACTIVE;
+  lease.expiry = Time ();
+  lease.pool = NONE;
+  lease.prevExpired = NONE;
+  lease.nextExpired = NONE;
+
+  m_slots[slot] = index;
+  m_nLeases++;
+  return index;
+}
+
+void
+DhcpLeaseTable::Remove (uint32_t index)
+{
+  NS_LOG_FUNCTION (this << index);
+  NS_ASSERT_MSG (index < m_leases.size () && m_leases[index].state != LEASE_FREE,
+                 "Removing a lease that does not exist");
+
+  uint32_t mask = m_slots.size () - 1;
+  uint32_t slot = FindSlot (m_leases[index].chaddr);
+
+  // Backward shift deletion: move up the following entries of the probe
+  // sequence, so that no tombstone is needed.
+  uint32_t next = (slot + 1) & mask;
+  while (m_slots[next] != NONE)
+    {
+      uint32_t home = Hash (m_leases[m_slots[next]].chaddr) & mask;
+      if (((next - home) & mask) >= ((next - slot) & mask))
+        {
+          m_slots[slot] = m_slots[next];
+          slot = next;
+        }
+      next = (next + 1) & mask;
+    }
+  m_slots[slot] = NONE;
+
+  m_leases[index].state = LEASE_FREE;
+  m_freeLeases.push_back (index);
+  m_nLeases--;
+}
+
+DhcpLeaseTable::Lease &
+DhcpLeaseTable::Get (uint32_t index)
+{
+  NS_ASSERT_MSG (index < m_leases.size (), "Accessing a lease that does not exist");
+  return m_leases[index];
+}
+
+void
+DhcpLeaseTable::PushExpired (ExpiredQueue &queue, uint32_t index)
+{
+  NS_LOG_FUNCTION (this << index);
+
+  Lease &lease = m_leases[index];
+  lease.prevExpired = queue.tail;
+  lease.nextExpired = NONE;
+  if (queue.tail != NONE)
+    {
+      m_leases[queue.tail].nextExpired = index;
+    }
+  else
+    {
+      queue.head = index;
+    }
+  queue.tail = index;
+}
+
+void
+DhcpLeaseTable::RemoveExpired (ExpiredQueue &queue, uint32_t index)
+{
+  NS_LOG_FUNCTION (this << index);
+
+  Lease &lease = m_leases[index];
+  if (lease.prevExpired != NONE)
+    {
+      m_leases[lease.prevExpired].nextExpired = lease.nextExpired;
+    }
+  else
+    {
+      queue.head = lease.nextExpired;
+    }
+  if (lease.nextExpired != NONE)
+    {
+      m_leases[lease.nextExpired].prevExpired = lease.prevExpired;
+    }
+  else
+    {
+      queue.tail = lease.prevExpired;
+    }
+  lease.prevExpired = NONE;
+  lease.nextExpired = NONE;
+}
+
+uint32_t
+DhcpLeaseTable::GetNLeases (void) const
+{
+  return m_nLeases;
+}
+
+void
+DhcpLeaseTable::Clear (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_leases.clear ();
+  m_freeLeases.clear ();
+  m_slots.assign (INITIAL_SLOTS, NONE);
+  m_nLeases = 0;
+}
+
+void
+DhcpLeaseTable::Grow (void)
+{
+  NS_LOG_FUNCTION (this << m_slots.size ());
+
+  m_slots.assign (2 * m_slots.size (), NONE);
+  for (uint32_t index = 0; index < m_leases.size (); index++)
+    {
+      if (m_leases[index].state != LEASE_FREE)
+        {
+          m_slots[FindSlot (m_leases[index].chaddr)] = index;
+        }
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,176 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef DHCP_LEASE_TABLE_H
+#define DHCP_LEASE_TABLE_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/address.h"
+#include "ns3/nstime.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup dhcp
+ *
+ * \class DhcpLeaseTable
+ * \brief Leases of a DHCP server, indexed by the 16-byte client chaddr
+ *
+ * The leases are stored contiguously and are referred to by their index,
+ * which does not change while the lease exists. The index of a chaddr is
+ * found through an open-addressing (linear probing) hash table, kept at
+ * most half full so that a lookup usually takes a single probe.
+ */
+class DhcpLeaseTable
+{
+public:
+  /// State of a lease
+  enum LeaseState
+  {
+    LEASE_FREE,     //!< Unused entry
+    LEASE_ACTIVE,   //!< Address leased until the expiry time
+    LEASE_EXPIRED,  //!< Lease expired, the address can be given to another client
+    LEASE_STATIC    //!< Static entry, the lease never expires
+  };
+
+  /// A lease of the table
+  struct Lease
+  {
+    uint8_t chaddr[16];    //!< Client chaddr
+    Ipv4Address address;   //!< Leased address
+    LeaseState state;      //!< State of the lease
+    Time expiry;           //!< Absolute expiry time (LEASE_ACTIVE only)
+    uint32_t pool;         //!< Index of the server address pool holding the address
+    uint32_t prevExpired;  //!< Previous lease of the expired queue (LEASE_EXPIRED only)
+    uint32_t nextExpired;  //!< Next lease of the expired queue (LEASE_EXPIRED only)
+
+    /**
+     * \brief Get the client chaddr as an Address
+     * \return The chaddr of the client
+     */
+    Address GetChaddr (void) const;
+  };
+
+  static const uint32_t NONE = 0xffffffff; //!< Index returned when there is no lease
+
+  /**
+   * \brief Queue of expired leases, oldest first
+   *
+   * The queue is linked through the prevExpired / nextExpired fields of
+   * its leases, so that a lease can be unlinked in constant time.
+   */
+  struct ExpiredQueue
+  {
+    ExpiredQueue ();
+    uint32_t head;  //!< Oldest expired lease, or NONE
+    uint32_t tail;  //!< Most recently expired lease, or NONE
+  };
+
+  DhcpLeaseTable ();
+
+  /**
+   * \brief Find the lease of a client
+   * \param chaddr The 16-byte chaddr of the client
+   * \return The index of the lease, or NONE
+   */
+  uint32_t Find (const uint8_t *chaddr) const;
+
+  /**
+   * \brief Create the lease of a client which has none
+   *
+   * The lease is created in the LEASE_ACTIVE state, with no address.
+   *
+   * \param chaddr The 16-byte chaddr of the client
+   * \return The index of the new lease
+   */
+  uint32_t Insert (const uint8_t *chaddr);
+
+  /**
+   * \brief Remove a lease
+   * \param index The index of the lease
+   */
+  void Remove (uint32_t index);
+
+  /**
+   * \brief Get a lease
+   *
+   * A removed lease is left in the LEASE_FREE state until its index is
+   * reused by another client.
+   *
+   * \param index The index of the lease
+   * \return The lease
+   */
+  Lease & Get (uint32_t index);
+
+  /**
+   * \brief Append an expired lease to an expired queue
+   * \param queue The queue
+   * \param index The index of the lease
+   */
+  void PushExpired (ExpiredQueue &queue, uint32_t index);
+
+  /**
+   * \brief Unlink a lease from the expired queue holding it
+   * \param queue The queue
+   * \param index The index of the lease
+   */
+  void RemoveExpired (ExpiredQueue &queue, uint32_t index);
+
+  /**
+   * \brief Get the number of leases in the table
+   * \return The number of leases
+   */
+  uint32_t GetNLeases (void) const;
+
+  /**
+   * \brief Remove all the leases
+   */
+  void Clear (void);
+
+  /**
+   * \brief Hash a chaddr
+   * \param chaddr The 16-byte chaddr
+   * \return The hash of the chaddr
+   */
+  static uint32_t Hash (const uint8_t *chaddr);
+
+private:
+  /**
+   * \brief Find the slot of a chaddr
+   * \param chaddr The 16-byte chaddr
+   * \return The slot holding the chaddr, or the empty slot ending its probe sequence
+   */
+  uint32_t FindSlot (const uint8_t *chaddr) const;
+
+  /**
+   * \brief Double the number of slots and rehash the leases
+   */
+  void Grow (void);
+
+  std::vector<Lease> m_leases;         //!< Leases, including the free entries
+  std::vector<uint32_t> m_freeLeases;  //!< Indexes of the free entries of m_leases
+  std::vector<uint32_t> m_slots;       //!< Hash table slots (lease index or NONE), power of two
+  uint32_t m_nLeases;                  //!< Number of leases in use
+};
+
+} // namespace ns3
+
+#endif /* DHCP_LEASE_TABLE_H */
@@ -0,0 +1,521 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/ipv4.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/socket.h"
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/uinteger.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+#include "dhcp-load-generator.h"
+#include "dhcp-header.h"
+#include "dhcp-header-view.h"
+#include <algorithm>
+#include <functional>
+#include <cstring>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("DhcpLoadGenerator");
+NS_OBJECT_ENSURE_REGISTERED (DhcpLoadGenerator);
+
+TypeId
+DhcpLoadGenerator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DhcpLoadGenerator")
+    .SetParent<Application> ()
+    .AddConstructor<DhcpLoadGenerator> ()
+    .SetGroupName ("Internet-Apps")
+    .AddAttribute ("Clients", "Number of clients emulated",
+                   UintegerValue (1000),
+                   MakeUintegerAccessor (&DhcpLoadGenerator::m_nClients),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("FirstChaddr", "chaddr of the first client, the next clients take the next addresses",
+                   Mac48AddressValue (Mac48Address ("02:00:00:00:00:01")),
+                   MakeMac48AddressAccessor (&DhcpLoadGenerator::m_firstChaddr),
+                   MakeMac48AddressChecker ())
+    .AddAttribute ("StartInterval", "Time between the first DISCOVERs of two clients",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&DhcpLoadGenerator::m_startInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("RTRS", "Time for the first retransmission of the DISCOVER and REQUEST messages, "
+                   "doubled at each retransmission",
+                   TimeValue (Seconds (4)),
+                   MakeTimeAccessor (&DhcpLoadGenerator::m_rtrs),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxRtrs", "Maximum time between two retransmissions",
+                   TimeValue (Seconds (64)),
+                   MakeTimeAccessor (&DhcpLoadGenerator::m_maxRtrs),
+                   MakeTimeChecker ())
+    .AddAttribute ("RtrsJitter",
+                   "Random time in seconds added to each retransmission delay",
+                   StringValue ("ns3::UniformRandomVariable[Min=-1.0|Max=1.0]"),
+                   MakePointerAccessor (&DhcpLoadGenerator::m_rtrsJitter),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddAttribute ("Transactions",
+                   "The possible value of transaction numbers ",
+                   StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=1000000.0]"),
+                   MakePointerAccessor (&DhcpLoadGenerator::m_ran),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddTraceSource ("BoundClients",
+                     "Number of clients holding a lease",
+                     MakeTraceSourceAccessor (&DhcpLoadGenerator::m_nBound),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("Retransmissions",
+                     "Number of DISCOVER and REQUEST messages sent again for lack of reply",
+                     MakeTraceSourceAccessor (&DhcpLoadGenerator::m_retransmissions),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("NewLease",
+                     "Get a NewLease",
+                     MakeTraceSourceAccessor (&DhcpLoadGenerator::m_newLease),
+                     "ns3::Ipv4Address::TracedCallback")
+    .AddTraceSource ("ExpireLease",
+                     "A lease expires",
+                     MakeTraceSourceAccessor (&DhcpLoadGenerator::m_expiry),
+                     "ns3::Ipv4Address::TracedCallback");
+  return tid;
+}
+
+DhcpLoadGenerator::DhcpLoadGenerator ()
+  : m_socket (0),
+    m_firstChaddrValue (0),
+    m_nBound (0),
+    m_retransmissions (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+DhcpLoadGenerator::~DhcpLoadGenerator ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DhcpLoadGenerator::SetDhcpClientNetDevice (Ptr<NetDevice> netDevice)
+{
+  m_device = netDevice;
+}
+
+Ptr<NetDevice>
+DhcpLoadGenerator::GetDhcpClientNetDevice (void) const
+{
+  return m_device;
+}
+
+uint32_t
+DhcpLoadGenerator::GetNBound (void) const
+{
+  return m_nBound;
+}
+
+Ipv4Address
+DhcpLoadGenerator::GetAddress (uint32_t client) const
+{
+  NS_ASSERT_MSG (client < m_clients.size (), "No client " << client);
+  const VirtualClient &c = m_clients[client];
+  if (c.state == BOUND || c.state == RENEWING || c.state == REBINDING)
+    {
+      return c.address;
+    }
+  return Ipv4Address::GetAny ();
+}
+
+int64_t
+DhcpLoadGenerator::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_ran->SetStream (stream);
+  m_rtrsJitter->SetStream (stream + 1);
+  return 2;
+}
+
+void
+DhcpLoadGenerator::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_device = 0;
+  m_socket = 0;
+  m_clients.clear ();
+  m_timers.clear ();
+
+  Application::DoDispose ();
+}
+
+void
+DhcpLoadGenerator::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_socket)
+    {
+      NS_ABORT_MSG ("DHCP load generator is not (yet) meant to be started twice or more.");
+    }
+
+  // The messages are sent from 0.0.0.0, like those of a client without lease
+  Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
+  uint32_t ifIndex = ipv4->GetInterfaceForDevice (m_device);
+  bool found = false;
+  for (uint32_t i = 0; i < ipv4->GetNAddresses (ifIndex); i++)
+    {
+      if (ipv4->GetAddress (ifIndex, i).GetLocal () == Ipv4Address::GetAny ())
+        {
+          found = true;
+        }
+    }
+  if (!found)
+    {
+      ipv4->AddAddress (ifIndex, Ipv4InterfaceAddress (Ipv4Address::GetAny (), Ipv4Mask ("/0")));
+    }
+
+  TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
+  m_socket = Socket::CreateSocket (GetNode (), tid);
+  m_socket->SetAllowBroadcast (true);
+  m_socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), 68));
+  m_socket->BindToNetDevice (m_device);
+  m_socket->SetRecvCallback (MakeCallback (&DhcpLoadGenerator::NetHandler, this));
+
+  uint8_t firstChaddr[6];
+  m_firstChaddr.CopyTo (firstChaddr);
+  m_firstChaddrValue = 0;
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      m_firstChaddrValue = (m_firstChaddrValue << 8) | firstChaddr[i];
+    }
+  NS_ABORT_MSG_IF (m_firstChaddrValue + m_nClients > (uint64_t (1) << 48),
+                   "Not enough chaddrs after " << m_firstChaddr << " for " << m_nClients << " clients");
+
+  VirtualClient init;
+  init.address = Ipv4Address::GetAny ();
+  init.server = Ipv4Address::GetAny ();
+  init.lease = 0;
+  init.renew = 0;
+  init.rebind = 0;
+  init.tran = 0;
+  init.state = INIT;
+  init.attempts = 0;
+  m_clients.assign (m_nClients, init);
+
+  // The start times come in order, so each push keeps the heap without moving anything
+  m_timers.reserve (m_nClients);
+  for (uint32_t i = 0; i < m_nClients; i++)
+    {
+      SetTimer (i, Simulator::Now () + m_startInterval * i);
+    }
+}
+
+void
+DhcpLoadGenerator::StopApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Simulator::Remove (m_timerEvent);
+  m_timers.clear ();
+  if (m_socket)
+    {
+      m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+      m_socket->Close ();
+    }
+}
+
+void
+DhcpLoadGenerator::SetTimer (uint32_t client, Time time)
+{
+  NS_LOG_FUNCTION (this << client << time);
+
+  // The entry of the previous timer stays in the heap, and is skipped
+  // because it no longer matches the timer of the client
+  m_clients[client].timer = time;
+  m_timers.push_back (std::make_pair (time, client));
+  std::push_heap (m_timers.begin (), m_timers.end (), std::greater<std::pair<Time, uint32_t> > ());
+
+  // Only one event is pending, for the earliest timer
+  if (!m_timerEvent.IsRunning () || time < Simulator::Now () + Simulator::GetDelayLeft (m_timerEvent))
+    {
+      Simulator::Remove (m_timerEvent);
+      m_timerEvent = Simulator::Schedule (time - Simulator::Now (), &DhcpLoadGenerator::TimerHandler, this);
+    }
+}
+
+void
+DhcpLoadGenerator::TimerHandler (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Time now = Simulator::Now ();
+  while (!m_timers.empty () && m_timers.front ().first <= now)
+    {
+      std::pair<Time, uint32_t> timer = m_timers.front ();
+      std::pop_heap (m_timers.begin (), m_timers.end (), std::greater<std::pair<Time, uint32_t> > ());
+      m_timers.pop_back ();
+
+      if (m_clients[timer.second].timer == timer.first)
+        {
+          Timeout (timer.second);
+        }
+    }
+  // The timers set by Timeout may have scheduled an event, but not
+  // necessarily for the earliest timer left
+  if (!m_timers.empty ()
+      && (!m_timerEvent.IsRunning () || m_timers.front ().first < now + Simulator::GetDelayLeft (m_timerEvent)))
+    {
+      Simulator::Remove (m_timerEvent);
+      m_timerEvent = Simulator::Schedule (m_timers.front ().first - now, &DhcpLoadGenerator::TimerHandler, this);
+    }
+}
+
+void
+DhcpLoadGenerator::Timeout (uint32_t client)
+{
+  NS_LOG_FUNCTION (this << client);
+
+  VirtualClient &c = m_clients[client];
+  switch (c.state)
+    {
+    case INIT:
+    case REQUESTING:
+      Boot (client);
+      break;
+    case SELECTING:
+      m_retransmissions++;
+      SendDiscover (client);
+      SetTimer (client, Simulator::Now () + GetRetransmissionDelay (c));
+      break;
+    case BOUND:
+      // T1: the virtual clients have no address to unicast the REQUEST from
+      c.state = RENEWING;
+      c.tran = (uint32_t) (m_ran->GetValue ());
+      SendRequest (client);
+      SetTimer (client, Simulator::Now () + Seconds (c.rebind - c.renew));
+      break;
+    case RENEWING:
+      c.state = REBINDING;
+      c.tran = (uint32_t) (m_ran->GetValue ());
+      SendRequest (client);
+      SetTimer (client, Simulator::Now () + Seconds (c.lease - c.rebind));
+      break;
+    case REBINDING:
+      NS_LOG_INFO ("Lease of client " << client << " expired: " << c.address);
+      m_nBound--;
+      m_expiry (c.address);
+      Boot (client);
+      break;
+    }
+}
+
+void
+DhcpLoadGenerator::Boot (uint32_t client)
+{
+  NS_LOG_FUNCTION (this << client);
+
+  VirtualClient &c = m_clients[client];
+  c.tran = (uint32_t) (m_ran->GetValue ());
+  c.attempts = 0;
+  c.state = SELECTING;
+  SendDiscover (client);
+  SetTimer (client, Simulator::Now () + GetRetransmissionDelay (c));
+}
+
+void
+DhcpLoadGenerator::SendDiscover (uint32_t client)
+{
+  NS_LOG_FUNCTION (this << client);
+
+  uint8_t chaddr[16];
+  WriteChaddr (client, chaddr);
+  DhcpHeader header;
+  header.ResetOpt ();
+  header.SetTran (m_clients[client].tran);
+  header.SetType (DhcpHeader::DHCPDISCOVER);
+  header.SetTime ();
+  header.SetChaddr (chaddr, 16);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (header);
+  if (m_socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), DHCP_PEER_PORT)) < 0)
+    {
+      NS_LOG_INFO ("Error while sending DHCP DISCOVER of client " << client);
+    }
+}
+
+void
+DhcpLoadGenerator::SendRequest (uint32_t client)
+{
+  NS_LOG_FUNCTION (this << client);
+
+  const VirtualClient &c = m_clients[client];
+  uint8_t chaddr[16];
+  WriteChaddr (client, chaddr);
+  DhcpHeader header;
+  header.ResetOpt ();
+  header.SetTran (c.tran);
+  header.SetType (DhcpHeader::DHCPREQ);
+  header.SetTime ();
+  header.SetChaddr (chaddr, 16);
+  if (c.state == REQUESTING)
+    {
+      header.SetReq (c.address);
+      header.SetDhcps (c.server);
+    }
+  else
+    {
+      // RFC 2131, section 4.3.2: the lease renewed is in ciaddr, without option 50
+      header.SetCiaddr (c.address);
+    }
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (header);
+  if (m_socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), DHCP_PEER_PORT)) < 0)
+    {
+      NS_LOG_INFO ("Error while sending DHCP REQUEST of client " << client);
+    }
+}
+
+void
+DhcpLoadGenerator::NetHandler (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  Ptr<Packet> packet;
+  Address from;
+  while ((packet = m_socket->RecvFrom (from)))
+    {
+      DhcpHeaderView header (packet);
+      if (!header.IsValid ())
+        {
+          continue;
+        }
+      uint32_t client = FindClient (header.GetChaddrBuffer ());
+      if (client == m_clients.size () || header.GetTran () != m_clients[client].tran)
+        {
+          continue;
+        }
+
+      VirtualClient &c = m_clients[client];
+      uint8_t type = header.GetType ();
+      bool waitingAck = (c.state == REQUESTING || c.state == RENEWING || c.state == REBINDING);
+      if (c.state == SELECTING && type == DhcpHeader::DHCPOFFER)
+        {
+          c.address = header.GetYiaddr ();
+          c.server = header.GetDhcps ();
+          ReadLeaseTimes (c, header);
+          c.attempts = 0;
+          c.state = REQUESTING;
+          SendRequest (client);
+          SetTimer (client, Simulator::Now () + GetRetransmissionDelay (c));
+        }
+      else if (waitingAck && type == DhcpHeader::DHCPACK)
+        {
+          if (c.state == REQUESTING)
+            {
+              NS_LOG_INFO ("Client " << client << " leased " << c.address);
+              m_nBound++;
+              m_newLease (c.address);
+            }
+          // An ACK without lease time confirms the times of the offer
+          if (header.GetLease () != 0)
+            {
+              ReadLeaseTimes (c, header);
+            }
+          c.state = BOUND;
+          SetTimer (client, Simulator::Now () + Seconds (c.renew));
+        }
+      else if (waitingAck && type == DhcpHeader::DHCPNACK)
+        {
+          if (c.state != REQUESTING)
+            {
+              m_nBound--;
+              m_expiry (c.address);
+            }
+          Boot (client);
+        }
+    }
+}
+
+void
+DhcpLoadGenerator::ReadLeaseTimes (VirtualClient &client, const DhcpHeaderView &header)
+{
+  // Default T1 and T2 of RFC 2131, section 4.4.5
+  client.lease = header.GetLease ();
+  client.renew = header.GetRenew () != 0 ? header.GetRenew () : client.lease / 2;
+  client.rebind = header.GetRebind () != 0 ? header.GetRebind () : client.lease / 8 * 7;
+  // Like DhcpClient, accept the lease of a misconfigured server, with
+  // T1 <= T2 <= lease
+  if (client.renew > client.rebind || client.rebind > client.lease)
+    {
+      NS_LOG_LOGIC ("Inconsistent lease times " << client.renew << " " << client.rebind << " " << client.lease);
+      client.rebind = std::min (client.rebind, client.lease);
+      client.renew = std::min (client.renew, client.rebind);
+    }
+}
+
+Time
+DhcpLoadGenerator::GetRetransmissionDelay (VirtualClient &client)
+{
+  // Same backoff as DhcpClient
+  Time delay = m_rtrs;
+  for (uint32_t i = 0; i < client.attempts && delay < m_maxRtrs; i++)
+    {
+      delay = delay * 2;
+    }
+  delay = Min (delay, m_maxRtrs) + Seconds (m_rtrsJitter->GetValue ());
+  if (client.attempts < 0xff)
+    {
+      client.attempts++;
+    }
+  // The timer must come after the current one
+  return Max (delay, NanoSeconds (1));
+}
+
+void
+DhcpLoadGenerator::WriteChaddr (uint32_t client, uint8_t *chaddr) const
+{
+  uint64_t value = m_firstChaddrValue + client;
+  std::memset (chaddr, 0, 16);
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      chaddr[5 - i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+uint32_t
+DhcpLoadGenerator::FindClient (const uint8_t *chaddr) const
+{
+  uint64_t value = 0;
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      value = (value << 8) | chaddr[i];
+    }
+  for (uint32_t i = 6; i < 16; i++)
+    {
+      if (chaddr[i] != 0)
+        {
+          return m_clients.size ();
+        }
+    }
+  if (value < m_firstChaddrValue || value - m_firstChaddrValue >= m_clients.size ())
+    {
+      return m_clients.size ();
+    }
+  return value - m_firstChaddrValue;
+}
+
+} // namespace ns3
@@ -0,0 +1,238 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef DHCP_LOAD_GENERATOR_H
+#define DHCP_LOAD_GENERATOR_H
+
+#include "ns3/application.h"
+#include "ns3/event-id.h"
+#include "ns3/ptr.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/mac48-address.h"
+#include "ns3/nstime.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/traced-value.h"
+#include "ns3/traced-callback.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+class Socket;
+class NetDevice;
+class DhcpHeaderView;
+
+/**
+ * \ingroup dhcp
+ *
+ * \class DhcpLoadGenerator
+ * \brief Emulates many DHCP clients behind a single socket, to load a
+ * DHCP server or relay agent
+ *
+ * Each virtual client has its own chaddr (FirstChaddr plus the index of
+ * the client) and goes through DISCOVER, REQUEST and the renewals of its
+ * lease like a DhcpClient, but its state is a small entry of an array, and
+ * a single event, for the earliest timer of all the clients, is pending
+ * at any time. The virtual clients have no address on the node: all
+ * their messages, renewals included, are broadcast from 0.0.0.0, and the
+ * replies (broadcast by the server or by the relay agent) are matched to
+ * the clients by chaddr and transaction id.
+ *
+ * A client accepts the first offer. A client without reply sends its
+ * DISCOVER again with the same backoff as DhcpClient, and an unanswered
+ * REQUEST starts a new DISCOVER. A bound client renews its lease once at
+ * T1, once at T2, and starts again when the lease ends.
+ */
+class DhcpLoadGenerator : public Application
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  DhcpLoadGenerator ();
+  virtual ~DhcpLoadGenerator ();
+
+  /**
+   * \brief Set the NetDevice the clients work on
+   * \param netDevice The NetDevice the clients work on
+   */
+  void SetDhcpClientNetDevice (Ptr<NetDevice> netDevice);
+
+  /**
+   * \brief Get the NetDevice the clients work on
+   * \return The NetDevice the clients work on
+   */
+  Ptr<NetDevice> GetDhcpClientNetDevice (void) const;
+
+  /**
+   * \brief Get the number of clients holding a lease
+   * \return The number of bound clients
+   */
+  uint32_t GetNBound (void) const;
+
+  /**
+   * \brief Get the address leased by a client
+   * \param client The index of the client
+   * \return The address, or 0.0.0.0 if the client has no lease
+   */
+  Ipv4Address GetAddress (uint32_t client) const;
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by this model. Return the number of streams (possibly zero) that
+   * have been assigned.
+   *
+   * \param stream First stream index to use
+   * \return the number of stream indices assigned by this model
+   */
+  int64_t AssignStreams (int64_t stream);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /// States of a virtual client
+  enum States
+  {
+    INIT,                       //!< Not started yet
+    SELECTING,                  //!< Waiting for an offer
+    REQUESTING,                 //!< Waiting for the ACK of the offer requested
+    BOUND,                      //!< Holding a lease, until T1
+    RENEWING,                   //!< Renewing its lease, until T2
+    REBINDING                   //!< Renewing its lease, until the end of the lease
+  };
+
+  /// State of a virtual client
+  struct VirtualClient
+  {
+    Time timer;                 //!< Time of the pending timer of the client
+    uint32_t lease;             //!< Lease time (s)
+    uint32_t renew;             //!< Time from the lease to its renewal, T1 (s)
+    uint32_t rebind;            //!< Time from the lease to its rebinding, T2 (s)
+    Ipv4Address address;        //!< Address offered or leased
+    Ipv4Address server;         //!< Server identifier of the offer
+    uint32_t tran;              //!< Transaction id of the current message
+    uint8_t state;              //!< State of the client
+    uint8_t attempts;           //!< Number of times the current message was sent
+  };
+
+  /// Timer heap - time / client index, earliest time first
+  typedef std::vector<std::pair<Time, uint32_t> > TimerHeap;
+
+  static const int DHCP_PEER_PORT = 67; //!< DHCP server port
+
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  /**
+   * \brief Handles incoming packets from the network
+   * \param socket Socket bound to port 68
+   */
+  void NetHandler (Ptr<Socket> socket);
+
+  /**
+   * \brief Runs the timers whose time has come
+   */
+  void TimerHandler (void);
+
+  /**
+   * \brief Set the timer of a client, replacing its pending timer
+   * \param client The index of the client
+   * \param time The time of the timer
+   */
+  void SetTimer (uint32_t client, Time time);
+
+  /**
+   * \brief Handles the timer of a client, according to its state
+   * \param client The index of the client
+   */
+  void Timeout (uint32_t client);
+
+  /**
+   * \brief Starts a new transaction of a client with a DISCOVER
+   * \param client The index of the client
+   */
+  void Boot (uint32_t client);
+
+  /**
+   * \brief Sends the DISCOVER of a client
+   * \param client The index of the client
+   */
+  void SendDiscover (uint32_t client);
+
+  /**
+   * \brief Sends the REQUEST of a client: for its offer in REQUESTING
+   * state, for its lease in RENEWING and REBINDING states
+   * \param client The index of the client
+   */
+  void SendRequest (uint32_t client);
+
+  /**
+   * \brief Store the lease times given by a server
+   * \param client The client
+   * \param header The OFFER or ACK of the server
+   */
+  void ReadLeaseTimes (VirtualClient &client, const DhcpHeaderView &header);
+
+  /**
+   * \brief Get the time before the next retransmission of a client message
+   * \param client The client
+   * \return The delay, and counts one more attempt of the current message
+   */
+  Time GetRetransmissionDelay (VirtualClient &client);
+
+  /**
+   * \brief Write the chaddr of a client
+   * \param client The index of the client
+   * \param chaddr Buffer of 16 bytes receiving the chaddr
+   */
+  void WriteChaddr (uint32_t client, uint8_t *chaddr) const;
+
+  /**
+   * \brief Find the client of a chaddr
+   * \param chaddr The 16-byte chaddr
+   * \return The index of the client, or the number of clients if none
+   */
+  uint32_t FindClient (const uint8_t *chaddr) const;
+
+  Ptr<NetDevice> m_device;               //!< NetDevice of the clients
+  Ptr<Socket> m_socket;                  //!< Socket shared by the clients
+  uint32_t m_nClients;                   //!< Number of clients
+  Mac48Address m_firstChaddr;            //!< chaddr of the first client
+  uint64_t m_firstChaddrValue;           //!< chaddr of the first client, as a number
+  Time m_startInterval;                  //!< Time between the starts of two clients
+  Time m_rtrs;                           //!< Time before the first retransmission
+  Time m_maxRtrs;                        //!< Maximum time between two retransmissions
+  Ptr<RandomVariableStream> m_rtrsJitter; //!< Random time (s) added to each retransmission delay
+  Ptr<RandomVariableStream> m_ran;       //!< Random transaction ids
+  std::vector<VirtualClient> m_clients;  //!< The clients, by index
+  TimerHeap m_timers;                    //!< Pending timers of the clients (min-heap)
+  EventId m_timerEvent;                  //!< Event of the earliest timer
+  TracedValue<uint32_t> m_nBound;        //!< Number of clients holding a lease
+  TracedValue<uint32_t> m_retransmissions; //!< Number of DISCOVER and REQUEST retransmissions
+  TracedCallback<const Ipv4Address&> m_newLease; //!< Trace of new lease
+  TracedCallback<const Ipv4Address&> m_expiry;   //!< Trace of lease expire
+};
+
+} // namespace ns3
+
+#endif /* DHCP_LOAD_GENERATOR_H */
@@ -13,13 +13,20 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/pointer.h"
 #include "ns3/string.h"
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
 #include "ns3/ipv4-routing-table-entry.h"
 #include "dhcp-relay.h"
 #include "dhcp-header.h"
+#include "dhcp-header-view.h"
+#include "dhcp-interface-monitor.h"
+#include "dhcp-lease-table.h"
 #include "ns3/assert.h"
 #include "ns3/ipv4-packet-info-tag.h"
 #include "ns3/config.h"
 #include "ns3/ipv4-l3-protocol.h"
+#include "ns3/ipv4-list-routing.h"
+#include <cstring>
 
 namespace ns3 {
 
@@ -43,16 +50,51 @@ DhcpRelay::GetTypeId (void)
                    Ipv4AddressValue (),
                    MakeIpv4AddressAccessor (&DhcpRelay::m_dhcps),
                    MakeIpv4AddressChecker ())
-    .AddAttribute ("SubnetMask",
-                   "Mask of the subnet",
-                   Ipv4MaskValue (),
-                   MakeIpv4MaskAccessor (&DhcpRelay::m_subMask),
-                   MakeIpv4MaskChecker ())
+    .AddAttribute ("AgentInformation",
+                   "Add the Relay Agent Information option (82) to the client messages, "
+                   "and send each reply only on the interface of its client",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&DhcpRelay::m_agentInformation),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ServerSelection",
+                   "Choice of the server(s) a client message is forwarded to, "
+                   "when the message does not name a known server",
+                   EnumValue (DhcpRelay::SELECT_ALL),
+                   MakeEnumAccessor (&DhcpRelay::m_serverSelection),
+                   MakeEnumChecker (DhcpRelay::SELECT_ALL, "All",
+                                    DhcpRelay::SELECT_HASH, "Hash",
+                                    DhcpRelay::SELECT_LEAST_OUTSTANDING, "LeastOutstanding"))
+    .AddAttribute ("ReplyTimeout",
+                   "Time after which a forwarded message no longer counts as outstanding",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&DhcpRelay::m_replyTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("DuplicatePolicy",
+                   "Handling of a DISCOVER or REQUEST repeating one still waiting for its reply",
+                   EnumValue (DhcpRelay::FORWARD_DUPLICATES),
+                   MakeEnumAccessor (&DhcpRelay::m_duplicatePolicy),
+                   MakeEnumChecker (DhcpRelay::FORWARD_DUPLICATES, "Forward",
+                                    DhcpRelay::SUPPRESS_DUPLICATES, "Suppress"))
+    .AddAttribute ("MaxTransactions",
+                   "Maximum number of client messages waiting for their reply that are remembered",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&DhcpRelay::m_maxTransactions),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddTraceSource ("TransactionHits",
+                     "Number of client messages repeating one waiting for its reply",
+                     MakeTraceSourceAccessor (&DhcpRelay::m_transactionHits),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("SuppressedMessages",
+                     "Number of repeated client messages not forwarded",
+                     MakeTraceSourceAccessor (&DhcpRelay::m_suppressed),
+                     "ns3::TracedValueCallback::Uint32")
   ;
   return tid;
 }
 
 DhcpRelay::DhcpRelay ()
+  : m_transactionHits (0),
+    m_suppressed (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -66,9 +108,30 @@ void
 DhcpRelay::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
+  m_interfaces.clear ();
+  if (m_monitor != 0)
+    {
+      m_monitor->SetInterfaceChangedCallback (MakeNullCallback<void, uint32_t> ());
+      m_monitor = 0;
+    }
+  m_servers.clear ();
+  m_transactions.Clear ();
   Application::DoDispose ();
 }
 
+DhcpRelay::RelayInterface::RelayInterface ()
+  : relayed (false)
+{
+}
+
+DhcpRelay::UpstreamServer::UpstreamServer (Ipv4Address addr)
+{
+  counters.address = addr;
+  counters.forwarded = 0;
+  counters.replies = 0;
+  counters.outstanding = 0;
+}
+
 Ptr<NetDevice> DhcpRelay::GetDhcpRelayNetDevice (void)
 {
   return m_device;
@@ -98,6 +161,111 @@ void DhcpRelay::StartApplication (void)
   m_socket_server->Bind (local_server);
   m_socket_server->SetRecvPktInfo (true);
   m_socket_server->SetRecvCallback (MakeCallback (&DhcpRelay::NetHandlerClient, this));
+
+  // The DhcpServerAddress server comes first
+  if (m_dhcps != Ipv4Address () && FindServer (m_dhcps) == m_servers.size ())
+    {
+      m_servers.insert (m_servers.begin (), UpstreamServer (m_dhcps));
+    }
+  NS_ASSERT_MSG (!m_servers.empty (), "DHCP relay has no server to forward to");
+
+  m_transactions.SetMaxSize (m_maxTransactions);
+  m_transactions.SetTimeout (m_replyTimeout);
+  m_transactions.SetNServers (m_servers.size ());
+
+  // The forwarding state of every device is computed once, and updated
+  // when an interface goes up or down or when its addresses change.
+  // Ipv4ListRouting cannot remove a protocol: the monitor is added once,
+  // and left without callback while the relay is stopped.
+  Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
+  Ptr<Ipv4ListRouting> routing = DynamicCast<Ipv4ListRouting> (ipv4->GetRoutingProtocol ());
+  if (m_monitor == 0 && routing != 0)
+    {
+      m_monitor = CreateObject<DhcpInterfaceMonitor> ();
+      routing->AddRoutingProtocol (m_monitor, -32768);
+    }
+  if (m_monitor != 0)
+    {
+      m_monitor->SetInterfaceChangedCallback (MakeCallback (&DhcpRelay::InterfaceChanged, this));
+    }
+  else
+    {
+      NS_LOG_WARN ("No list routing on the relay node, later interface changes will be missed");
+    }
+  m_interfaces.resize (GetNode ()->GetNDevices ());
+  for (uint32_t device = 0; device < GetNode ()->GetNDevices (); device++)
+    {
+      UpdateInterface (device);
+    }
+}
+
+void DhcpRelay::InterfaceChanged (uint32_t ifIndex)
+{
+  NS_LOG_FUNCTION (this << ifIndex);
+
+  UpdateInterface (GetNode ()->GetObject<Ipv4> ()->GetNetDevice (ifIndex)->GetIfIndex ());
+}
+
+void DhcpRelay::UpdateInterface (uint32_t device)
+{
+  NS_LOG_FUNCTION (this << device);
+
+  if (device >= m_interfaces.size ())
+    {
+      m_interfaces.resize (device + 1);
+    }
+  RelayInterface &iface = m_interfaces[device];
+  iface.relayed = false;
+  iface.giAddr = Ipv4Address ();
+
+  // The relay address of a client subnet is the one configured on the
+  // interface, otherwise its last address
+  Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
+  int32_t ifIndex = ipv4->GetInterfaceForDevice (GetNode ()->GetDevice (device));
+  bool configured = false;
+  if (ifIndex >= 0 && ipv4->IsUp (ifIndex))
+    {
+      for (uint32_t i = 0; i < ipv4->GetNAddresses (ifIndex) && !configured; i++)
+        {
+          iface.giAddr = ipv4->GetAddress (ifIndex, i).GetLocal ();
+          for (RelayCInterfaceIter j = m_relayCInterfaces.begin (); j != m_relayCInterfaces.end (); j++)
+            {
+              if ((*j).first == iface.giAddr)
+                {
+                  configured = true;
+                  break;
+                }
+            }
+        }
+      iface.relayed = ipv4->GetNAddresses (ifIndex) > 0
+        && iface.giAddr != m_relayServerSideAddress
+        && iface.giAddr != Ipv4Address::GetLoopback ();
+    }
+
+  // Replies steered by the Relay Agent Information go out through the
+  // socket of the client interface only
+  if (iface.socket != 0)
+    {
+      Address local;
+      iface.socket->GetSockName (local);
+      if (!configured || InetSocketAddress::ConvertFrom (local).GetIpv4 () != iface.giAddr)
+        {
+          iface.socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+          iface.socket->Close ();
+          iface.socket = 0;
+        }
+    }
+  if (configured && iface.socket == 0)
+    {
+      iface.socket = Socket::CreateSocket (GetNode (), TypeId::LookupByName ("ns3::UdpSocketFactory"));
+      iface.socket->SetAllowBroadcast (true);
+      iface.socket->Bind (InetSocketAddress (iface.giAddr, PORT_SERVER));
+      iface.socket->BindToNetDevice (GetNode ()->GetDevice (device));
+      iface.socket->SetRecvPktInfo (true);
+      iface.socket->SetRecvCallback (MakeCallback (&DhcpRelay::NetHandlerServer, this));
+    }
+
+  NS_LOG_LOGIC ("Device " << device << (iface.relayed ? " relayed with giaddr " : " not relayed, address ") << iface.giAddr);
 }
 
 void DhcpRelay::StopApplication ()
@@ -113,16 +281,28 @@ void DhcpRelay::StopApplication ()
     {
       m_socket_server->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
     }
+
+  if (m_monitor != 0)
+    {
+      m_monitor->SetInterfaceChangedCallback (MakeNullCallback<void, uint32_t> ());
+    }
+
+  for (RelayInterfacesIter i = m_interfaces.begin (); i != m_interfaces.end (); i++)
+    {
+      if (i->socket != 0)
+        {
+          i->socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+        }
+    }
 }
 
 void DhcpRelay::NetHandlerServer (Ptr<Socket> socket)
 {
   NS_LOG_FUNCTION (this << socket);
 
-  DhcpHeader header;
   Ptr<Packet> packet = 0;
   Address from;
-  packet = m_socket_client->RecvFrom (from);
+  packet = socket->RecvFrom (from);
 
   Ipv4PacketInfoTag interfaceInfo;
 
@@ -132,27 +312,25 @@ void DhcpRelay::NetHandlerServer (Ptr<Socket> socket)
     }
 
   uint32_t incomingIf = interfaceInfo.GetRecvIf ();
-  Ptr<NetDevice> iDev = GetNode ()->GetDevice (incomingIf);
-
-  if (packet->RemoveHeader (header) == 0)
+  if (incomingIf >= m_interfaces.size () || !m_interfaces[incomingIf].relayed)
     {
+      NS_LOG_LOGIC ("DHCP message received on device " << incomingIf << " which is not relayed, ignoring it");
       return;
     }
-  if (header.GetType () == DhcpHeader::DHCPDISCOVER)
-    {
-      SendDiscover (iDev,header);
-    }
-  if (header.GetType () == DhcpHeader::DHCPREQ)
+
+  // The message is read in place, only the fields used are decoded
+  DhcpHeaderView header (packet);
+  if (!header.IsValid ())
     {
-      SendReq (iDev, header);
+      return;
     }
+  SendToServer (incomingIf, packet, header);
 }
 
 void DhcpRelay::NetHandlerClient (Ptr<Socket> socket)
 {
   NS_LOG_FUNCTION (this << socket);
 
-  DhcpHeader header;
   Ptr<Packet> packet = 0;
   Address from;
   packet = m_socket_server->RecvFrom (from);
@@ -163,200 +341,256 @@ void DhcpRelay::NetHandlerClient (Ptr<Socket> socket)
       NS_ABORT_MSG ("No incoming interface on DHCP message, aborting.");
     }
 
-  uint32_t incomingIf = interfaceInfo.GetRecvIf ();
-  Ptr<NetDevice> iDev = GetNode ()->GetDevice (incomingIf);
-
-  if (packet->RemoveHeader (header) == 0)
+  DhcpHeaderView header (packet);
+  if (!header.IsValid ())
     {
       return;
     }
-  if (header.GetType () == DhcpHeader::DHCPOFFER)
+  uint8_t type = header.GetType ();
+  if (type != DhcpHeader::DHCPOFFER && type != DhcpHeader::DHCPACK && type != DhcpHeader::DHCPNACK)
     {
-      SendOffer (header);
+      return;
     }
-  if (header.GetType () == DhcpHeader::DHCPACK || header.GetType () == DhcpHeader::DHCPNACK)
+
+  Ipv4Address serverAddress = InetSocketAddress::ConvertFrom (from).GetIpv4 ();
+  uint32_t server = FindServer (serverAddress);
+  if (server < m_servers.size ())
     {
-      SendAckClient (header);
+      m_servers[server].counters.replies++;
     }
+  m_transactions.Remove (header.GetTran (), header.GetChaddrBuffer (), server);
+  SendToClient (packet, header);
 }
 
-void DhcpRelay::SendDiscover (Ptr<NetDevice> iDev,DhcpHeader header)
+void DhcpRelay::WriteAgentInformation (uint8_t *buffer, uint32_t device) const
 {
-  NS_LOG_FUNCTION (this << header);
-
-  Ptr<Packet> packet = 0;
-  packet = Create<Packet> ();
-  DhcpHeader newDhcpHeader;
-  uint32_t tran = header.GetTran ();
-  Address sourceChaddr = header.GetChaddr ();
-  uint32_t mask = header.GetMask ();
+  NS_LOG_FUNCTION (this << device);
+
+  buffer[0] = DhcpHeader::OP_AGENT_INFO;
+  buffer[1] = AGENT_INFO_SIZE - 2;
+  buffer[2] = AGENT_CIRCUIT_ID;
+  buffer[3] = 4;
+  buffer[4] = (device >> 24) & 0xff;
+  buffer[5] = (device >> 16) & 0xff;
+  buffer[6] = (device >> 8) & 0xff;
+  buffer[7] = device & 0xff;
+  buffer[8] = AGENT_REMOTE_ID;
+  buffer[9] = 4;
+  m_relayServerSideAddress.Serialize (buffer + 10);
+}
 
-  Ptr<Ipv4L3Protocol> ipv4 = GetNode ()->GetObject< Ipv4L3Protocol > ();
-  int32_t ifIndex = ipv4->GetInterfaceForDevice (iDev);
+Ptr<Socket> DhcpRelay::GetReplySocket (const DhcpHeaderView &header)
+{
+  NS_LOG_FUNCTION (this << header);
 
-  Ipv4Address m_relayClientSideAddress;
-  for (uint32_t i = 0; i < ipv4->GetNAddresses (ifIndex); i++)
-    {
-      m_relayClientSideAddress = ipv4->GetAddress (ifIndex, i).GetLocal ();
-    }
+  uint8_t agentInfo[257];
+  uint32_t len = header.CopyOption (DhcpHeader::OP_AGENT_INFO, agentInfo);
 
-  RelayCInterfaceIter i;
-  for (i = m_relayCInterfaces.begin (); i != m_relayCInterfaces.end (); i++)
+  // Sub-options follow the code and the length of the option
+  bool ours = false;
+  bool hasCircuit = false;
+  uint32_t device = 0;
+  uint32_t pos = 2;
+  while (pos + 2 <= len && pos + 2 + agentInfo[pos + 1] <= len)
     {
-      if (m_relayClientSideAddress.Get () == (*i).first.Get ())
+      const uint8_t *value = agentInfo + pos + 2;
+      if (agentInfo[pos] == AGENT_CIRCUIT_ID && agentInfo[pos + 1] == 4)
         {
-          mask = (*i).second.Get ();
-          break;
+          device = (value[0] << 24) | (value[1] << 16) | (value[2] << 8) | value[3];
+          hasCircuit = true;
         }
+      else if (agentInfo[pos] == AGENT_REMOTE_ID && agentInfo[pos + 1] == 4)
+        {
+          ours = (Ipv4Address::Deserialize (value) == m_relayServerSideAddress);
+        }
+      pos += 2 + agentInfo[pos + 1];
     }
 
-  if (m_relayClientSideAddress.Get () != m_relayServerSideAddress.Get ())
+  if (ours && hasCircuit)
     {
-      newDhcpHeader.ResetOpt ();
-      newDhcpHeader.SetType (DhcpHeader::DHCPDISCOVER);
-      newDhcpHeader.SetTran (tran);
-      newDhcpHeader.SetChaddr (sourceChaddr);
-      newDhcpHeader.SetTime ();
-      newDhcpHeader.SetGiAddr (m_relayClientSideAddress);
-      newDhcpHeader.SetMask (mask);
-      packet->AddHeader (newDhcpHeader);
-
-      if ((m_socket_server->SendTo (packet, 0, InetSocketAddress (m_dhcps, PORT_SERVER))) >= 0)
-        {
-          NS_LOG_INFO ("DHCP DISCOVER sent from relay to server");
-        }
-      else
+      if (device < m_interfaces.size () && m_interfaces[device].socket != 0)
         {
-          NS_LOG_INFO ("Error while sending DHCP DISCOVER from relay to server");
+          return m_interfaces[device].socket;
         }
     }
+  NS_LOG_LOGIC ("No usable Relay Agent Information, the reply is sent on every interface");
+  return m_socket_client;
 }
 
-void DhcpRelay::SendOffer (DhcpHeader header)
+void DhcpRelay::SendToClient (Ptr<const Packet> packet, const DhcpHeaderView &header)
 {
-  NS_LOG_FUNCTION (this << header);
+  NS_LOG_FUNCTION (this << packet << header);
 
-  Ptr<Packet> packet = 0;
-  packet = Create<Packet> ();
-  DhcpHeader newDhcpHeader;
-
-  uint32_t tran = header.GetTran ();
-  Address sourceChaddr = header.GetChaddr ();
-  uint32_t mask = header.GetMask ();
-  Ipv4Address offeredAddress = header.GetYiaddr ();
-  Ipv4Address dhcpServerAddress = header.GetDhcps ();
-  uint32_t lease = header.GetLease ();
-  uint32_t renew = header.GetRenew ();
-  uint32_t rebind = header.GetRebind ();
-  Ipv4Address giaddress = header.GetGiAddr ();
-
-  if (giaddress.Get () != m_relayServerSideAddress.Get ())
-    {
-      newDhcpHeader.ResetOpt ();
-      newDhcpHeader.SetType (DhcpHeader::DHCPOFFER);
-      newDhcpHeader.SetTran (tran);
-      newDhcpHeader.SetChaddr (sourceChaddr);
-      newDhcpHeader.SetMask (mask);
-      newDhcpHeader.SetYiaddr (offeredAddress);
-      newDhcpHeader.SetDhcps (dhcpServerAddress);
-      newDhcpHeader.SetLease (lease);
-      newDhcpHeader.SetRenew (renew);
-      newDhcpHeader.SetRebind (rebind);
-      newDhcpHeader.SetGiAddr (giaddress);
-      newDhcpHeader.SetTime ();
-
-      packet->AddHeader (newDhcpHeader);
-
-      if ((m_socket_client->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), PORT_CLIENT))) >= 0)
-        {
-          NS_LOG_INFO ("DHCP OFFER sent from relay to client");
-        }
-      else
-        {
-          NS_LOG_INFO ("Error while sending DHCP OFFER from relay to client");
-        }
+  if (header.GetGiAddr () == m_relayServerSideAddress)
+    {
+      return;
     }
-}
 
-void DhcpRelay::SendReq (Ptr<NetDevice> iDev, DhcpHeader header)
-{
-  NS_LOG_FUNCTION (this << header);
-  NS_LOG_FUNCTION (this);
+  // The client does not see the Relay Agent Information (RFC 3046)
+  Ptr<Packet> reply;
+  uint32_t option = header.GetOptionOffset (DhcpHeader::OP_AGENT_INFO);
+  if (option == 0)
+    {
+      reply = packet->Copy ();
+    }
+  else
+    {
+      uint32_t size = packet->GetSize ();
+      m_message.resize (size);
+      uint8_t *message = &m_message[0];
+      packet->CopyData (message, size);
+      uint32_t optionSize = 2 + message[option + 1];
+      std::memmove (message + option, message + option + optionSize, size - option - optionSize);
+      reply = Create<Packet> (message, size - optionSize);
+    }
 
-  Ptr<Packet> packet = 0;
-  packet = Create<Packet> ();
+  if (GetReplySocket (header)->SendTo (reply, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), PORT_CLIENT)) >= 0)
+    {
+      NS_LOG_INFO ("DHCP reply sent from relay to client");
+    }
+  else
+    {
+      NS_LOG_INFO ("Error while sending DHCP reply from relay to client");
+    }
+}
 
-  uint32_t tran = header.GetTran ();
-  Ipv4Address offeredAddress = header.GetReq ();
-  Address sourceChaddr = header.GetChaddr ();
+void DhcpRelay::SendToServer (uint32_t device, Ptr<const Packet> packet, const DhcpHeaderView &header)
+{
+  NS_LOG_FUNCTION (this << device << packet << header);
 
-  Ptr<Ipv4L3Protocol> ipv4 = GetNode ()->GetObject< Ipv4L3Protocol > ();
-  int32_t ifIndex = ipv4->GetInterfaceForDevice (iDev);
+  uint8_t type = header.GetType ();
+  bool reply = (type == DhcpHeader::DHCPDISCOVER || type == DhcpHeader::DHCPREQ);
+  if (!reply && type != DhcpHeader::DHCPRELEASE && type != DhcpHeader::DHCPDECLINE && type != DhcpHeader::DHCPINFORM)
+    {
+      return;
+    }
 
-  Ipv4Address m_relayClientSideAddress;
-  for (uint32_t i = 0; i < ipv4->GetNAddresses (ifIndex); i++)
+  if (header.GetHops () >= MAX_HOPS)
     {
-      m_relayClientSideAddress = ipv4->GetAddress (ifIndex, i).GetLocal ();
+      NS_LOG_LOGIC ("DHCP message crossed " << (uint32_t) header.GetHops () << " relays, dropping it");
+      return;
     }
 
-  if (m_relayClientSideAddress.Get () != m_relayServerSideAddress.Get ())
+  // A retransmission of a message still waiting for its reply
+  if (reply)
     {
+      if (m_transactions.IsWaiting (header.GetTran (), header.GetChaddrBuffer (), type, header.GetReq ()))
+        {
+          m_transactionHits++;
+          if (m_duplicatePolicy == SUPPRESS_DUPLICATES)
+            {
+              NS_LOG_LOGIC ("DHCP message of transaction " << header.GetTran () << " already forwarded, dropping it");
+              m_suppressed++;
+              return;
+            }
+        }
+      m_transactions.Insert (header.GetTran (), header.GetChaddrBuffer (), type, header.GetReq ());
+    }
+
+  uint32_t size = packet->GetSize ();
+  m_message.resize (size + AGENT_INFO_SIZE + 1);
+  uint8_t *message = &m_message[0];
+  packet->CopyData (message, size);
 
-      DhcpHeader newDhcpHeader;
+  message[DhcpHeader::OFFSET_HOPS]++;
 
-      newDhcpHeader.ResetOpt ();
-      newDhcpHeader.SetType (DhcpHeader::DHCPREQ);
-      newDhcpHeader.SetTime ();
-      newDhcpHeader.SetTran (tran);
-      newDhcpHeader.SetReq (offeredAddress);
-      newDhcpHeader.SetChaddr (sourceChaddr);
-      packet->AddHeader (newDhcpHeader);
+  // A message already relayed keeps the giaddr of the first relay
+  if (header.GetGiAddr () == Ipv4Address::GetAny ())
+    {
+      m_interfaces[device].giAddr.Serialize (message + DhcpHeader::OFFSET_GIADDR);
+    }
 
-      if (m_socket_server->SendTo (packet, 0, InetSocketAddress (m_dhcps, PORT_SERVER)) >= 0)
+  // The Relay Agent Information option goes last, before End and the padding
+  if (m_agentInformation && header.GetOptionOffset (DhcpHeader::OP_AGENT_INFO) == 0)
+    {
+      uint32_t end = header.GetEndOffset ();
+      if (end == size)
         {
-          NS_LOG_INFO ("DHCP REQUEST sent from relay to server");
+          // A message without End gets one
+          message[size++] = DhcpHeader::OP_END;
         }
-      else
+      std::memmove (message + end + AGENT_INFO_SIZE, message + end, size - end);
+      WriteAgentInformation (message + end, device);
+      size += AGENT_INFO_SIZE;
+    }
+
+  ForwardToServers (Create<Packet> (message, size), header.GetTran (), header.GetChaddrBuffer (),
+                    header.GetDhcps (), reply);
+}
+
+uint32_t DhcpRelay::FindServer (Ipv4Address addr) const
+{
+  for (uint32_t i = 0; i < m_servers.size (); i++)
+    {
+      if (m_servers[i].counters.address == addr)
         {
-          NS_LOG_INFO ("Error while sending DHCP REQUEST from relay to server");
+          return i;
         }
     }
+  return m_servers.size ();
 }
 
-void DhcpRelay::SendAckClient (DhcpHeader header)
+void DhcpRelay::ForwardToServers (Ptr<Packet> packet, uint32_t tran, const uint8_t *chaddr,
+                                  Ipv4Address serverId, bool reply)
 {
-  NS_LOG_FUNCTION (this << header);
+  NS_LOG_FUNCTION (this << packet << tran << serverId << reply);
 
-  Ptr<Packet> packet = 0;
-  packet = Create<Packet> ();
-  Address sourceChaddr = header.GetChaddr ();
-  uint32_t tran = header.GetTran ();
-  Ipv4Address address = header.GetReq ();
-  uint32_t type = header.GetType ();
-  Ipv4Address giaddress = header.GetGiAddr ();
-
-  if (giaddress.Get () != m_relayServerSideAddress.Get ())
-    {
-
-      DhcpHeader newDhcpHeader;
-      newDhcpHeader.ResetOpt ();
-      newDhcpHeader.SetType (type);
-      newDhcpHeader.SetYiaddr (address);
-      newDhcpHeader.SetChaddr (sourceChaddr);
-      newDhcpHeader.SetTran (tran);
-      newDhcpHeader.SetDhcps (m_dhcps);
-      newDhcpHeader.SetTime ();
-      packet->AddHeader (newDhcpHeader);
-
-      if ((m_socket_client->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), PORT_CLIENT))) >= 0)
+  uint32_t named = FindServer (serverId);
+  if (m_serverSelection == SELECT_ALL)
+    {
+      // Like a real relay, every server sees the message, and only the
+      // one it names (if any) is expected to answer
+      for (uint32_t i = 0; i < m_servers.size (); i++)
+        {
+          bool tracked = reply && (named == m_servers.size () || named == i);
+          ForwardToServer (i, packet, tran, chaddr, tracked);
+        }
+      return;
+    }
+
+  // A message naming one of the servers belongs to its transaction
+  uint32_t server = named;
+  if (server == m_servers.size ())
+    {
+      if (m_serverSelection == SELECT_HASH)
         {
-          NS_LOG_INFO ("DHCP ACK sent from relay to client");
+          server = DhcpLeaseTable::Hash (chaddr) % m_servers.size ();
         }
       else
         {
-          NS_LOG_INFO ("Error while sending DHCP ACK from relay to client");
+          server = 0;
+          for (uint32_t i = 1; i < m_servers.size (); i++)
+            {
+              if (m_transactions.GetNWaiting (i) < m_transactions.GetNWaiting (server))
+                {
+                  server = i;
+                }
+            }
         }
     }
+  ForwardToServer (server, packet, tran, chaddr, reply);
+}
+
+void DhcpRelay::ForwardToServer (uint32_t server, Ptr<Packet> packet, uint32_t tran, const uint8_t *chaddr, bool reply)
+{
+  NS_LOG_FUNCTION (this << server << packet << tran << reply);
+
+  UpstreamServer &upstream = m_servers[server];
+  if (m_socket_server->SendTo (packet->Copy (), 0, InetSocketAddress (upstream.counters.address, PORT_SERVER)) >= 0)
+    {
+      NS_LOG_INFO ("DHCP message sent from relay to server " << upstream.counters.address);
+    }
+  else
+    {
+      NS_LOG_INFO ("Error while sending DHCP message from relay to server " << upstream.counters.address);
+      return;
+    }
+  upstream.counters.forwarded++;
+
+  if (reply)
+    {
+      m_transactions.AddServer (tran, chaddr, server);
+    }
 }
 
 void DhcpRelay::AddRelayInterfaceAddress (Ipv4Address addr, Ipv4Mask mask)
@@ -370,6 +604,42 @@ void DhcpRelay::AddRelayInterfaceAddress (Ipv4Address addr, Ipv4Mask mask)
         }
     }
   m_relayCInterfaces.push_back (std::make_pair (addr,mask));
+
+  // Once started, the interface with the address is relayed at once
+  if (m_socket_client != 0)
+    {
+      int32_t ifIndex = GetNode ()->GetObject<Ipv4> ()->GetInterfaceForAddress (addr);
+      if (ifIndex >= 0)
+        {
+          InterfaceChanged (ifIndex);
+        }
+    }
+}
+
+void DhcpRelay::AddDhcpServer (Ipv4Address addr)
+{
+  NS_LOG_FUNCTION (this << addr);
+
+  if (FindServer (addr) != m_servers.size ())
+    {
+      NS_ABORT_MSG ("DHCP server " << addr << " is already configured on the relay");
+    }
+  m_servers.push_back (UpstreamServer (addr));
+  m_transactions.SetNServers (m_servers.size ());
+}
+
+uint32_t DhcpRelay::GetNServers (void) const
+{
+  return m_servers.size ();
+}
+
+DhcpRelay::ServerCounters DhcpRelay::GetServerCounters (uint32_t server)
+{
+  NS_ASSERT_MSG (server < m_servers.size (), "No DHCP server " << server << " on the relay");
+
+  ServerCounters counters = m_servers[server].counters;
+  counters.outstanding = m_transactions.GetNWaiting (server);
+  return counters;
 }
 
 } // Namespace ns3
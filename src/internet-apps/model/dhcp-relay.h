@@ -7,16 +7,21 @@
 #include "ns3/address.h"
 #include "ns3/traced-value.h"
 #include "ns3/inet-socket-address.h"
+#include "ns3/nstime.h"
 #include "dhcp-header.h"
+#include "dhcp-header-view.h"
+#include "dhcp-transaction-table.h"
 #include <map>
 #include "ns3/ipv4-address.h"
 #include "ns3/random-variable-stream.h"
 #include <list>
+#include <vector>
 
 namespace ns3 {
 
 class Socket;
 class Packet;
+class DhcpInterfaceMonitor;
 
 /**
  * \ingroup dhcp
@@ -37,6 +42,30 @@ public:
 
   virtual ~DhcpRelay ();
 
+  /// Choice of the server(s) a client message is forwarded to
+  enum ServerSelection
+  {
+    SELECT_ALL,               //!< Every server gets a copy of the message
+    SELECT_HASH,              //!< A hash of the client hardware address picks the server
+    SELECT_LEAST_OUTSTANDING  //!< The server with the fewest messages waiting for a reply
+  };
+
+  /// Handling of a client message repeating one still waiting for its reply
+  enum DuplicatePolicy
+  {
+    FORWARD_DUPLICATES,       //!< The message is forwarded again
+    SUPPRESS_DUPLICATES       //!< The message is dropped, the reply to the first one answers it
+  };
+
+  /// Counters of an upstream DHCP server
+  struct ServerCounters
+  {
+    Ipv4Address address;      //!< Address of the server
+    uint32_t forwarded;       //!< Client messages forwarded to the server
+    uint32_t replies;         //!< Replies received from the server
+    uint32_t outstanding;     //!< Forwarded messages still waiting for a reply
+  };
+
   /**
    * \brief Get the NetDevice DHCP should work on
    * \return the NetDevice DHCP should work on
@@ -72,6 +101,25 @@ public:
    */
   void AddRelayInterfaceAddress (Ipv4Address addr, Ipv4Mask mask);
 
+  /**
+   * \brief Add an upstream DHCP server, besides the DhcpServerAddress one
+   * \param addr Ipv4Address of the server
+   */
+  void AddDhcpServer (Ipv4Address addr);
+
+  /**
+   * \brief Get the number of upstream DHCP servers
+   * \return The number of servers
+   */
+  uint32_t GetNServers (void) const;
+
+  /**
+   * \brief Get the counters of an upstream DHCP server
+   * \param server The index of the server, in the order they were added
+   * \return The counters of the server
+   */
+  ServerCounters GetServerCounters (uint32_t server);
+
 protected:
   virtual void DoDispose (void);
 
@@ -92,42 +140,147 @@ private:
   void NetHandlerServer (Ptr<Socket> socket);
 
   /**
-   * \brief Sends DHCP DISCOVER to server as a unicast message
-   * \param iDev incoming NetDevice
-   * \param header DHCP header of the received message
+   * \brief Update the forwarding state of the device of an IPv4 interface
+   * \param ifIndex The IPv4 interface that went up or down, or whose addresses changed
    */
-  void SendDiscover (Ptr<NetDevice> iDev, DhcpHeader header);
+  void InterfaceChanged (uint32_t ifIndex);
 
   /**
-   * \brief Sends DHCP REQUEST to server as a unicast message
-   * \param header DHCP header of the received message
+   * \brief Compute the forwarding state of a device
+   * \param device The index of the device in the node
    */
-  void SendReq (Ptr<NetDevice> iDev, DhcpHeader header);
+  void UpdateInterface (uint32_t device);
 
   /**
-   * \brief Sends DHCP OFFER coming from server to client
+   * \brief Sends a client message to the server(s) as a unicast message
+   *
+   * The received message is forwarded as is, except for the fields a
+   * relay agent sets: hops, giaddr and the Relay Agent Information
+   * option, which are patched in a copy of its bytes.
+   *
+   * \param device index of the incoming device
+   * \param packet The received message
    * \param header DHCP header of the received message
    */
-  void SendOffer (DhcpHeader header);
+  void SendToServer (uint32_t device, Ptr<const Packet> packet, const DhcpHeaderView &header);
+
+  /**
+   * \brief Encode the Relay Agent Information option of a message sent to the server
+   *
+   * The circuit id is the index of the device the client message came
+   * from, the remote id is the server side address of the relay.
+   *
+   * \param buffer Buffer receiving the option, of at least AGENT_INFO_SIZE bytes
+   * \param device The index of the device the client message came from
+   */
+  void WriteAgentInformation (uint8_t *buffer, uint32_t device) const;
+
+  /**
+   * \brief Get the socket to send a server reply to the client
+   *
+   * The Relay Agent Information echoed by the server gives the client
+   * interface. Without it, the reply is broadcast on every interface.
+   *
+   * \param header DHCP header of the server reply
+   * \return The socket bound to the client interface, or the socket bound to all of them
+   */
+  Ptr<Socket> GetReplySocket (const DhcpHeaderView &header);
+
+  /**
+   * \brief Forward a client message to the servers chosen by the ServerSelection policy
+   *
+   * A message naming a known server in its server identifier goes to this
+   * server only.
+   *
+   * \param packet The message
+   * \param tran The transaction id of the message
+   * \param chaddr The 16-byte chaddr of the client
+   * \param serverId The server identifier of the message, or 0.0.0.0
+   * \param reply Whether the servers reply through the relay
+   */
+  void ForwardToServers (Ptr<Packet> packet, uint32_t tran, const uint8_t *chaddr,
+                         Ipv4Address serverId, bool reply);
+
+  /**
+   * \brief Forward a client message to one server
+   * \param server The index of the server
+   * \param packet The message
+   * \param tran The transaction id of the message
+   * \param chaddr The 16-byte chaddr of the client
+   * \param reply Whether the server replies through the relay
+   */
+  void ForwardToServer (uint32_t server, Ptr<Packet> packet, uint32_t tran, const uint8_t *chaddr, bool reply);
+
+  /**
+   * \brief Find an upstream DHCP server
+   * \param addr Ipv4Address of the server
+   * \return The index of the server, or the number of servers if it is unknown
+   */
+  uint32_t FindServer (Ipv4Address addr) const;
 
   /**
-   * \brief Sends DHCP ACK coming from server to client
+   * \brief Sends a server reply to the client
+   *
+   * The reply is forwarded as is, without the Relay Agent Information
+   * option.
+   *
+   * \param packet The received message
    * \param header DHCP header of the received message
    */
-  void SendAckClient (DhcpHeader header);
+  void SendToClient (Ptr<const Packet> packet, const DhcpHeaderView &header);
 
   /// Client subnet container - gateway address / subnet mask
   typedef std::list< std::pair<Ipv4Address, Ipv4Mask> > RelayCInterface;
   /// Client subnet iterator - gateway address / subnet mask
   typedef std::list< std::pair<Ipv4Address, Ipv4Mask> >::iterator  RelayCInterfaceIter;
 
+  /// Upstream DHCP server
+  struct UpstreamServer
+  {
+    /**
+     * \brief Constructor
+     * \param addr Ipv4Address of the server
+     */
+    UpstreamServer (Ipv4Address addr);
+    ServerCounters counters;            //!< Counters of the server
+  };
+
+  /// Forwarding state of a device of the relay node
+  struct RelayInterface
+  {
+    RelayInterface ();
+    bool relayed;            //!< Whether the client messages received on the device are relayed
+    Ipv4Address giAddr;      //!< Relay address on the client subnet (giaddr)
+    Ptr<Socket> socket;      //!< Socket bound to the device, for the replies, if the subnet is configured
+  };
+  /// Forwarding state of the devices, by device index
+  typedef std::vector<RelayInterface> RelayInterfaces;
+  /// Forwarding state iterator
+  typedef std::vector<RelayInterface>::iterator RelayInterfacesIter;
+
+  static const uint8_t AGENT_CIRCUIT_ID = 1;  //!< Agent Circuit ID sub-option of the Relay Agent Information
+  static const uint8_t AGENT_REMOTE_ID = 2;   //!< Agent Remote ID sub-option of the Relay Agent Information
+  static const uint32_t AGENT_INFO_SIZE = 14; //!< Size of the Relay Agent Information option added by the relay
+  static const uint8_t MAX_HOPS = 16;         //!< Client messages having crossed more relays are dropped (RFC 1542)
+
   Ptr<Socket> m_socket_client;               //!< Socket bound to port 67
   Ptr<Socket> m_socket_server;                   //!< Socket bound to port 68
   Ptr<NetDevice> m_device;                               //!< NetDevice pointer
   Ipv4Address m_relayServerSideAddress;  //!< Address assigned to the server side interface of relay
-  Ipv4Address m_dhcps;                                   //!< Address of the DHCP server
-  Ipv4Mask m_subMask;                                    //!< Mask of the subnet to which server belongs
+  Ipv4Address m_dhcps;                                   //!< Address of the first DHCP server
   RelayCInterface m_relayCInterfaces;    //!< Client side gateway address and subnet mask
+  RelayInterfaces m_interfaces;          //!< Forwarding state of the devices, by device index
+  Ptr<DhcpInterfaceMonitor> m_monitor;   //!< Reports the changes of the interfaces
+  std::vector<UpstreamServer> m_servers; //!< Upstream DHCP servers
+  ServerSelection m_serverSelection;     //!< Choice of the server(s) of a client message
+  Time m_replyTimeout;                   //!< Time a forwarded message waits for its reply
+  std::vector<uint8_t> m_message;        //!< Copy of the message being forwarded, patched in place
+  DhcpTransactionTable m_transactions;   //!< Client messages waiting for their reply, and their servers
+  uint32_t m_maxTransactions;            //!< Maximum number of transactions in m_transactions
+  DuplicatePolicy m_duplicatePolicy;     //!< Handling of the repeated client messages
+  TracedValue<uint32_t> m_transactionHits;   //!< Client messages repeating one waiting for its reply
+  TracedValue<uint32_t> m_suppressed;        //!< Repeated client messages dropped
+  bool m_agentInformation;               //!< Whether the Relay Agent Information option is used
 };
 
 } // namespace ns3
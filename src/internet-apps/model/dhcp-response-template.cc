@@ -0,0 +1,100 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/simulator.h"
+#include "dhcp-response-template.h"
+#include <cstring>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("DhcpResponseTemplate");
+
+DhcpResponseTemplate::DhcpResponseTemplate ()
+  : m_servIdOffset (0)
+{
+}
+
+void
+DhcpResponseTemplate::Set (DhcpHeader header)
+{
+  NS_LOG_FUNCTION (this << header);
+
+  Packet packet;
+  packet.AddHeader (header);
+  m_bytes.resize (packet.GetSize ());
+  packet.CopyData (&m_bytes[0], m_bytes.size ());
+
+  m_servIdOffset = 0;
+  uint32_t offset = DhcpHeader::OFFSET_OPTIONS;
+  while (offset + 1 < m_bytes.size () && m_bytes[offset] != DhcpHeader::OP_END)
+    {
+      if (m_bytes[offset] == DhcpHeader::OP_SERVID)
+        {
+          m_servIdOffset = offset + 2;
+        }
+      offset += 2 + m_bytes[offset + 1];
+    }
+}
+
+bool
+DhcpResponseTemplate::IsSet (void) const
+{
+  return !m_bytes.empty ();
+}
+
+Ptr<Packet>
+DhcpResponseTemplate::CreatePacket (uint32_t tran, const uint8_t *chaddr, Ipv4Address yiAddr,
+                                    Ipv4Address giAddr, Ipv4Address dhcps,
+                                    const uint8_t *options, uint32_t optionsLen)
+{
+  NS_LOG_FUNCTION (this << tran << yiAddr << giAddr << dhcps);
+  NS_ASSERT_MSG (IsSet (), "The response template has not been set");
+
+  // Same byte order as DhcpHeader::Serialize
+  uint8_t *bytes = &m_bytes[0];
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      bytes[DhcpHeader::OFFSET_XID + i] = (tran >> (8 * i)) & 0xff;
+    }
+  uint16_t secs = (uint16_t) Simulator::Now ().GetSeconds ();
+  bytes[DhcpHeader::OFFSET_SECS] = secs >> 8;
+  bytes[DhcpHeader::OFFSET_SECS + 1] = secs & 0xff;
+  yiAddr.Serialize (bytes + DhcpHeader::OFFSET_YIADDR);
+  giAddr.Serialize (bytes + DhcpHeader::OFFSET_GIADDR);
+  std::memcpy (bytes + DhcpHeader::OFFSET_CHADDR, chaddr, 16);
+  if (m_servIdOffset != 0)
+    {
+      dhcps.Serialize (bytes + m_servIdOffset);
+    }
+
+  if (optionsLen == 0)
+    {
+      return Create<Packet> (bytes, m_bytes.size ());
+    }
+
+  // End is the last byte of the template
+  std::vector<uint8_t> reply (m_bytes.begin (), m_bytes.end () - 1);
+  reply.insert (reply.end (), options, options + optionsLen);
+  reply.push_back (DhcpHeader::OP_END);
+  return Create<Packet> (&reply[0], reply.size ());
+}
+
+} // namespace ns3
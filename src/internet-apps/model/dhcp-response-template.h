@@ -0,0 +1,88 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef DHCP_RESPONSE_TEMPLATE_H
+#define DHCP_RESPONSE_TEMPLATE_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+#include "dhcp-header.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup dhcp
+ *
+ * \class DhcpResponseTemplate
+ * \brief Pre-serialized DHCP reply, completed for each client
+ *
+ * The fields shared by the replies of a server (message type, mask,
+ * lease times, router, ...) are serialized once. Each reply copies the
+ * bytes into a new packet after patching the client specific fields at
+ * their fixed offsets: xid, secs, yiaddr, giaddr, chaddr and the value
+ * of the server identifier option. Options that depend on the request
+ * are inserted before the End option.
+ */
+class DhcpResponseTemplate
+{
+public:
+  DhcpResponseTemplate ();
+
+  /**
+   * \brief Serialize the common part of the replies
+   *
+   * The client specific fields of the header are overwritten by
+   * CreatePacket, their value does not matter.
+   *
+   * \param header The header of the replies
+   */
+  void Set (DhcpHeader header);
+
+  /**
+   * \brief Check whether the template has been set
+   * \return true if Set has been called
+   */
+  bool IsSet (void) const;
+
+  /**
+   * \brief Create a reply
+   * \param tran The transaction id of the client message
+   * \param chaddr The 16-byte chaddr of the client
+   * \param yiAddr The address of the client (yiaddr)
+   * \param giAddr The address of the relay agent (giaddr)
+   * \param dhcps The server identifier, used only if the template has the option
+   * \param options Encoded options added to the reply, e.g. the echoed Relay Agent Information
+   * \param optionsLen The length of the encoded options
+   * \return The packet holding the reply
+   */
+  Ptr<Packet> CreatePacket (uint32_t tran, const uint8_t *chaddr, Ipv4Address yiAddr,
+                            Ipv4Address giAddr, Ipv4Address dhcps,
+                            const uint8_t *options = 0, uint32_t optionsLen = 0);
+
+private:
+  std::vector<uint8_t> m_bytes; //!< Serialized reply, patched in place for each client
+  uint32_t m_servIdOffset;      //!< Offset of the server identifier value, or 0 if absent
+};
+
+} // namespace ns3
+
+#endif /* DHCP_RESPONSE_TEMPLATE_H */
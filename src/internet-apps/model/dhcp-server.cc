@@ -33,18 +33,104 @@
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
+#include "ns3/string.h"
 #include "ns3/config.h"
 #include "dhcp-server.h"
 #include "dhcp-header.h"
 #include "ns3/ipv4.h"
 #include <map>
 #include <algorithm>
+#include <functional>
+#include <fstream>
+#include <cstring>
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("DhcpServer");
 NS_OBJECT_ENSURE_REGISTERED (DhcpServer);
 
+/// Magic number at the start of a lease file
+static const char LEASE_FILE_MAGIC[8] = { 'N', 'S', '3', 'D', 'H', 'C', 'P', 'L' };
+/// Version of the lease file layout
+static const uint32_t LEASE_FILE_VERSION = 1;
+/// Size of the lease file header
+static const uint32_t LEASE_FILE_HEADER_SIZE = 16;
+/// Size of a lease file record
+static const uint32_t LEASE_FILE_RECORD_SIZE = 32;
+
+/**
+ * \brief Write an integer in network byte order
+ * \param buffer Where to write the bytes
+ * \param value The value
+ * \param size The number of bytes of the value
+ */
+static void
+WriteBigEndian (uint8_t *buffer, uint64_t value, uint32_t size)
+{
+  for (uint32_t i = 0; i < size; i++)
+    {
+      buffer[i] = (value >> (8 * (size - 1 - i))) & 0xff;
+    }
+}
+
+/**
+ * \brief Read an integer in network byte order
+ * \param buffer The bytes
+ * \param size The number of bytes of the value
+ * \return The value
+ */
+static uint64_t
+ReadBigEndian (const uint8_t *buffer, uint32_t size)
+{
+  uint64_t value = 0;
+  for (uint32_t i = 0; i < size; i++)
+    {
+      value = (value << 8) | buffer[i];
+    }
+  return value;
+}
+
+/**
+ * \brief Get the address a DHCP REQUEST is about: ciaddr for a client
+ * renewing or rebinding its lease, option 50 otherwise (RFC 2131, section 4.3.2)
+ * \param header The REQUEST
+ * \return The address
+ */
+static Ipv4Address
+GetRequestedAddress (const DhcpHeaderView &header)
+{
+  if (header.GetCiaddr () != Ipv4Address::GetAny ())
+    {
+      return header.GetCiaddr ();
+    }
+  return header.GetReq ();
+}
+
+/**
+ * \brief Get the position of a pool the search for a free address of a
+ * client starts at, with the Hash allocation policy
+ *
+ * The relay agent picks a server with DhcpLeaseTable::Hash, so the hash is
+ * salted and mixed again here: otherwise all the clients a relay agent sends
+ * to one server would start at the same few positions of its pools.
+ * \param chaddr The 16-byte chaddr of the client
+ * \return The hash of the chaddr
+ */
+static uint32_t
+GetAllocationHash (const uint8_t *chaddr)
+{
+  uint64_t h = DhcpLeaseTable::Hash (chaddr) ^ 0x5851f42d4c957f2dULL;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return static_cast<uint32_t> (h);
+}
+
 TypeId
 DhcpServer::GetTypeId (void)
 {
@@ -67,16 +153,74 @@ DhcpServer::GetTypeId (void)
                    TimeValue (Seconds (25)),                    
                    MakeTimeAccessor (&DhcpServer::m_rebind),  
                    MakeTimeChecker ())
+    .AddAttribute ("DeclineTime",
+                   "Time during which an address declined by a client is not offered again.",
+                   TimeValue (Seconds (30)),
+                   MakeTimeAccessor (&DhcpServer::m_declineTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("RapidCommit",
+                   "Whether a DISCOVER with the Rapid Commit option is answered with an ACK.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&DhcpServer::m_rapidCommit),
+                   MakeBooleanChecker ())
     .AddAttribute ("Gateway",
                    "Address of default gateway",
                    Ipv4AddressValue (),
                    MakeIpv4AddressAccessor (&DhcpServer::m_gateway),
                    MakeIpv4AddressChecker ())
+    .AddAttribute ("LeaseFile",
+                   "File the dynamic leases are saved to when the server stops, and restored "
+                   "from when it starts. Empty for no lease file.",
+                   StringValue (""),
+                   MakeStringAccessor (&DhcpServer::m_leaseFile),
+                   MakeStringChecker ())
+    .AddAttribute ("AllocationPolicy",
+                   "Choice of the address offered to a client without a lease: the lowest free "
+                   "address of the pool, or the first free address from a position given by a "
+                   "hash of the client hardware address, which gives a client the same address "
+                   "whatever the order of arrival of the clients.",
+                   EnumValue (DhcpServer::ALLOCATE_FIRST_FREE),
+                   MakeEnumAccessor (&DhcpServer::m_allocationPolicy),
+                   MakeEnumChecker (DhcpServer::ALLOCATE_FIRST_FREE, "FirstFree",
+                                    DhcpServer::ALLOCATE_HASH, "Hash"))
+    .AddAttribute ("ProcessingTime",
+                   "Time taken to process a message. Messages received meanwhile wait in a queue, "
+                   "bound clients first. Zero processes every message on reception.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&DhcpServer::m_processingTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("QueueLimit",
+                   "Maximum number of messages waiting to be processed.",
+                   UintegerValue (100),
+                   MakeUintegerAccessor (&DhcpServer::m_queueLimit),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("GiaddrRate",
+                   "DISCOVER and INFORM messages accepted per second from each relay agent "
+                   "(or from the directly attached clients). Zero for no limit.",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&DhcpServer::m_giaddrRate),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("GiaddrBurst",
+                   "DISCOVER and INFORM messages accepted at once from each relay agent.",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&DhcpServer::m_giaddrBurst),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddTraceSource ("QueueDrops",
+                     "Number of messages dropped because the queue is full",
+                     MakeTraceSourceAccessor (&DhcpServer::m_queueDrops),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("RateDrops",
+                     "Number of messages dropped because their relay agent sent too many",
+                     MakeTraceSourceAccessor (&DhcpServer::m_rateDrops),
+                     "ns3::TracedValueCallback::Uint32")
   ;
   return tid;
 }
 
 DhcpServer::DhcpServer ()
+  : m_nPending (0),
+    m_queueDrops (0),
+    m_rateDrops (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -90,77 +234,226 @@ void
 DhcpServer::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
+  Simulator::Remove (m_expiredEvent);
+  Simulator::Remove (m_quarantineEvent);
+  Simulator::Remove (m_processEvent);
+  m_quarantine.clear ();
   Application::DoDispose ();
 }
 
-void DhcpServer::StartApplication (void)
+void DhcpServer::SaveLeases (void)
 {
-  NS_LOG_FUNCTION (this);
+  NS_LOG_FUNCTION (this << m_leaseFile);
+
+  std::vector<uint8_t> bytes (LEASE_FILE_HEADER_SIZE);
+  std::memcpy (&bytes[0], LEASE_FILE_MAGIC, sizeof (LEASE_FILE_MAGIC));
+  WriteBigEndian (&bytes[8], LEASE_FILE_VERSION, 4);
 
-  PoolAddressIter iter;
-  for (iter = m_poolAddresses.begin (); iter != m_poolAddresses.end (); iter ++)
+  // The static leases come from the configuration, not from the file
+  Time now = Simulator::Now ();
+  uint32_t nRecords = 0;
+  for (uint32_t index = 0; nRecords < m_leases.GetNLeases (); index++)
     {
-      NS_ASSERT_MSG ((*iter).second.first < (*iter).second.second,"Invalid Address range");   
-    } 
+      DhcpLeaseTable::Lease &lease = m_leases.Get (index);
+      if (lease.state == DhcpLeaseTable::LEASE_FREE)
+        {
+          continue;
+        }
+      nRecords++;
+      if (lease.state == DhcpLeaseTable::LEASE_STATIC)
+        {
+          continue;
+        }
+      uint32_t offset = bytes.size ();
+      bytes.resize (offset + LEASE_FILE_RECORD_SIZE, 0);
+      std::memcpy (&bytes[offset], lease.chaddr, 16);
+      WriteBigEndian (&bytes[offset + 16], lease.address.Get (), 4);
+      bytes[offset + 20] = lease.state;
+      WriteBigEndian (&bytes[offset + 24], (lease.expiry - now).GetNanoSeconds (), 8);
+    }
+  WriteBigEndian (&bytes[12], (bytes.size () - LEASE_FILE_HEADER_SIZE) / LEASE_FILE_RECORD_SIZE, 4);
+
+  std::ofstream file (m_leaseFile.c_str (), std::ios::binary | std::ios::trunc);
+  file.write (reinterpret_cast<const char *> (&bytes[0]), bytes.size ());
+  NS_ABORT_MSG_IF (!file, "Could not write the DHCP lease file " << m_leaseFile);
+  NS_LOG_INFO ("Saved " << (bytes.size () - LEASE_FILE_HEADER_SIZE) / LEASE_FILE_RECORD_SIZE << " leases to " << m_leaseFile);
+}
 
-  Ipv4Address myOwnAddress;
+void DhcpServer::LoadLeases (void)
+{
+  NS_LOG_FUNCTION (this << m_leaseFile);
+
+  std::ifstream file (m_leaseFile.c_str (), std::ios::binary | std::ios::ate);
+  if (!file)
+    {
+      NS_LOG_INFO ("No DHCP lease file " << m_leaseFile << ", starting without leases");
+      return;
+    }
+  std::vector<uint8_t> bytes (file.tellg ());
+  file.seekg (0);
+  if (!bytes.empty ())
+    {
+      file.read (reinterpret_cast<char *> (&bytes[0]), bytes.size ());
+    }
+  if (!file || bytes.size () < LEASE_FILE_HEADER_SIZE
+      || std::memcmp (&bytes[0], LEASE_FILE_MAGIC, sizeof (LEASE_FILE_MAGIC)) != 0
+      || ReadBigEndian (&bytes[8], 4) != LEASE_FILE_VERSION)
+    {
+      NS_LOG_WARN ("Invalid DHCP lease file " << m_leaseFile << ", starting without leases");
+      return;
+    }
+  // The record count is checked against the file size before any product,
+  // which could overflow with a corrupt count
+  uint32_t nRecords = ReadBigEndian (&bytes[12], 4);
+  if (nRecords > (bytes.size () - LEASE_FILE_HEADER_SIZE) / LEASE_FILE_RECORD_SIZE
+      || bytes.size () != LEASE_FILE_HEADER_SIZE + (uint64_t) nRecords * LEASE_FILE_RECORD_SIZE)
+    {
+      NS_LOG_WARN ("Truncated DHCP lease file " << m_leaseFile << ", starting without leases");
+      return;
+    }
+
+  // The expired leases are queued oldest first, as if they had expired here
+  Time now = Simulator::Now ();
+  std::vector<std::pair<Time, uint32_t> > expired;
+  for (uint32_t record = 0; record < nRecords; record++)
+    {
+      const uint8_t *data = &bytes[LEASE_FILE_HEADER_SIZE + record * LEASE_FILE_RECORD_SIZE];
+      Ipv4Address address = Ipv4Address (ReadBigEndian (data + 16, 4));
+      Time left = NanoSeconds ((int64_t) ReadBigEndian (data + 24, 8));
+      DhcpAddressPool *pool = FindPoolForAddress (address);
+      if (pool == 0 || m_leases.Find (data) != DhcpLeaseTable::NONE || !pool->Reserve (address))
+        {
+          NS_LOG_WARN ("Lease of " << address << " in " << m_leaseFile << " is not in a pool or is already used, skipping it");
+          continue;
+        }
+
+      uint32_t index = m_leases.Insert (data);
+      DhcpLeaseTable::Lease &lease = m_leases.Get (index);
+      lease.address = address;
+      lease.pool = pool - &m_pools[0];
+      lease.expiry = now + left;
+      if (data[20] == DhcpLeaseTable::LEASE_ACTIVE && left.IsStrictlyPositive ())
+        {
+          lease.state = DhcpLeaseTable::LEASE_ACTIVE;
+          ScheduleExpiry (index, lease.expiry);
+        }
+      else
+        {
+          lease.state = DhcpLeaseTable::LEASE_EXPIRED;
+          expired.push_back (std::make_pair (lease.expiry, index));
+        }
+    }
+  std::stable_sort (expired.begin (), expired.end ());
+  for (uint32_t i = 0; i < expired.size (); i++)
+    {
+      m_leases.PushExpired (m_expiredAddresses[m_leases.Get (expired[i].second).pool], expired[i].second);
+    }
+  NS_LOG_INFO ("Restored " << m_leases.GetNLeases () << " leases from " << m_leaseFile);
+}
+
+void DhcpServer::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
 
   if (m_socket)   
     {
       NS_ABORT_MSG ("DHCP daemon is not (yet) meant to be started twice or more.");
     }
 
-  uint32_t addrIndex;
   Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();   
-  int32_t ifIndex;
-  int flag = 0;
-
-  for (iter = m_poolAddresses.begin (); iter != m_poolAddresses.end (); iter ++)
-    {
-      ifIndex = ipv4->GetInterfaceForPrefix ((*iter).first.first, (*iter).first.second);   
-
-	  for (addrIndex = 0; addrIndex < ipv4->GetNAddresses (ifIndex); addrIndex++)
-	    {
-	      if (ipv4->GetAddress (ifIndex, addrIndex).GetLocal ().CombineMask ((*iter).first.second) == (*iter).first.first &&
-	          ipv4->GetAddress (ifIndex, addrIndex).GetLocal ().Get () >= (*iter).second.first.Get () &&
-	          ipv4->GetAddress (ifIndex, addrIndex).GetLocal ().Get () <= (*iter).second.second.Get ())
-	        {
-	          // set infinite GRANTED_LEASED_TIME for my address    
-	          myOwnAddress = ipv4->GetAddress (ifIndex, addrIndex).GetLocal ();
-	          m_leasedAddresses[Address ()] = std::make_pair (myOwnAddress, 0xffffffff); 
-	          flag = 1;
-	          break; 
-            }
-	    }
-      if (flag == 1)
-        break;
-  }
-
   TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
+
+  // Broadcasts are received on all the interfaces by a single socket
   m_socket = Socket::CreateSocket (GetNode (), tid);
-  InetSocketAddress local = InetSocketAddress (Ipv4Address::GetAny (), PORT);
   m_socket->SetAllowBroadcast (true);
-  m_socket->BindToNetDevice (ipv4->GetNetDevice (ifIndex));
-  m_socket->Bind (local);
+  m_socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), PORT));
   m_socket->SetRecvPktInfo (true);
+  m_socket->SetRecvCallback (MakeCallback (&DhcpServer::NetHandler, this));
 
-  uint32_t range;
-  for (iter = m_poolAddresses.begin (); iter != m_poolAddresses.end (); iter ++)
-  {
-    range = (*iter).second.second.Get () - (*iter).second.first.Get () + 1; 
-    for (uint32_t searchSeq = 0; searchSeq < range; searchSeq ++)
-      {
-        Ipv4Address poolAddress = Ipv4Address ((*iter).second.first.Get () + searchSeq);
-        if (poolAddress != myOwnAddress)
-          {
-            NS_LOG_LOGIC ("Adding " << poolAddress << " to the pool");
-            m_availableAddresses.push_back (std::make_pair(poolAddress, (*iter).first.second));    
-          }
-      }
-  }
+  // Every interface with an address is served: directly attached clients
+  // get an address from the pools of the interface subnets, relayed ones
+  // from the pool of the relay subnet.
+  for (uint32_t ifIndex = 0; ifIndex < ipv4->GetNInterfaces (); ifIndex++)
+    {
+      if (ipv4->GetNAddresses (ifIndex) == 0 ||
+          ipv4->GetAddress (ifIndex, 0).GetLocal () == Ipv4Address::GetLoopback ())
+        {
+          continue;
+        }
 
-  m_socket->SetRecvCallback (MakeCallback (&DhcpServer::NetHandler, this));
-  m_expiredEvent = Simulator::Schedule (Seconds (1), &DhcpServer::TimerHandler, this); 
+      ServedInterface &iface = m_interfaces[ifIndex];
+      iface.device = ipv4->GetNetDevice (ifIndex);
+      for (uint32_t addrIndex = 0; addrIndex < ipv4->GetNAddresses (ifIndex); addrIndex++)
+        {
+          Ipv4Address myOwnAddress = ipv4->GetAddress (ifIndex, addrIndex).GetLocal ();
+          DhcpAddressPool *pool = FindPoolForSubnet (myOwnAddress);
+          if (pool != 0)
+            {
+              if (std::find (iface.pools.begin (), iface.pools.end (), pool - &m_pools[0]) == iface.pools.end ())
+                {
+                  iface.pools.push_back (pool - &m_pools[0]);
+                }
+              // never give my address to a client
+              pool->Reserve (myOwnAddress);
+            }
+        }
+
+      // Replies go out through the socket of the interface, which also
+      // receives the unicast messages addressed to the interface
+      iface.socket = Socket::CreateSocket (GetNode (), tid);
+      iface.socket->SetAllowBroadcast (true);
+      iface.socket->Bind (InetSocketAddress (ipv4->GetAddress (ifIndex, 0).GetLocal (), PORT));
+      iface.socket->BindToNetDevice (iface.device);
+      iface.socket->SetRecvPktInfo (true);
+      iface.socket->SetRecvCallback (MakeCallback (&DhcpServer::NetHandler, this));
+      NS_LOG_INFO ("Serving interface " << ifIndex << " with " << iface.pools.size () << " local pools");
+    }
+
+  if (!m_leaseFile.empty ())
+    {
+      LoadLeases ();
+    }
+  BuildResponseTemplates ();
+}
+
+void DhcpServer::BuildResponseTemplates (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // The client specific fields are patched in for each reply
+  m_offerTemplates.assign (m_pools.size (), DhcpResponseTemplate ());
+  m_rapidAckTemplates.assign (m_pools.size (), DhcpResponseTemplate ());
+  for (uint32_t pool = 0; pool < m_pools.size (); pool++)
+    {
+      for (uint32_t rapidCommit = 0; rapidCommit < 2; rapidCommit++)
+        {
+          DhcpHeader header;
+          header.ResetOpt ();
+          header.SetType (rapidCommit ? DhcpHeader::DHCPACK : DhcpHeader::DHCPOFFER);
+          if (rapidCommit)
+            {
+              header.SetRapidCommit ();
+            }
+          header.SetDhcps (Ipv4Address ());
+          header.SetMask (m_pools[pool].GetPoolMask ().Get ());
+          header.SetLease (m_lease.GetSeconds ());
+          header.SetRenew (m_renew.GetSeconds ());
+          header.SetRebind (m_rebind.GetSeconds ());
+          if (m_gateway != Ipv4Address ())
+            {
+              header.SetRouter (m_gateway);
+            }
+          (rapidCommit ? m_rapidAckTemplates : m_offerTemplates)[pool].Set (header);
+        }
+    }
+
+  DhcpHeader header;
+  header.ResetOpt ();
+  header.SetType (DhcpHeader::DHCPACK);
+  header.SetDhcps (Ipv4Address ());
+  m_ackTemplate.Set (header);
+  header.SetType (DhcpHeader::DHCPNACK);
+  m_nackTemplate.Set (header);
 }
 
 void DhcpServer::StopApplication ()
@@ -171,44 +464,82 @@ void DhcpServer::StopApplication ()
     {
       m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
     }
+  for (ServedInterfacesIter i = m_interfaces.begin (); i != m_interfaces.end (); i++)
+    {
+      i->second.socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+    }
 
-  m_leasedAddresses.clear ();
+  if (!m_leaseFile.empty ())
+    {
+      SaveLeases ();
+    }
+  m_leases.Clear ();
+  m_expiredAddresses.assign (m_pools.size (), DhcpLeaseTable::ExpiredQueue ());
+  m_expiryHeap.clear ();
   Simulator::Remove (m_expiredEvent);
+  m_quarantine.clear ();
+  Simulator::Remove (m_quarantineEvent);
+
+  for (uint32_t i = 0; i < N_CLASSES; i++)
+    {
+      m_pending[i].clear ();
+    }
+  m_nPending = 0;
+  m_tokenBuckets.clear ();
+  Simulator::Remove (m_processEvent);
 }
 
 void DhcpServer::TimerHandler ()
 {
   NS_LOG_FUNCTION (this);
 
-  // Set up timeout events and release of unsolicited addresses from the list
-  LeasedAddressIter i;
-  for (i = m_leasedAddresses.begin (); i != m_leasedAddresses.end (); i++)
+  // Pop every lease whose expiry time has come. Entries left behind by a
+  // renewal or by the reuse of the address no longer match the lease.
+  Time now = Simulator::Now ();
+  while (!m_expiryHeap.empty () && m_expiryHeap.front ().first <= now)
     {
-      // update the address state   
-      if (i->second.second != 0xffffffff && i->second.second != 0)
+      std::pair<Time, uint32_t> expiry = m_expiryHeap.front ();
+      std::pop_heap (m_expiryHeap.begin (), m_expiryHeap.end (), std::greater<std::pair<Time, uint32_t> > ());
+      m_expiryHeap.pop_back ();
+
+      DhcpLeaseTable::Lease &lease = m_leases.Get (expiry.second);
+      if (lease.state == DhcpLeaseTable::LEASE_ACTIVE && lease.expiry == expiry.first)
         {
-          i->second.second--;                     
-          if (i->second.second == 0)
-            {
-              NS_LOG_INFO ("Address leased state expired, address removed - " <<
-                           "chaddr: " << i->first <<
-                           "IP address " << i->second.first);
-              i->second.second = 0;
-              m_expiredAddresses.push_front (i->first);   
-            }
+          NS_LOG_INFO ("Address leased state expired, address removed - " <<
+                       "chaddr: " << lease.GetChaddr () <<
+                       "IP address " << lease.address);
+          lease.state = DhcpLeaseTable::LEASE_EXPIRED;
+          m_leases.PushExpired (m_expiredAddresses[lease.pool], expiry.second);
         }
     }
-  m_expiredEvent = Simulator::Schedule (Seconds (1), &DhcpServer::TimerHandler, this);  
+  if (!m_expiryHeap.empty ())
+    {
+      m_expiredEvent = Simulator::Schedule (m_expiryHeap.front ().first - now, &DhcpServer::TimerHandler, this);
+    }
 } 
 
+void DhcpServer::ScheduleExpiry (uint32_t lease, Time expiry)
+{
+  NS_LOG_FUNCTION (this << lease << expiry);
+
+  m_expiryHeap.push_back (std::make_pair (expiry, lease));
+  std::push_heap (m_expiryHeap.begin (), m_expiryHeap.end (), std::greater<std::pair<Time, uint32_t> > ());
+
+  // Only one event is pending, for the earliest expiry
+  if (!m_expiredEvent.IsRunning () || expiry < Simulator::Now () + Simulator::GetDelayLeft (m_expiredEvent))
+    {
+      Simulator::Remove (m_expiredEvent);
+      m_expiredEvent = Simulator::Schedule (expiry - Simulator::Now (), &DhcpServer::TimerHandler, this);
+    }
+}
+
 void DhcpServer::NetHandler (Ptr<Socket> socket)
 {
   NS_LOG_FUNCTION (this << socket);
 
-  DhcpHeader header; 
   Ptr<Packet> packet = 0;
   Address from;
-  packet = m_socket->RecvFrom (from); 
+  packet = socket->RecvFrom (from); 
   
   InetSocketAddress senderAddr = InetSocketAddress::ConvertFrom (from);  
 
@@ -219,243 +550,517 @@ void DhcpServer::NetHandler (Ptr<Socket> socket)
     }
   uint32_t incomingIf = interfaceInfo.GetRecvIf ();  
   Ptr<NetDevice> iDev = GetNode ()->GetDevice (incomingIf);   
+  ServedInterfacesIter iface = m_interfaces.find (GetNode ()->GetObject<Ipv4> ()->GetInterfaceForDevice (iDev));
+  if (iface == m_interfaces.end ())
+    {
+      NS_LOG_LOGIC ("DHCP message received on an interface which is not served, ignoring it");
+      return;
+    }
 
-  if (packet->RemoveHeader (header) == 0) 
+  // The message is read in place, only the fields used are decoded
+  DhcpHeaderView header (packet);
+  if (!header.IsValid ())
     {
       return;
     }
-  if (header.GetType () == DhcpHeader::DHCPDISCOVER)
+
+  MessageClass messageClass = Classify (header);
+  if (messageClass == CLASS_NEW && !TakeToken (header))
     {
-      SendOffer (iDev, header, senderAddr); 
+      NS_LOG_LOGIC ("Too many new messages from relay agent " << header.GetGiAddr () << ", dropping one");
+      m_rateDrops++;
+      return;
     }
-  if (header.GetType () == DhcpHeader::DHCPREQ && CheckIfValid (header.GetReq ()))
+  if (m_processingTime.IsZero ())
     {
-      SendAck (iDev, header, senderAddr); 
+      HandleMessage (iface->second, header, senderAddr);
+      return;
     }
+  PendingMessage message = { packet, iface->first, senderAddr };
+  Enqueue (message, messageClass);
 }
 
-void DhcpServer::SendOffer (Ptr<NetDevice> iDev, DhcpHeader header, InetSocketAddress from)
+DhcpServer::MessageClass DhcpServer::Classify (const DhcpHeaderView &header)
 {
-  NS_LOG_FUNCTION (this << iDev << header << from);
+  uint8_t type = header.GetType ();
+  if (type == DhcpHeader::DHCPRELEASE || type == DhcpHeader::DHCPDECLINE
+      || (type == DhcpHeader::DHCPREQ && header.GetCiaddr () != Ipv4Address::GetAny ()))
+    {
+      return CLASS_BOUND;
+    }
+  if (type == DhcpHeader::DHCPREQ)
+    {
+      return CLASS_SELECTING;
+    }
+  return CLASS_NEW;
+}
+
+bool DhcpServer::TakeToken (const DhcpHeaderView &header)
+{
+  NS_LOG_FUNCTION (this << header);
+
+  if (m_giaddrRate <= 0)
+    {
+      return true;
+    }
+
+  Time now = Simulator::Now ();
+  TokenBuckets::iterator i = m_tokenBuckets.find (header.GetGiAddr ());
+  if (i == m_tokenBuckets.end ())
+    {
+      TokenBucket bucket;
+      bucket.tokens = m_giaddrBurst;
+      bucket.last = now;
+      i = m_tokenBuckets.insert (std::make_pair (header.GetGiAddr (), bucket)).first;
+    }
+  TokenBucket &bucket = i->second;
+  bucket.tokens = std::min<double> (m_giaddrBurst, bucket.tokens + (now - bucket.last).GetSeconds () * m_giaddrRate);
+  bucket.last = now;
+  if (bucket.tokens < 1)
+    {
+      return false;
+    }
+  bucket.tokens--;
+  return true;
+}
+
+void DhcpServer::Enqueue (const PendingMessage &message, MessageClass messageClass)
+{
+  NS_LOG_FUNCTION (this << messageClass);
+
+  if (m_nPending >= m_queueLimit)
+    {
+      uint32_t lowest = N_CLASSES - 1;
+      while (lowest > (uint32_t) messageClass && m_pending[lowest].empty ())
+        {
+          lowest--;
+        }
+      m_queueDrops++;
+      if (lowest == (uint32_t) messageClass)
+        {
+          NS_LOG_LOGIC ("Queue full, dropping a message of class " << messageClass);
+          return;
+        }
+      NS_LOG_LOGIC ("Queue full, dropping a message of class " << lowest << " for one of class " << messageClass);
+      m_pending[lowest].pop_back ();
+      m_nPending--;
+    }
+
+  m_pending[messageClass].push_back (message);
+  m_nPending++;
+  if (!m_processEvent.IsRunning ())
+    {
+      m_processEvent = Simulator::Schedule (m_processingTime, &DhcpServer::ProcessPending, this);
+    }
+}
+
+void DhcpServer::ProcessPending (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  uint32_t messageClass = 0;
+  while (m_pending[messageClass].empty ())
+    {
+      messageClass++;
+    }
+  PendingMessage message = m_pending[messageClass].front ();
+  m_pending[messageClass].pop_front ();
+  m_nPending--;
+
+  ServedInterfacesIter iface = m_interfaces.find (message.ifIndex);
+  if (iface != m_interfaces.end ())
+    {
+      DhcpHeaderView header (message.packet);
+      HandleMessage (iface->second, header, message.from);
+    }
+
+  if (m_nPending > 0)
+    {
+      m_processEvent = Simulator::Schedule (m_processingTime, &DhcpServer::ProcessPending, this);
+    }
+}
+
+void DhcpServer::HandleMessage (const ServedInterface &iface, const DhcpHeaderView &header, InetSocketAddress from)
+{
+  NS_LOG_FUNCTION (this << header << from);
+
+  uint8_t type = header.GetType ();
+  if (type == DhcpHeader::DHCPDISCOVER)
+    {
+      SendOffer (iface, header, from); 
+    }
+  if (type == DhcpHeader::DHCPREQ && header.GetDhcps () != Ipv4Address::GetAny ()
+      && GetNode ()->GetObject<Ipv4> ()->GetInterfaceForAddress (header.GetDhcps ()) < 0)
+    {
+      NS_LOG_LOGIC ("DHCP REQUEST for server " << header.GetDhcps () << ", ignoring it");
+      return;
+    }
+  if (type == DhcpHeader::DHCPREQ)
+    {
+      SendAck (iface, header, from); 
+    }
+  if (type == DhcpHeader::DHCPRELEASE)
+    {
+      ReleaseAddress (header);
+    }
+  if (type == DhcpHeader::DHCPDECLINE)
+    {
+      DeclineAddress (header);
+    }
+  if (type == DhcpHeader::DHCPINFORM)
+    {
+      SendInformAck (iface, header, from);
+    }
+}
+
+void DhcpServer::SendOffer (const ServedInterface &iface, const DhcpHeaderView &header, InetSocketAddress from)
+{
+  NS_LOG_FUNCTION (this << iface.device << header << from);
 
-  DhcpHeader newDhcpHeader;
-  Address sourceChaddr = header.GetChaddr ();  
   uint32_t tran = header.GetTran ();  
   Ptr<Packet> packet = 0;
   Ipv4Address offeredAddress;  
+  uint32_t poolIndex = 0;
 
   NS_LOG_INFO ("DHCP DISCOVER from: " << from.GetIpv4 () << " source port: " <<  from.GetPort ());
 
-  uint32_t mask = header.GetMask ();       
   Ipv4Address giAddr = header.GetGiAddr (); 
 
-  LeasedAddressIter iter = m_leasedAddresses.find (sourceChaddr);
-  if (iter != m_leasedAddresses.end ()) 
+  const uint8_t *chaddr = header.GetChaddrBuffer ();
+  uint32_t index = m_leases.Find (chaddr);
+  if (index != DhcpLeaseTable::NONE) 
     {
       // We know this client from some time ago
-      if (m_leasedAddresses[sourceChaddr].second != 0 && m_leasedAddresses[sourceChaddr].second != 0xffffffff)
+      DhcpLeaseTable::Lease &lease = m_leases.Get (index);
+      if (lease.state == DhcpLeaseTable::LEASE_ACTIVE && lease.expiry > Simulator::Now ())
         {
-          NS_LOG_LOGIC ("This client is sending a DISCOVER but it has still a lease active - perhaps it didn't shut down gracefully: " << sourceChaddr);
+          NS_LOG_LOGIC ("This client is sending a DISCOVER but it has still a lease active - perhaps it didn't shut down gracefully: " << header.GetChaddr ());
         }
 
-      m_expiredAddresses.remove (sourceChaddr);
-      offeredAddress = m_leasedAddresses[sourceChaddr].first;
+      if (lease.state == DhcpLeaseTable::LEASE_EXPIRED)
+        {
+          m_leases.RemoveExpired (m_expiredAddresses[lease.pool], index);
+        }
+      offeredAddress = lease.address;
     }
   else 
     {
-      // No previous record of the client, we must find a suitable address and create a record.
-      if (!m_availableAddresses.empty ())
+      // No previous record of the client, we must find a suitable address
+      // and create a record, in the pools of the client network.
+      uint32_t relayPool;
+      uint32_t nCandidates;
+      const uint32_t *candidates = GetClientPools (iface, giAddr, relayPool, nCandidates);
+
+      // use an address never used before (if there is one)
+      for (uint32_t i = 0; i < nCandidates && offeredAddress == Ipv4Address (); i++)
         {
-          AvailableAddressIter i; 
-          if (giAddr == Ipv4Address ("0.0.0.0"))
+          poolIndex = candidates[i];
+          if (m_allocationPolicy == ALLOCATE_HASH)
             {
-              // use an address never used before (if there is one)
-              i = m_availableAddresses.begin ();
-              offeredAddress = (*i).first;
-              m_availableAddresses.pop_front ();
+              offeredAddress = m_pools[poolIndex].Allocate (GetAllocationHash (chaddr));
             }
           else
             {
-              for (i = m_availableAddresses.begin (); i != m_availableAddresses.end (); i++)
-                {
-                  if (giAddr.CombineMask(Ipv4Mask(mask)).Get () == (*i).first.CombineMask((*i).second).Get ())
-                   {
-                     offeredAddress = (*i).first;
-                     m_availableAddresses.erase (i);
-                     break;      
-                   }
-                }
+              offeredAddress = m_pools[poolIndex].Allocate ();
             }
         }
-      else
+      if (offeredAddress == Ipv4Address ())
         {
-          // there's still hope: reuse the old ones.
-          if (!m_expiredAddresses.empty ())
-            { 
-              ExpiredAddressIter j;
-              for (j = m_expiredAddresses.begin();j != m_expiredAddresses.end(); j++)
-                {  
-                  Address oldestChaddr = (*j);
-                  if (giAddr.CombineMask(Ipv4Mask(mask)).Get() == m_leasedAddresses[oldestChaddr].first.CombineMask(Ipv4Mask(m_leasedAddresses[oldestChaddr].second)).Get())
-                    {
-                      m_expiredAddresses.erase(j);
-                      offeredAddress = m_leasedAddresses[oldestChaddr].first;
-                      m_leasedAddresses.erase (oldestChaddr);
-                      break;
-                    }
-              	}
+          // there's still hope: reuse the address that expired first.
+          for (uint32_t i = 0; i < nCandidates; i++)
+            {
+              poolIndex = candidates[i];
+              uint32_t oldest = m_expiredAddresses[poolIndex].head;
+              if (oldest != DhcpLeaseTable::NONE)
+                {
+                  offeredAddress = m_leases.Get (oldest).address;
+                  m_leases.RemoveExpired (m_expiredAddresses[poolIndex], oldest);
+                  m_leases.Remove (oldest);
+                  break;
+                }
             }
         }
     }
     
   if (offeredAddress != Ipv4Address ())
     {
-      m_leasedAddresses[sourceChaddr] = std::make_pair (offeredAddress, m_lease.GetSeconds ());  
+      if (index == DhcpLeaseTable::NONE)
+        {
+          index = m_leases.Insert (chaddr);
+          m_leases.Get (index).pool = poolIndex;
+        }
+      DhcpLeaseTable::Lease &lease = m_leases.Get (index);
+      if (lease.state != DhcpLeaseTable::LEASE_STATIC)
+        {
+          lease.address = offeredAddress;
+          lease.state = DhcpLeaseTable::LEASE_ACTIVE;
+          lease.expiry = Simulator::Now () + m_lease;
+          ScheduleExpiry (index, lease.expiry);
+        }
 
-      packet = Create<Packet> ();
-      newDhcpHeader.ResetOpt ();
-      newDhcpHeader.SetType (DhcpHeader::DHCPOFFER); 
-      newDhcpHeader.SetChaddr (sourceChaddr); 
-      newDhcpHeader.SetYiaddr (offeredAddress);
+      // The lease is already committed: with Rapid Commit, it is acknowledged
+      // instead of offered and the client does not send a REQUEST.
+      bool rapidCommit = m_rapidCommit && header.IsRapidCommit ();
+      const char *reply = rapidCommit ? "DHCP ACK (Rapid Commit)" : "DHCP OFFER";
 
       Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
-      Ipv4Address myAddress = ipv4->SelectSourceAddress (iDev, offeredAddress, Ipv4InterfaceAddress::InterfaceAddressScope_e::GLOBAL);
-
-      newDhcpHeader.SetDhcps (myAddress);  
-      newDhcpHeader.SetMask(mask);    
-      newDhcpHeader.SetTran (tran);  
-      newDhcpHeader.SetLease (m_lease.GetSeconds ()); 
-      newDhcpHeader.SetRenew (m_renew.GetSeconds ()); 
-      newDhcpHeader.SetRebind (m_rebind.GetSeconds ()); 
-      newDhcpHeader.SetTime ();
-      newDhcpHeader.SetGiAddr(giAddr);   
-      if (m_gateway != Ipv4Address ()) 
-        {
-          newDhcpHeader.SetRouter (m_gateway);
-        }
-      packet->AddHeader (newDhcpHeader);
+      Ipv4Address myAddress = ipv4->SelectSourceAddress (iface.device, offeredAddress, Ipv4InterfaceAddress::InterfaceAddressScope_e::GLOBAL);
+
+      // the mask is the one of the pool holding the offered address
+      DhcpResponseTemplate &response = (rapidCommit ? m_rapidAckTemplates : m_offerTemplates)[lease.pool];
+      // A relay agent gets its information back (RFC 3046)
+      uint8_t agentInfo[257];
+      uint32_t agentInfoLen = header.CopyOption (DhcpHeader::OP_AGENT_INFO, agentInfo);
+      packet = response.CreatePacket (tran, chaddr, offeredAddress, giAddr, myAddress, agentInfo, agentInfoLen);
 
       if (giAddr == Ipv4Address ("0.0.0.0")) // there is no relay need to broadcast the message
         {
-          if ((m_socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), from.GetPort ()))) >= 0)
+          if ((iface.socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), from.GetPort ()))) >= 0)
             {
-              NS_LOG_INFO ("DHCP OFFER" << " Offered Address: " << offeredAddress);
+              NS_LOG_INFO (reply << " Offered Address: " << offeredAddress);
             }
           else
             {
-              NS_LOG_INFO ("Error while sending DHCP OFFER");
+              NS_LOG_INFO ("Error while sending " << reply);
             }
         }
       else    
         {
-          if ((m_socket->SendTo (packet, 0, InetSocketAddress (from.GetIpv4 (), from.GetPort ()))) >= 0)
+          if ((iface.socket->SendTo (packet, 0, InetSocketAddress (from.GetIpv4 (), from.GetPort ()))) >= 0)
             {
-              NS_LOG_INFO ("DHCP OFFER" << " Offered Address: " << offeredAddress);
+              NS_LOG_INFO (reply << " Offered Address: " << offeredAddress);
             }
           else
             {
-              NS_LOG_INFO ("Error while sending DHCP OFFER");
+              NS_LOG_INFO ("Error while sending " << reply);
             }
         }
     }
 }
 
-void DhcpServer::SendAck (Ptr<NetDevice> iDev, DhcpHeader header, InetSocketAddress from)
+void DhcpServer::SendAck (const ServedInterface &iface, const DhcpHeaderView &header, InetSocketAddress from)
 {
-  NS_LOG_FUNCTION (this << iDev << header << from);
+  NS_LOG_FUNCTION (this << iface.device << header << from);
 
-  DhcpHeader newDhcpHeader;
-  Address sourceChaddr = header.GetChaddr ();
   uint32_t tran = header.GetTran ();
   Ptr<Packet> packet = 0;
-  Ipv4Address address = header.GetReq ();
+  Ipv4Address address = GetRequestedAddress (header);
 
   NS_LOG_INFO ("DHCP REQUEST from: " << from.GetIpv4 () <<
                " source port: " <<  from.GetPort () <<
                " - refreshed addr: " << address);
 
-  LeasedAddressIter iter;
-  iter = m_leasedAddresses.find (sourceChaddr);
-  if (iter != m_leasedAddresses.end ())
+  uint8_t agentInfo[257];
+  uint32_t agentInfoLen = header.CopyOption (DhcpHeader::OP_AGENT_INFO, agentInfo);
+
+  // The replies carry the server identifier, and the giaddr back to the relay agent
+  Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
+  Ipv4Address myAddress = ipv4->SelectSourceAddress (iface.device, address, Ipv4InterfaceAddress::InterfaceAddressScope_e::GLOBAL);
+  Ipv4Address giAddr = header.GetGiAddr ();
+
+  // The client network is the subnet of the relay agent, or of the incoming
+  // interface; a server without pool there knows nothing of the client.
+  uint32_t relayPool;
+  uint32_t nPools;
+  const uint32_t *pools = GetClientPools (iface, giAddr, relayPool, nPools);
+  if (nPools == 0)
+    {
+      NS_LOG_LOGIC ("DHCP REQUEST from a network without pool, ignoring it");
+      return;
+    }
+  bool onNetwork = false;
+  for (uint32_t i = 0; i < nPools; i++)
+    {
+      Ipv4Mask mask = m_pools[pools[i]].GetPoolMask ();
+      onNetwork = onNetwork || address.CombineMask (mask) == m_pools[pools[i]].GetPoolAddress ().CombineMask (mask);
+    }
+
+  // RFC 2131, section 4.3.2: an address on the wrong network is refused; a
+  // client without binding is not answered, another server may hold its
+  // lease; a client asking for another address than its lease is refused.
+  uint32_t index = m_leases.Find (header.GetChaddrBuffer ());
+  if (onNetwork && index == DhcpLeaseTable::NONE)
+    {
+      NS_LOG_INFO ("DHCP REQUEST from a client without lease, ignoring it");
+      return;
+    }
+  if (onNetwork && m_leases.Get (index).address == address)
     {
       // update the lease time of this address - send ACK
-      (iter->second.second) += m_lease.GetSeconds ();
-      packet = Create<Packet> ();
-      newDhcpHeader.ResetOpt ();
-      newDhcpHeader.SetType (DhcpHeader::DHCPACK);
-      newDhcpHeader.SetChaddr (sourceChaddr);
-      newDhcpHeader.SetYiaddr (address);
-      newDhcpHeader.SetTran (tran);
-      newDhcpHeader.SetTime ();
-      packet->AddHeader (newDhcpHeader);
-
-      if (from.GetIpv4 () != Ipv4Address ("0.0.0.0"))  // there is no relay need to broadcast the message
+      DhcpLeaseTable::Lease &lease = m_leases.Get (index);
+      if (lease.state != DhcpLeaseTable::LEASE_STATIC)
         {
-          if (from.GetIpv4 () != address)
+          if (lease.state == DhcpLeaseTable::LEASE_EXPIRED)
             {
-              m_socket->SendTo (packet, 0, InetSocketAddress (from.GetIpv4 (), from.GetPort ()));
-            }
-          else
-            {
-              m_socket->SendTo (packet, 0, from);
+              m_leases.RemoveExpired (m_expiredAddresses[lease.pool], index);
             }
+          lease.state = DhcpLeaseTable::LEASE_ACTIVE;
+          lease.expiry = Simulator::Now () + m_lease;
+          ScheduleExpiry (index, lease.expiry);
         }
-      else 
+      packet = m_ackTemplate.CreatePacket (tran, header.GetChaddrBuffer (), address, giAddr, myAddress,
+                                           agentInfo, agentInfoLen);
+    }
+  else
+    {
+      // Wrong network or address - send NACK
+      packet = m_nackTemplate.CreatePacket (tran, header.GetChaddrBuffer (), address, giAddr, myAddress,
+                                            agentInfo, agentInfoLen);
+      NS_LOG_INFO ("DHCP NACK for " << address << (onNetwork ? ", not the lease of the client" : ", wrong network"));
+    }
+
+  if (from.GetIpv4 () != Ipv4Address ("0.0.0.0"))  // there is no relay need to broadcast the message
+    {
+      if (from.GetIpv4 () != address)
         {
-          if (from.GetIpv4 () != address)
-            {
-              m_socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), from.GetPort ()));
-            }
-          else
-            {
-              m_socket->SendTo (packet, 0, from);
-            }
+          iface.socket->SendTo (packet, 0, InetSocketAddress (from.GetIpv4 (), from.GetPort ()));
+        }
+      else
+        {
+          iface.socket->SendTo (packet, 0, from);
         }
-
     }
   else
     {
-      // Deleted or expired lease - send NACK
-      packet = Create<Packet> ();
-      newDhcpHeader.ResetOpt ();
-      newDhcpHeader.SetType (DhcpHeader::DHCPNACK);
-      newDhcpHeader.SetChaddr (sourceChaddr);
-      newDhcpHeader.SetYiaddr (address);
-      newDhcpHeader.SetTran (tran);
-      newDhcpHeader.SetTime ();
-      packet->AddHeader (newDhcpHeader);
-      
-      if (from.GetIpv4 () != Ipv4Address ("0.0.0.0"))
+      if (from.GetIpv4 () != address)
         {
-          if (from.GetIpv4 () != address)
-            {
-              m_socket->SendTo (packet, 0, InetSocketAddress (from.GetIpv4 (), from.GetPort ()));
-            }
-          else
-            {
-              m_socket->SendTo (packet, 0, from);
-            }
-        } 
+          iface.socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), from.GetPort ()));
+        }
       else
         {
-          if (from.GetIpv4 () != address)
-            {
-              m_socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), from.GetPort ()));
-            }
-          else
-            {
-              m_socket->SendTo (packet, 0, from);
-            }
+          iface.socket->SendTo (packet, 0, from);
         }
+    }
+}
+
+void DhcpServer::ReleaseAddress (const DhcpHeaderView &header)
+{
+  NS_LOG_FUNCTION (this << header);
 
-      NS_LOG_INFO ("IP addr does not exists or released!");
+  uint32_t index = m_leases.Find (header.GetChaddrBuffer ());
+  if (index == DhcpLeaseTable::NONE)
+    {
+      NS_LOG_INFO ("DHCP RELEASE from a client without lease, ignored");
+      return;
+    }
+  DhcpLeaseTable::Lease &lease = m_leases.Get (index);
+  if (lease.state == DhcpLeaseTable::LEASE_STATIC || lease.address != header.GetCiaddr ())
+    {
+      NS_LOG_INFO ("DHCP RELEASE of " << header.GetCiaddr () << " ignored, the lease is static or for another address");
+      return;
+    }
+
+  NS_LOG_INFO ("DHCP RELEASE - address back to the pool: " << lease.address);
+  if (lease.state == DhcpLeaseTable::LEASE_EXPIRED)
+    {
+      m_leases.RemoveExpired (m_expiredAddresses[lease.pool], index);
+    }
+  m_pools[lease.pool].Release (lease.address);
+  m_leases.Remove (index);
+}
+
+void DhcpServer::DeclineAddress (const DhcpHeaderView &header)
+{
+  NS_LOG_FUNCTION (this << header);
+
+  uint32_t index = m_leases.Find (header.GetChaddrBuffer ());
+  if (index == DhcpLeaseTable::NONE)
+    {
+      NS_LOG_INFO ("DHCP DECLINE from a client without lease, ignored");
+      return;
+    }
+  DhcpLeaseTable::Lease &lease = m_leases.Get (index);
+  if (lease.state == DhcpLeaseTable::LEASE_STATIC || lease.address != header.GetReq ())
+    {
+      NS_LOG_INFO ("DHCP DECLINE of " << header.GetReq () << " ignored, the lease is static or for another address");
+      return;
+    }
+
+  // The address is in use by someone else: it stays allocated in its pool
+  // until the end of the quarantine, and the client will get another one.
+  Ipv4Address addr = lease.address;
+  NS_LOG_INFO ("DHCP DECLINE - address quarantined for " << m_declineTime.As (Time::S) << ": " << addr);
+  if (lease.state == DhcpLeaseTable::LEASE_EXPIRED)
+    {
+      m_leases.RemoveExpired (m_expiredAddresses[lease.pool], index);
+    }
+  m_leases.Remove (index);
+
+  // All the quarantines last the same time, so they end in order
+  m_quarantine.push_back (std::make_pair (Simulator::Now () + m_declineTime, addr));
+  if (!m_quarantineEvent.IsRunning ())
+    {
+      m_quarantineEvent = Simulator::Schedule (m_declineTime, &DhcpServer::EndQuarantine, this);
+    }
+}
+
+void DhcpServer::EndQuarantine (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Time now = Simulator::Now ();
+  while (!m_quarantine.empty () && m_quarantine.front ().first <= now)
+    {
+      DhcpAddressPool *pool = FindPoolForAddress (m_quarantine.front ().second);
+      if (pool != 0)
+        {
+          pool->Release (m_quarantine.front ().second);
+        }
+      m_quarantine.pop_front ();
+    }
+  if (!m_quarantine.empty ())
+    {
+      m_quarantineEvent = Simulator::Schedule (m_quarantine.front ().first - now, &DhcpServer::EndQuarantine, this);
+    }
+}
+
+void DhcpServer::SendInformAck (const ServedInterface &iface, const DhcpHeaderView &header, InetSocketAddress from)
+{
+  NS_LOG_FUNCTION (this << iface.device << header << from);
+
+  Ipv4Address ciAddr = header.GetCiaddr ();
+  NS_LOG_INFO ("DHCP INFORM from: " << ciAddr);
+  if (ciAddr == Ipv4Address ("0.0.0.0"))
+    {
+      return;
+    }
+
+  // The client has an address already: no address and no lease time (RFC 2131, 4.3.5)
+  DhcpHeader newDhcpHeader;
+  Ptr<Packet> packet = Create<Packet> ();
+  newDhcpHeader.ResetOpt ();
+  newDhcpHeader.SetType (DhcpHeader::DHCPACK);
+  newDhcpHeader.SetChaddr (header.GetChaddr ());
+  newDhcpHeader.SetCiaddr (ciAddr);
+  newDhcpHeader.SetTran (header.GetTran ());
+  newDhcpHeader.SetTime ();
+
+  Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
+  newDhcpHeader.SetDhcps (ipv4->SelectSourceAddress (iface.device, ciAddr, Ipv4InterfaceAddress::InterfaceAddressScope_e::GLOBAL));
+  DhcpAddressPool *pool = FindPoolForSubnet (ciAddr);
+  if (pool != 0)
+    {
+      newDhcpHeader.SetMask (pool->GetPoolMask ().Get ());
+    }
+  if (m_gateway != Ipv4Address ()) 
+    {
+      newDhcpHeader.SetRouter (m_gateway);
+    }
+  packet->AddHeader (newDhcpHeader);
+
+  if ((iface.socket->SendTo (packet, 0, InetSocketAddress (ciAddr, from.GetPort ()))) >= 0)
+    {
+      NS_LOG_INFO ("DHCP ACK (INFORM) sent to " << ciAddr);
+    }
+  else
+    {
+      NS_LOG_INFO ("Error while sending DHCP ACK (INFORM)");
     }
 }
 
 void DhcpServer::AddStaticDhcpEntry (Address chaddr, Ipv4Address addr)
 {
   NS_LOG_FUNCTION (this << chaddr << addr);
-  Address cleanedCaddr;
 
   NS_ASSERT_MSG (CheckIfValid (addr), "Required address is not in the pool ");
 
@@ -465,53 +1070,105 @@ void DhcpServer::AddStaticDhcpEntry (Address chaddr, Ipv4Address addr)
   std::memset (buffer, 0, Address::MAX_SIZE); 
   uint32_t len = chaddr.CopyTo (buffer);   
   NS_ASSERT_MSG (len <= 16, "DHCP server can not handle a chaddr larger than 16 bytes");
-  cleanedCaddr.CopyFrom (buffer, 16); 
 
-  NS_ASSERT_MSG (m_leasedAddresses.find (cleanedCaddr) == m_leasedAddresses.end (),
-                 "Client has already an active lease: " << m_leasedAddresses[cleanedCaddr].first);
+  NS_ASSERT_MSG (m_leases.Find (buffer) == DhcpLeaseTable::NONE,
+                 "Client has already an active lease: " << m_leases.Get (m_leases.Find (buffer)).address);
 
-  AvailableAddressIter i;	
-  for (i = m_availableAddresses.begin (); i != m_availableAddresses.end (); i++)
-    {
-      if ((*i).first.Get () == addr.Get ())
-        {
-      	  m_availableAddresses.erase (i);
-      	  break;
-        }
-    }
-  
-  NS_ASSERT_MSG (i == m_availableAddresses.end (),
-                  "Required address is not available (perhaps it has been already assigned): " << addr);
+  DhcpAddressPool *pool = FindPoolForAddress (addr);
+  bool reserved = pool->Reserve (addr);
+  NS_ASSERT_MSG (reserved,
+                 "Required address is not available (perhaps it has been already assigned): " << addr);
 
-  m_leasedAddresses[cleanedCaddr] = std::make_pair (addr, 0xffffffff); 
+  DhcpLeaseTable::Lease &lease = m_leases.Get (m_leases.Insert (buffer));
+  lease.address = addr;
+  lease.state = DhcpLeaseTable::LEASE_STATIC;
+  lease.pool = pool - &m_pools[0];
 }
 
 void DhcpServer::AddSubnets (Ipv4Address poolAddr, Ipv4Mask poolMask, Ipv4Address minAddr, 
                              Ipv4Address maxAddr)
 {
-  PoolAddressIter i;
-  for (i = m_poolAddresses.begin() ; i != m_poolAddresses.end() ; i++)
+  NS_LOG_FUNCTION (this << poolAddr << poolMask << minAddr << maxAddr);
+
+  if (m_poolSubnets.find (std::make_pair (poolMask.Get (), poolAddr.CombineMask (poolMask).Get ())) != m_poolSubnets.end ())
     {
-      if ((*i).first.first.CombineMask ((*i).first.second).Get() == poolAddr.CombineMask (poolMask).Get())
-        {
-          NS_ABORT_MSG("Same Pool Address cannot be assigned twice");
-        }
-  }
-  m_poolAddresses.push_back(std::make_pair(std::make_pair(poolAddr, poolMask),std::make_pair(minAddr, maxAddr)));
+      NS_ABORT_MSG ("Same Pool Address cannot be assigned twice");
+    }
+
+  NS_ABORT_MSG_IF (OverlapsPool (minAddr, maxAddr),
+                   "Address range " << minAddr << "-" << maxAddr << " overlaps another pool");
+
+  m_poolRanges[minAddr.Get ()] = m_pools.size ();
+  m_poolSubnets[std::make_pair (poolMask.Get (), poolAddr.CombineMask (poolMask).Get ())] = m_pools.size ();
+  m_poolMasks.insert (poolMask.Get ());
+  m_pools.push_back (DhcpAddressPool (poolAddr, poolMask, minAddr, maxAddr));
+  m_expiredAddresses.push_back (DhcpLeaseTable::ExpiredQueue ());
+}
+
+bool DhcpServer::OverlapsPool (Ipv4Address minAddr, Ipv4Address maxAddr) const
+{
+  // The ranges do not overlap, so only the neighbours of the new range can overlap it
+  PoolRangeIndexCIter next = m_poolRanges.upper_bound (minAddr.Get ());
+  if (next != m_poolRanges.end () && next->first <= maxAddr.Get ())
+    {
+      return true;
+    }
+  if (next != m_poolRanges.begin ())
+    {
+      PoolRangeIndexCIter prev = next;
+      prev--;
+      return m_pools[prev->second].GetMaxAddress ().Get () >= minAddr.Get ();
+    }
+  return false;
 }
 
 bool DhcpServer::CheckIfValid (Ipv4Address reqAddr)
 {
-  bool flag = false;
-  PoolAddressIter iter;
-  for (iter = m_poolAddresses.begin (); iter != m_poolAddresses.end (); iter ++)
+  return FindPoolForAddress (reqAddr) != 0;
+}
+
+DhcpAddressPool * DhcpServer::FindPoolForAddress (Ipv4Address addr)
+{
+  // The candidate is the pool with the highest lower bound not above the address
+  PoolRangeIndexCIter iter = m_poolRanges.upper_bound (addr.Get ());
+  if (iter == m_poolRanges.begin ())
     {
-      if ((reqAddr.Get () >= (*iter).second.first.Get ()) && (reqAddr.Get () <= (*iter).second.second.Get ()))
-      {
-      	flag = true;
-      }
-    } 
-  return flag;
+      return 0;
+    }
+  iter--;
+  DhcpAddressPool *pool = &m_pools[iter->second];
+  return pool->IsInRange (addr) ? pool : 0;
+}
+
+const uint32_t * DhcpServer::GetClientPools (const ServedInterface &iface, Ipv4Address giAddr,
+                                             uint32_t &relayPool, uint32_t &nPools)
+{
+  // Without a relay the pools of the incoming interface subnets are used,
+  // otherwise the pool of the relay subnet.
+  if (giAddr != Ipv4Address ("0.0.0.0"))
+    {
+      DhcpAddressPool *pool = FindPoolForSubnet (giAddr);
+      relayPool = (pool != 0) ? pool - &m_pools[0] : 0;
+      nPools = (pool != 0) ? 1 : 0;
+      return &relayPool;
+    }
+  nPools = iface.pools.size ();
+  return iface.pools.empty () ? 0 : &iface.pools[0];
+}
+
+DhcpAddressPool * DhcpServer::FindPoolForSubnet (Ipv4Address giAddr)
+{
+  // A contiguous mask with a longer prefix is numerically larger
+  std::set<uint32_t>::const_reverse_iterator mask;
+  for (mask = m_poolMasks.rbegin (); mask != m_poolMasks.rend (); mask++)
+    {
+      PoolSubnetIndexCIter iter = m_poolSubnets.find (std::make_pair (*mask, giAddr.Get () & *mask));
+      if (iter != m_poolSubnets.end ())
+        {
+          return &m_pools[iter->second];
+        }
+    }
+  return 0;
 }
 
 } // Namespace ns3
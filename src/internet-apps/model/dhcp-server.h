@@ -30,9 +30,17 @@
 #include "ns3/ptr.h"
 #include "ns3/address.h"
 #include "ns3/traced-value.h"
+#include "ns3/nstime.h"
 #include "ns3/inet-socket-address.h"
 #include "dhcp-header.h"
+#include "dhcp-header-view.h"
+#include "dhcp-address-pool.h"
+#include "dhcp-lease-table.h"
+#include "dhcp-response-template.h"
 #include <map>
+#include <set>
+#include <vector>
+#include <deque>
 
 namespace ns3 {
 
@@ -57,6 +65,13 @@ public:
   DhcpServer ();     
   virtual ~DhcpServer ();  
 
+  /// Choice of the address offered to a client without a lease
+  enum AllocationPolicy
+  {
+    ALLOCATE_FIRST_FREE,  //!< The lowest free address of the pool
+    ALLOCATE_HASH         //!< The first free address from a position given by a hash of the client chaddr
+  };
+
   /**
    * \brief Add a static entry to the pool.
    * \param chaddr The client chaddr.
@@ -73,6 +88,17 @@ public:
    */
   void AddSubnets (Ipv4Address poolAddr, Ipv4Mask poolMask, Ipv4Address minAddr, Ipv4Address maxAddr);
 
+  /**
+   * \brief Check whether an address range overlaps the range of a pool
+   *
+   * AddSubnets aborts on such a range.
+   *
+   * \param minAddr The lower bound of the range
+   * \param maxAddr The upper bound of the range
+   * \return true if an address of the range is in a pool
+   */
+  bool OverlapsPool (Ipv4Address minAddr, Ipv4Address maxAddr) const;
+
 
 protected:
   virtual void DoDispose (void);
@@ -82,31 +108,171 @@ private:
 
   /**
    * \brief Handles incoming packets from the network
-   * \param socket Socket bound to port 67 of the DHCP server
+   * \param socket Socket bound to port 67 of the DHCP server (any address or an interface address)
    */
   void NetHandler (Ptr<Socket> socket);
 
+  /// Priority classes of the received messages, the first one is served first
+  enum MessageClass
+  {
+    CLASS_BOUND = 0,      //!< Messages of bound clients: RENEW / REBIND REQUEST, RELEASE, DECLINE
+    CLASS_SELECTING = 1,  //!< REQUEST of a client completing its configuration
+    CLASS_NEW = 2,        //!< DISCOVER and INFORM
+    N_CLASSES = 3         //!< Number of classes
+  };
+
+  /// A received message waiting to be processed
+  struct PendingMessage
+  {
+    Ptr<Packet> packet;             //!< The message
+    uint32_t ifIndex;               //!< The Ipv4 interface the message came from
+    InetSocketAddress from;         //!< The sender of the message
+  };
+
+  /// Token bucket limiting the new messages of a relay agent
+  struct TokenBucket
+  {
+    double tokens;                  //!< Messages that can be accepted now
+    Time last;                      //!< Time of the last update of the tokens
+  };
+
+  /// Token buckets, by giaddr (0.0.0.0 for the directly attached clients)
+  typedef std::map<Ipv4Address, TokenBucket> TokenBuckets;
+
+  /// An interface served by the DHCP server
+  struct ServedInterface
+  {
+    Ptr<NetDevice> device;            //!< The NetDevice of the interface
+    Ptr<Socket> socket;               //!< Socket bound to the interface address, used for the replies
+    std::vector<uint32_t> pools;      //!< Pools (position in m_pools) of the interface subnets
+  };
+
+  /// Served interfaces container - Ipv4 interface index + interface
+  typedef std::map<uint32_t, ServedInterface> ServedInterfaces;
+  /// Served interfaces iterator - Ipv4 interface index + interface
+  typedef std::map<uint32_t, ServedInterface>::iterator ServedInterfacesIter;
+
+  /**
+   * \brief Get the priority class of a message
+   * \param header DHCP header of the received message
+   * \return The class of the message
+   */
+  static MessageClass Classify (const DhcpHeaderView &header);
+
+  /**
+   * \brief Take a token from the bucket of the relay agent of a new message
+   * \param header DHCP header of the received message
+   * \return false if the relay agent sent too many new messages
+   */
+  bool TakeToken (const DhcpHeaderView &header);
+
+  /**
+   * \brief Queue a message until the server is free to process it
+   *
+   * When the queue is full, the last message of a lower class is dropped
+   * to make room, otherwise the new message is dropped.
+   *
+   * \param message The message
+   * \param messageClass The class of the message
+   */
+  void Enqueue (const PendingMessage &message, MessageClass messageClass);
+
+  /**
+   * \brief Process the first message of the highest class, at the end of its processing time
+   */
+  void ProcessPending (void);
+
+  /**
+   * \brief Process a received message
+   * \param iface incoming interface
+   * \param header DHCP header of the received message
+   * \param from Address of the DHCP client
+   */
+  void HandleMessage (const ServedInterface &iface, const DhcpHeaderView &header, InetSocketAddress from);
+
   /**
    * \brief Sends DHCP offer after receiving DHCP Discover
-   * \param iDev incoming NetDevice
+   *
+   * When both the client and the server use Rapid Commit, the lease is
+   * acknowledged straight away (DHCP ACK with the Rapid Commit option).
+   *
+   * \param iface incoming interface
    * \param header DHCP header of the received message
    * \param from Address of the DHCP client
    */
-  void SendOffer (Ptr<NetDevice> iDev, DhcpHeader header, InetSocketAddress from);
+  void SendOffer (const ServedInterface &iface, const DhcpHeaderView &header, InetSocketAddress from);
 
   /**
    * \brief Sends DHCP ACK (or NACK) after receiving Request
-   * \param iDev incoming NetDevice
+   *
+   * A REQUEST for an address on another network than the client, or for
+   * another address than the lease of the client, is refused; a REQUEST
+   * from a client without lease is left unanswered (RFC 2131, section 4.3.2).
+   * \param iface incoming interface
+   * \param header DHCP header of the received message
+   * \param from Address of the DHCP client
+   */
+  void SendAck (const ServedInterface &iface, const DhcpHeaderView &header, InetSocketAddress from);
+
+  /**
+   * \brief Gives the address of a DHCP RELEASE back to its pool
+   * \param header DHCP header of the received message
+   */
+  void ReleaseAddress (const DhcpHeaderView &header);
+
+  /**
+   * \brief Drops the lease of a DHCP DECLINE and quarantines its address
+   * \param header DHCP header of the received message
+   */
+  void DeclineAddress (const DhcpHeaderView &header);
+
+  /**
+   * \brief Gives the declined addresses back to their pool at the end of the quarantine
+   */
+  void EndQuarantine (void);
+
+  /**
+   * \brief Sends DHCP ACK with the configuration parameters after receiving DHCP Inform
+   * \param iface incoming interface
    * \param header DHCP header of the received message
    * \param from Address of the DHCP client
    */
-  void SendAck (Ptr<NetDevice> iDev, DhcpHeader header, InetSocketAddress from);
+  void SendInformAck (const ServedInterface &iface, const DhcpHeaderView &header, InetSocketAddress from);
 
   /**
-   * \brief Modifies the remaining lease time of addresses
+   * \brief Serialize the common part of the OFFER, ACK and NACK replies
+   */
+  void BuildResponseTemplates (void);
+
+  /**
+   * \brief Expires the leases whose expiry time has been reached
    */
   void TimerHandler (void);
 
+  /**
+   * \brief Queue the expiry of a lease and schedule TimerHandler if needed
+   * \param lease The index of the lease in m_leases
+   * \param expiry The absolute expiry time of the lease
+   */
+  void ScheduleExpiry (uint32_t lease, Time expiry);
+
+  /**
+   * \brief Write the dynamic leases to the lease file
+   *
+   * The file has a 16-byte header (magic, version, number of records)
+   * followed by one 32-byte record per lease: chaddr, address, state and
+   * the time left on the lease, all fields in network byte order.
+   */
+  void SaveLeases (void);
+
+  /**
+   * \brief Restore the leases saved in the lease file, if it exists
+   *
+   * Each record is checked against the pools of the server; records
+   * for an address outside the pools or already in use are skipped.
+   */
+  void LoadLeases (void);
+
   /**
    * \brief Starts the DHCP Server application
    */
@@ -124,45 +290,98 @@ private:
    */
   bool CheckIfValid (Ipv4Address reqAddr);
 
-  Ptr<Socket> m_socket;                  //!< The socket bound to port 67
+  /**
+   * \brief Get the pools of the network of a client
+   * \param iface incoming interface
+   * \param giAddr giaddr of the client message
+   * \param relayPool Receives the pool of the relay agent subnet, if any
+   * \param nPools Receives the number of pools
+   * \return the pools (position in m_pools): the pool of the relay agent
+   * subnet, or without relay agent the pools of the incoming interface
+   */
+  const uint32_t * GetClientPools (const ServedInterface &iface, Ipv4Address giAddr,
+                                   uint32_t &relayPool, uint32_t &nPools);
+
+  /**
+   * \brief Find the pool serving the subnet of a relay agent
+   *
+   * The pool whose subnet contains the address is selected, preferring
+   * the longest prefix when pool subnets are nested.
+   *
+   * \param giAddr Ipv4Address of the relay agent (giaddr)
+   * \return the pool, or 0 if no pool subnet contains the address
+   */
+  DhcpAddressPool * FindPoolForSubnet (Ipv4Address giAddr);
+
+  /**
+   * \brief Find the pool whose [minAddr, maxAddr] range holds an address
+   * \param addr The address
+   * \return the pool, or 0 if the address is in no pool range
+   */
+  DhcpAddressPool * FindPoolForAddress (Ipv4Address addr);
+
+  Ptr<Socket> m_socket;                  //!< The socket bound to port 67, receiving the broadcasts of all the interfaces
+  ServedInterfaces m_interfaces;         //!< The interfaces served, by Ipv4 interface index
   Ipv4Address m_gateway;                 //!< The gateway address
 
-  /// Pool address conatainer - pool address / pool mask + min address / max address
-  typedef std::list < std::pair < std::pair <Ipv4Address,Ipv4Mask> , std::pair <Ipv4Address,Ipv4Address> > > PoolAddress; 
-  /// Pool address iterator - pool address / pool mask + min address / max address
-  typedef std::list < std::pair < std::pair <Ipv4Address,Ipv4Mask> , std::pair <Ipv4Address,Ipv4Address> > >::iterator PoolAddressIter; 
-  /// Pool address const iterator - pool address / pool mask + min address / max address
-  typedef std::list < std::pair < std::pair <Ipv4Address,Ipv4Mask> , std::pair <Ipv4Address,Ipv4Address> > >::const_iterator PoolAddressCIter; 
+  /// Address pool container - subnet, range and allocation bitmap of each pool
+  typedef std::vector<DhcpAddressPool> AddressPools;
+  /// Address pool iterator - subnet, range and allocation bitmap of each pool
+  typedef std::vector<DhcpAddressPool>::iterator AddressPoolsIter;
+
+  /// Pool range index - lower bound of the pool range + position in m_pools (ranges do not overlap)
+  typedef std::map<uint32_t, uint32_t> PoolRangeIndex;
+  /// Pool range index const iterator - lower bound of the pool range + position in m_pools
+  typedef std::map<uint32_t, uint32_t>::const_iterator PoolRangeIndexCIter;
+
+  /// Pool subnet index - pool mask / network address + position in m_pools
+  typedef std::map<std::pair<uint32_t, uint32_t>, uint32_t> PoolSubnetIndex;
+  /// Pool subnet index const iterator - pool mask / network address + position in m_pools
+  typedef std::map<std::pair<uint32_t, uint32_t>, uint32_t>::const_iterator PoolSubnetIndexCIter;
   
-  /// Leased address container - chaddr + IP addr / lease time
-  typedef std::map<Address, std::pair<Ipv4Address, uint32_t> > LeasedAddress;
-  /// Leased address iterator - chaddr + IP addr / lease time
-  typedef std::map<Address, std::pair<Ipv4Address, uint32_t> >::iterator LeasedAddressIter;
-  /// Leased address const iterator - chaddr + IP addr / lease time
-  typedef std::map<Address, std::pair<Ipv4Address, uint32_t> >::const_iterator LeasedAddressCIter;
-
-  /// Expired address container - chaddr
-  typedef std::list<Address> ExpiredAddress;
-  /// Expired address iterator - chaddr
-  typedef std::list<Address>::iterator ExpiredAddressIter;
-  /// Expired address const iterator - chaddr
-  typedef std::list<Address>::const_iterator ExpiredAddressCIter;
-
-  /// Available address container - IP address / subnet mask
-  typedef std::list< std::pair<Ipv4Address, Ipv4Mask> > AvailableAddress;
-  /// Available address iterator - IP address / subnet mask
-  typedef std::list< std::pair<Ipv4Address, Ipv4Mask> >::iterator  AvailableAddressIter;
-  /// Available address const iterator - IP address / subnet mask
-  typedef std::list< std::pair<Ipv4Address, Ipv4Mask> >::const_iterator AvailableAddressCIter;
-
-  PoolAddress m_poolAddresses;           //!< Pool address and their range and subnet mask
-  LeasedAddress m_leasedAddresses;       //!< Leased address and their status (cache memory)
-  ExpiredAddress m_expiredAddresses;     //!< Expired addresses to be reused (chaddr of the clients)
-  AvailableAddress m_availableAddresses; //!< Available addresses to be used (IP addresses)
+  /// Lease expiry heap - expiry time / lease index, earliest expiry first
+  typedef std::vector<std::pair<Time, uint32_t> > LeaseExpiryHeap;
+
+  /// Quarantine queue - end of the quarantine / declined address, earliest end first
+  typedef std::deque<std::pair<Time, Ipv4Address> > QuarantineQueue;
+
+  /// Expired address queues - one per address pool, oldest expired lease first
+  typedef std::vector<DhcpLeaseTable::ExpiredQueue> ExpiredAddress;
+
+  /// Response templates - one per address pool
+  typedef std::vector<DhcpResponseTemplate> ResponseTemplates;
+
+  AddressPools m_pools;                  //!< Address pools and their free addresses
+  PoolSubnetIndex m_poolSubnets;         //!< Pools indexed by subnet, for relayed requests
+  std::set<uint32_t> m_poolMasks;        //!< Masks used by the pools, to look up the longest prefix first
+  PoolRangeIndex m_poolRanges;           //!< Pools sorted by address range
+  DhcpLeaseTable m_leases;               //!< Leased address and their status (cache memory)
+  ExpiredAddress m_expiredAddresses;     //!< Expired addresses to be reused, per pool (lease of the clients)
   Time m_lease;                          //!< The granted lease time for an address
   Time m_renew;                          //!< The renewal time for an address
   Time m_rebind;                         //!< The rebinding time for an address
-  EventId m_expiredEvent;                //!< The Event to trigger TimerHandler
+  Time m_declineTime;                    //!< The quarantine time of a declined address
+  bool m_rapidCommit;                    //!< Answer Rapid Commit DISCOVERs with an ACK
+  std::string m_leaseFile;               //!< File the leases are saved to on stop and restored from on start
+  AllocationPolicy m_allocationPolicy;   //!< Choice of the address offered to a new client
+  ResponseTemplates m_offerTemplates;    //!< OFFER of each pool
+  ResponseTemplates m_rapidAckTemplates; //!< Rapid Commit ACK of each pool
+  DhcpResponseTemplate m_ackTemplate;    //!< ACK to a REQUEST
+  DhcpResponseTemplate m_nackTemplate;   //!< NACK to a REQUEST
+  LeaseExpiryHeap m_expiryHeap;          //!< Pending lease expiries (min-heap)
+  EventId m_expiredEvent;                //!< The Event to trigger TimerHandler at the earliest expiry
+  QuarantineQueue m_quarantine;          //!< Declined addresses in quarantine
+  EventId m_quarantineEvent;             //!< The Event to trigger EndQuarantine at the earliest end
+  Time m_processingTime;                 //!< Time taken to process a message, 0 to process it on reception
+  uint32_t m_queueLimit;                 //!< Maximum number of messages waiting to be processed
+  std::deque<PendingMessage> m_pending[N_CLASSES]; //!< Messages waiting to be processed, per class
+  uint32_t m_nPending;                   //!< Number of messages waiting to be processed
+  EventId m_processEvent;                //!< The Event to trigger ProcessPending
+  double m_giaddrRate;                   //!< New messages accepted per second from a relay agent, 0 for no limit
+  uint32_t m_giaddrBurst;                //!< New messages accepted at once from a relay agent
+  TokenBuckets m_tokenBuckets;           //!< Token bucket of each relay agent
+  TracedValue<uint32_t> m_queueDrops;    //!< Messages dropped because the queue is full
+  TracedValue<uint32_t> m_rateDrops;     //!< Messages dropped by the token bucket of their relay agent
 };
 
 } // namespace ns3
@@ -0,0 +1,240 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/simulator.h"
+#include "dhcp-transaction-table.h"
+#include <algorithm>
+#include <cstring>
+#include <set>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("DhcpTransactionTable");
+
+bool
+DhcpTransactionTable::Key::operator< (const Key &other) const
+{
+  if (tran != other.tran)
+    {
+      return tran < other.tran;
+    }
+  return std::memcmp (chaddr, other.chaddr, 16) < 0;
+}
+
+DhcpTransactionTable::DhcpTransactionTable ()
+  : m_maxSize (1024),
+    m_timeout (Seconds (10))
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DhcpTransactionTable::SetMaxSize (uint32_t maxSize)
+{
+  NS_LOG_FUNCTION (this << maxSize);
+  NS_ASSERT_MSG (maxSize > 0, "A transaction table holds at least one transaction");
+  m_maxSize = maxSize;
+}
+
+void
+DhcpTransactionTable::SetTimeout (Time timeout)
+{
+  NS_LOG_FUNCTION (this << timeout);
+  m_timeout = timeout;
+}
+
+void
+DhcpTransactionTable::SetNServers (uint32_t nServers)
+{
+  NS_LOG_FUNCTION (this << nServers);
+  m_nWaiting.resize (nServers, 0);
+}
+
+DhcpTransactionTable::Key
+DhcpTransactionTable::MakeKey (uint32_t tran, const uint8_t *chaddr)
+{
+  Key key;
+  key.tran = tran;
+  std::memcpy (key.chaddr, chaddr, 16);
+  return key;
+}
+
+bool
+DhcpTransactionTable::IsWaiting (uint32_t tran, const uint8_t *chaddr, uint8_t type, Ipv4Address requested)
+{
+  NS_LOG_FUNCTION (this << tran << (uint32_t) type << requested);
+
+  Expire ();
+  TransactionsIter i = m_transactions.find (MakeKey (tran, chaddr));
+  return i != m_transactions.end () && !i->second.replied
+         && i->second.type == type && i->second.requested == requested;
+}
+
+void
+DhcpTransactionTable::Insert (uint32_t tran, const uint8_t *chaddr, uint8_t type, Ipv4Address requested)
+{
+  NS_LOG_FUNCTION (this << tran << (uint32_t) type << requested);
+
+  Expire ();
+  Key key = MakeKey (tran, chaddr);
+  if (m_transactions.find (key) == m_transactions.end ())
+    {
+      // The queue front is the oldest transaction, unless it has been
+      // updated or removed since
+      while (m_transactions.size () >= m_maxSize)
+        {
+          NS_ASSERT_MSG (!m_expiryQueue.empty (), "Transaction table inconsistent with its expiry queue");
+          TransactionsIter oldest = m_transactions.find (m_expiryQueue.front ().second);
+          if (oldest != m_transactions.end () && oldest->second.expiry == m_expiryQueue.front ().first)
+            {
+              NS_LOG_LOGIC ("Transaction table full, dropping transaction " << oldest->first.tran);
+              Erase (oldest);
+            }
+          m_expiryQueue.pop_front ();
+        }
+    }
+
+  Transaction &transaction = m_transactions[key];
+  transaction.type = type;
+  transaction.requested = requested;
+  transaction.expiry = Simulator::Now () + m_timeout;
+  transaction.replied = false;
+  m_expiryQueue.push_back (std::make_pair (transaction.expiry, key));
+  if (m_expiryQueue.size () > 2 * m_maxSize)
+    {
+      Compact ();
+    }
+}
+
+void
+DhcpTransactionTable::AddServer (uint32_t tran, const uint8_t *chaddr, uint32_t server)
+{
+  NS_LOG_FUNCTION (this << tran << server);
+  NS_ASSERT_MSG (server < m_nWaiting.size (), "No server " << server << " in the transaction table");
+
+  TransactionsIter i = m_transactions.find (MakeKey (tran, chaddr));
+  NS_ASSERT_MSG (i != m_transactions.end (), "Server added to transaction " << tran << " before the transaction");
+  std::vector<uint32_t> &servers = i->second.servers;
+  if (std::find (servers.begin (), servers.end (), server) == servers.end ())
+    {
+      servers.push_back (server);
+      m_nWaiting[server]++;
+    }
+}
+
+void
+DhcpTransactionTable::Remove (uint32_t tran, const uint8_t *chaddr, uint32_t server)
+{
+  NS_LOG_FUNCTION (this << tran << server);
+
+  TransactionsIter i = m_transactions.find (MakeKey (tran, chaddr));
+  if (i == m_transactions.end ())
+    {
+      return;
+    }
+  i->second.replied = true;
+  std::vector<uint32_t> &servers = i->second.servers;
+  std::vector<uint32_t>::iterator j = std::find (servers.begin (), servers.end (), server);
+  if (j != servers.end ())
+    {
+      servers.erase (j);
+      m_nWaiting[server]--;
+    }
+  // Its expiry queue entry is dropped when it comes out
+  if (servers.empty ())
+    {
+      m_transactions.erase (i);
+    }
+}
+
+uint32_t
+DhcpTransactionTable::GetNWaiting (uint32_t server)
+{
+  NS_ASSERT_MSG (server < m_nWaiting.size (), "No server " << server << " in the transaction table");
+  Expire ();
+  return m_nWaiting[server];
+}
+
+uint32_t
+DhcpTransactionTable::GetSize (void)
+{
+  Expire ();
+  return m_transactions.size ();
+}
+
+void
+DhcpTransactionTable::Clear (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_transactions.clear ();
+  m_expiryQueue.clear ();
+  std::fill (m_nWaiting.begin (), m_nWaiting.end (), 0);
+}
+
+void
+DhcpTransactionTable::Erase (TransactionsIter transaction)
+{
+  std::vector<uint32_t> &servers = transaction->second.servers;
+  for (std::vector<uint32_t>::const_iterator i = servers.begin (); i != servers.end (); i++)
+    {
+      m_nWaiting[*i]--;
+    }
+  m_transactions.erase (transaction);
+}
+
+void
+DhcpTransactionTable::Compact (void)
+{
+  NS_LOG_FUNCTION (this << m_expiryQueue.size ());
+
+  // Keep the last entry of each transaction, if it is still current
+  std::set<Key> kept;
+  ExpiryQueue queue;
+  for (ExpiryQueue::reverse_iterator i = m_expiryQueue.rbegin (); i != m_expiryQueue.rend (); i++)
+    {
+      TransactionsIter transaction = m_transactions.find (i->second);
+      if (transaction != m_transactions.end () && transaction->second.expiry == i->first
+          && kept.insert (i->second).second)
+        {
+          queue.push_front (*i);
+        }
+    }
+  m_expiryQueue.swap (queue);
+}
+
+void
+DhcpTransactionTable::Expire (void)
+{
+  Time now = Simulator::Now ();
+  while (!m_expiryQueue.empty () && m_expiryQueue.front ().first <= now)
+    {
+      TransactionsIter i = m_transactions.find (m_expiryQueue.front ().second);
+      if (i != m_transactions.end () && i->second.expiry == m_expiryQueue.front ().first)
+        {
+          NS_LOG_LOGIC ("No reply for transaction " << i->first.tran);
+          Erase (i);
+        }
+      m_expiryQueue.pop_front ();
+    }
+}
+
+} // namespace ns3
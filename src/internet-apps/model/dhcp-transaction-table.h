@@ -0,0 +1,198 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef DHCP_TRANSACTION_TABLE_H
+#define DHCP_TRANSACTION_TABLE_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include <stdint.h>
+#include <map>
+#include <deque>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup dhcp
+ *
+ * \class DhcpTransactionTable
+ * \brief Client messages forwarded by a relay agent and still waiting for
+ * a reply, indexed by transaction id and client chaddr
+ *
+ * All the transactions wait for the same time, so they expire in the
+ * order they were recorded: a FIFO queue gives the next one to expire,
+ * and the expired transactions are removed when the table is accessed.
+ * When the table is full, the oldest transaction is removed. The entries
+ * left in the queue by updated or removed transactions are dropped once
+ * the queue grows past twice the maximum number of transactions.
+ *
+ * A transaction also lists the servers whose reply is expected, and the
+ * table counts the transactions waiting for each server. The first reply
+ * answers the client message; the transaction stays until the other
+ * servers reply, or until it expires.
+ */
+class DhcpTransactionTable
+{
+public:
+  DhcpTransactionTable ();
+
+  /**
+   * \brief Set the maximum number of transactions
+   * \param maxSize The maximum number of transactions
+   */
+  void SetMaxSize (uint32_t maxSize);
+
+  /**
+   * \brief Set the time a transaction waits for its reply
+   * \param timeout The time a transaction waits for its reply
+   */
+  void SetTimeout (Time timeout);
+
+  /**
+   * \brief Set the number of servers the messages are forwarded to
+   * \param nServers The number of servers
+   */
+  void SetNServers (uint32_t nServers);
+
+  /**
+   * \brief Check whether a client message repeats a message waiting for its reply
+   * \param tran The transaction id of the message
+   * \param chaddr The 16-byte chaddr of the client
+   * \param type The DHCP message type
+   * \param requested The address requested by the client, 0.0.0.0 if none
+   * \return true if the same message is waiting for its reply
+   */
+  bool IsWaiting (uint32_t tran, const uint8_t *chaddr, uint8_t type, Ipv4Address requested);
+
+  /**
+   * \brief Record a client message forwarded to the server(s)
+   *
+   * A transaction already in the table is updated with the message, and
+   * waits again for the whole timeout, for its reply and for the servers
+   * it was forwarded to.
+   *
+   * \param tran The transaction id of the message
+   * \param chaddr The 16-byte chaddr of the client
+   * \param type The DHCP message type
+   * \param requested The address requested by the client, 0.0.0.0 if none
+   */
+  void Insert (uint32_t tran, const uint8_t *chaddr, uint8_t type, Ipv4Address requested);
+
+  /**
+   * \brief Record that a server is expected to reply to a transaction
+   * \param tran The transaction id of the message
+   * \param chaddr The 16-byte chaddr of the client
+   * \param server The index of the server
+   */
+  void AddServer (uint32_t tran, const uint8_t *chaddr, uint32_t server);
+
+  /**
+   * \brief Record the reply of a server to a transaction
+   * \param tran The transaction id of the reply
+   * \param chaddr The 16-byte chaddr of the client
+   * \param server The index of the server, or the number of servers if it is unknown
+   */
+  void Remove (uint32_t tran, const uint8_t *chaddr, uint32_t server);
+
+  /**
+   * \brief Get the number of transactions waiting for the reply of a server
+   * \param server The index of the server
+   * \return The number of transactions
+   */
+  uint32_t GetNWaiting (uint32_t server);
+
+  /**
+   * \brief Get the number of transactions waiting for their reply
+   * \return The number of transactions
+   */
+  uint32_t GetSize (void);
+
+  /**
+   * \brief Remove all the transactions
+   */
+  void Clear (void);
+
+private:
+  /// Transaction id and client chaddr
+  struct Key
+  {
+    uint32_t tran;         //!< Transaction id
+    uint8_t chaddr[16];    //!< Client chaddr
+
+    /**
+     * \brief Order the keys
+     * \param other The other key
+     * \return true if this key comes first
+     */
+    bool operator< (const Key &other) const;
+  };
+
+  /// Last message forwarded in a transaction
+  struct Transaction
+  {
+    uint8_t type;          //!< DHCP message type
+    Ipv4Address requested; //!< Address requested by the client
+    Time expiry;           //!< Time after which the reply is no longer waited for
+    bool replied;          //!< Whether a server replied to the message
+    std::vector<uint32_t> servers; //!< Servers whose reply is expected
+  };
+
+  /// Transactions, by key
+  typedef std::map<Key, Transaction> Transactions;
+  /// Transactions iterator
+  typedef std::map<Key, Transaction>::iterator TransactionsIter;
+  /// Expiry time and key of the recorded messages
+  typedef std::deque<std::pair<Time, Key> > ExpiryQueue;
+
+  /**
+   * \brief Build the key of a message
+   * \param tran The transaction id of the message
+   * \param chaddr The 16-byte chaddr of the client
+   * \return The key
+   */
+  static Key MakeKey (uint32_t tran, const uint8_t *chaddr);
+
+  /**
+   * \brief Remove a transaction, and its servers from the counts
+   * \param transaction The transaction
+   */
+  void Erase (TransactionsIter transaction);
+
+  /**
+   * \brief Remove the expiry queue entries of the transactions which have
+   * been updated or removed since
+   */
+  void Compact (void);
+
+  /**
+   * \brief Remove the transactions whose reply did not come in time
+   */
+  void Expire (void);
+
+  Transactions m_transactions;                     //!< Transactions waiting for their reply
+  ExpiryQueue m_expiryQueue;                       //!< Expiry time of the recorded messages, oldest first
+  std::vector<uint32_t> m_nWaiting;                //!< Number of transactions waiting for each server
+  uint32_t m_maxSize;                              //!< Maximum number of transactions
+  Time m_timeout;                                  //!< Time a transaction waits for its reply
+};
+
+} // namespace ns3
+
+#endif /* DHCP_TRANSACTION_TABLE_H */
@@ -21,14 +21,45 @@
  */
 
 #include "ns3/data-rate.h"
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
 #include "ns3/simple-net-device.h"
+#include "ns3/mac48-address.h"
 #include "ns3/simple-net-device-helper.h"
+#include "ns3/simple-channel.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/error-model.h"
 #include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/ipv4-interface.h"
+#include "ns3/loopback-net-device.h"
+#include "ns3/arp-cache.h"
+#include "ns3/udp-l4-protocol.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/inet-socket-address.h"
 #include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/udp-header.h"
 #include "ns3/dhcp-client.h"
 #include "ns3/dhcp-server.h"
+#include "ns3/dhcp-relay.h"
+#include "ns3/dhcp-load-generator.h"
 #include "ns3/dhcp-helper.h"
+#include "ns3/dhcp-header.h"
+#include "ns3/dhcp-header-view.h"
+#include "ns3/dhcp-response-template.h"
+#include "ns3/dhcp-address-pool.h"
+#include "ns3/dhcp-lease-table.h"
+#include "ns3/dhcp-transaction-table.h"
 #include "ns3/test.h"
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <vector>
 
 using namespace ns3;
 
@@ -104,6 +135,8 @@ DhcpTestCase::DoRun (void)
 
   ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.12"),
                                                                      Ipv4Mask ("/24"),Ipv4Address ("172.30.0.17"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
   dhcpServerApp.Start (Seconds (0.0));
   dhcpServerApp.Stop (Seconds (20.0));
 
@@ -139,6 +172,3350 @@ DhcpTestCase::DoRun (void)
   Simulator::Destroy ();
 }
 
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief Base of the DHCP tests which record the address leased to each client
+ *
+ * The NewLease trace of the i-th client is connected to LeaseObtained
+ * with the context "i".
+ */
+class DhcpLeaseRecorderTestCase : public TestCase
+{
+public:
+  /**
+   * Constructor
+   * \param name The name of the test case.
+   * \param nClients The number of clients.
+   */
+  DhcpLeaseRecorderTestCase (std::string name, uint32_t nClients);
+  virtual ~DhcpLeaseRecorderTestCase ();
+  /**
+   * Triggered by an address lease on a client.
+   * \param context The client index.
+   * \param newAddress The leased address.
+   */
+  void LeaseObtained (std::string context, const Ipv4Address& newAddress);
+protected:
+  std::vector<Ipv4Address> m_leasedAddress; //!< Address given to the clients
+};
+
+DhcpLeaseRecorderTestCase::DhcpLeaseRecorderTestCase (std::string name, uint32_t nClients)
+  : TestCase (name),
+    m_leasedAddress (nClients)
+{
+}
+
+DhcpLeaseRecorderTestCase::~DhcpLeaseRecorderTestCase ()
+{
+}
+
+void
+DhcpLeaseRecorderTestCase::LeaseObtained (std::string context, const Ipv4Address& newAddress)
+{
+  uint32_t numericalContext = std::stoi (context, nullptr, 10);
+
+  if (numericalContext < m_leasedAddress.size ())
+    {
+      m_leasedAddress[numericalContext] = newAddress;
+    }
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP server serving two interfaces
+ */
+class DhcpMultiInterfaceTestCase : public DhcpLeaseRecorderTestCase
+{
+public:
+  DhcpMultiInterfaceTestCase ();
+  virtual ~DhcpMultiInterfaceTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DhcpMultiInterfaceTestCase::DhcpMultiInterfaceTestCase ()
+  : DhcpLeaseRecorderTestCase ("Dhcp multi-interface test case ", 2)
+{
+}
+
+DhcpMultiInterfaceTestCase::~DhcpMultiInterfaceTestCase ()
+{
+}
+
+void
+DhcpMultiInterfaceTestCase::DoRun (void)
+{
+  /*Set up devices: one server attached to two subnets, one client on each*/
+  Ptr<Node> server = CreateObject<Node> ();
+  NodeContainer clients;
+  clients.Create (2);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devNetA = simpleNetDevice.Install (NodeContainer (server, clients.Get (0)));
+  NetDeviceContainer devNetB = simpleNetDevice.Install (NodeContainer (server, clients.Get (1)));
+
+  InternetStackHelper tcpip;
+  tcpip.Install (server);
+  tcpip.Install (clients);
+
+  DhcpHelper dhcpHelper;
+
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNetA.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.InstallFixedAddress (devNetB.Get (0), Ipv4Address ("172.30.1.1"), Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.1.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.1.10"),
+                             Ipv4Address ("172.30.1.15"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (20.0));
+
+  NetDeviceContainer dhcpClientNetDevs;
+  dhcpClientNetDevs.Add (devNetA.Get (1));
+  dhcpClientNetDevs.Add (devNetB.Get (1));
+
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (dhcpClientNetDevs);
+  dhcpClientApps.Start (Seconds (1.0));
+  dhcpClientApps.Stop (Seconds (20.0));
+
+  dhcpClientApps.Get(0)->TraceConnect ("NewLease", "0", MakeCallback(&DhcpMultiInterfaceTestCase::LeaseObtained, this));
+  dhcpClientApps.Get(1)->TraceConnect ("NewLease", "1", MakeCallback(&DhcpMultiInterfaceTestCase::LeaseObtained, this));
+
+  Simulator::Stop (Seconds (21.0));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[0], Ipv4Address ("172.30.0.10"),
+                         m_leasedAddress[0] << " instead of " << "172.30.0.10");
+
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[1], Ipv4Address ("172.30.1.10"),
+                         m_leasedAddress[1] << " instead of " << "172.30.1.10");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP RELEASE gives the address back to the pool before the lease expires
+ */
+class DhcpReleaseTestCase : public DhcpLeaseRecorderTestCase
+{
+public:
+  DhcpReleaseTestCase ();
+  virtual ~DhcpReleaseTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DhcpReleaseTestCase::DhcpReleaseTestCase ()
+  : DhcpLeaseRecorderTestCase ("Dhcp release test case ", 2)
+{
+}
+
+DhcpReleaseTestCase::~DhcpReleaseTestCase ()
+{
+}
+
+void
+DhcpReleaseTestCase::DoRun (void)
+{
+  /*Set up devices*/
+  NodeContainer nodes;
+  NodeContainer routers;
+  nodes.Create (2);
+  routers.Create (1);
+
+  NodeContainer net (routers, nodes);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devNet = simpleNetDevice.Install (net);
+
+  InternetStackHelper tcpip;
+  tcpip.Install (routers);
+  tcpip.Install (nodes);
+
+  // A single address, leased for longer than the test
+  DhcpHelper dhcpHelper;
+  dhcpHelper.SetServerAttribute ("LeaseTime", TimeValue (Seconds (60)));
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.10"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (20.0));
+
+  NetDeviceContainer dhcpClientNetDevs;
+  dhcpClientNetDevs.Add (devNet.Get (1));
+  dhcpClientNetDevs.Add (devNet.Get (2));
+
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (dhcpClientNetDevs);
+  dhcpClientApps.Get (0)->SetStartTime (Seconds (1.0));
+  dhcpClientApps.Get (0)->SetStopTime (Seconds (8.0));
+  dhcpClientApps.Get (1)->SetStartTime (Seconds (9.0));
+  dhcpClientApps.Get (1)->SetStopTime (Seconds (20.0));
+
+  dhcpClientApps.Get(0)->TraceConnect ("NewLease", "0", MakeCallback(&DhcpReleaseTestCase::LeaseObtained, this));
+  dhcpClientApps.Get(1)->TraceConnect ("NewLease", "1", MakeCallback(&DhcpReleaseTestCase::LeaseObtained, this));
+
+  Simulator::Stop (Seconds (21.0));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[0], Ipv4Address ("172.30.0.10"),
+                         m_leasedAddress[0] << " instead of " << "172.30.0.10");
+
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[1], Ipv4Address ("172.30.0.10"),
+                         m_leasedAddress[1] << " instead of " << "172.30.0.10");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP pool ranges: an address is found in the pool holding it among
+ * several pools, and a range overlapping a pool is detected
+ */
+class DhcpPoolRangesTestCase : public DhcpLeaseRecorderTestCase
+{
+public:
+  DhcpPoolRangesTestCase ();
+  virtual ~DhcpPoolRangesTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DhcpPoolRangesTestCase::DhcpPoolRangesTestCase ()
+  : DhcpLeaseRecorderTestCase ("Dhcp pool ranges test case ", 2)
+{
+}
+
+DhcpPoolRangesTestCase::~DhcpPoolRangesTestCase ()
+{
+}
+
+void
+DhcpPoolRangesTestCase::DoRun (void)
+{
+  /*Set up devices*/
+  NodeContainer nodes;
+  NodeContainer routers;
+  nodes.Create (2);
+  routers.Create (1);
+
+  NodeContainer net (routers, nodes);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devNet = simpleNetDevice.Install (net);
+
+  InternetStackHelper tcpip;
+  tcpip.Install (routers);
+  tcpip.Install (nodes);
+
+  // The pool of the clients lies between two other pools
+  DhcpHelper dhcpHelper;
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("192.168.0.0"), Ipv4Mask ("/24"), Ipv4Address ("192.168.0.10"),
+                             Ipv4Address ("192.168.0.20"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("10.1.0.0"), Ipv4Mask ("/24"), Ipv4Address ("10.1.0.10"),
+                             Ipv4Address ("10.1.0.20"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.11"));
+  Ptr<DhcpServer> dhcpServer = DynamicCast<DhcpServer> (dhcpServerApp.Get (0));
+
+  // The static address is reserved in the pool holding it
+  dhcpServer->AddStaticDhcpEntry (devNet.Get (2)->GetAddress (), Ipv4Address ("172.30.0.10"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (20.0));
+
+  // A range overlapping the next pool, the previous one, or inside a pool
+  NS_TEST_ASSERT_MSG_EQ (dhcpServer->OverlapsPool (Ipv4Address ("10.0.0.1"), Ipv4Address ("10.1.0.10")), true,
+                         "Range overlapping the next pool accepted");
+  NS_TEST_ASSERT_MSG_EQ (dhcpServer->OverlapsPool (Ipv4Address ("10.1.0.20"), Ipv4Address ("10.2.0.1")), true,
+                         "Range overlapping the previous pool accepted");
+  NS_TEST_ASSERT_MSG_EQ (dhcpServer->OverlapsPool (Ipv4Address ("10.1.0.12"), Ipv4Address ("10.1.0.15")), true,
+                         "Range inside another pool accepted");
+  NS_TEST_ASSERT_MSG_EQ (dhcpServer->OverlapsPool (Ipv4Address ("10.1.0.21"), Ipv4Address ("10.2.0.1")), false,
+                         "Range next to another pool refused");
+
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (NetDeviceContainer (devNet.Get (1), devNet.Get (2)));
+  dhcpClientApps.Start (Seconds (1.0));
+  dhcpClientApps.Stop (Seconds (20.0));
+  dhcpClientApps.Get (0)->TraceConnect ("NewLease", "0", MakeCallback (&DhcpPoolRangesTestCase::LeaseObtained, this));
+  dhcpClientApps.Get (1)->TraceConnect ("NewLease", "1", MakeCallback (&DhcpPoolRangesTestCase::LeaseObtained, this));
+
+  Simulator::Stop (Seconds (21.0));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[0], Ipv4Address ("172.30.0.11"),
+                         m_leasedAddress[0] << " instead of " << "172.30.0.11");
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[1], Ipv4Address ("172.30.0.10"),
+                         m_leasedAddress[1] << " instead of " << "172.30.0.10");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief Sends hand-made DHCP messages from a node, for the messages
+ * DhcpClient never sends, and records the replies of the servers
+ *
+ * The clients are told apart by the last byte of their chaddr.
+ */
+class DhcpRawClient
+{
+public:
+  /**
+   * \brief Set up the interface and the socket of the clients
+   * \param device The NetDevice the messages are sent on
+   */
+  DhcpRawClient (Ptr<NetDevice> device);
+  /**
+   * \brief Broadcast a message of a client
+   * \param client The last byte of the chaddr of the client
+   * \param type The message type
+   * \param addr The requested address (option 50), if not 0.0.0.0
+   * \param ciaddr The address of the client (ciaddr)
+   */
+  void Send (uint8_t client, uint8_t type, Ipv4Address addr, Ipv4Address ciaddr);
+  /**
+   * \brief Get the yiaddr of the last reply of a given type to a client
+   * \param client The last byte of the chaddr of the client
+   * \param type The message type
+   * \return The yiaddr, or 0.0.0.0 if no such reply came
+   */
+  Ipv4Address GetReply (uint8_t client, uint8_t type) const;
+private:
+  /// Reply of a server - client / message type / yiaddr
+  typedef std::vector<std::pair<std::pair<uint8_t, uint8_t>, Ipv4Address> > Replies;
+  /**
+   * \brief Records a reply
+   * \param socket The socket of the clients
+   */
+  void Receive (Ptr<Socket> socket);
+  Ptr<Socket> m_socket; //!< Socket of the clients
+  Replies m_replies;    //!< Replies received
+};
+
+DhcpRawClient::DhcpRawClient (Ptr<NetDevice> device)
+{
+  Ptr<Node> node = device->GetNode ();
+  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+  int32_t ifIndex = ipv4->AddInterface (device);
+  ipv4->AddAddress (ifIndex, Ipv4InterfaceAddress (Ipv4Address::GetAny (), Ipv4Mask ("/0")));
+  ipv4->SetUp (ifIndex);
+
+  m_socket = Socket::CreateSocket (node, UdpSocketFactory::GetTypeId ());
+  m_socket->SetAllowBroadcast (true);
+  m_socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), 68));
+  m_socket->SetRecvCallback (MakeCallback (&DhcpRawClient::Receive, this));
+}
+
+void
+DhcpRawClient::Send (uint8_t client, uint8_t type, Ipv4Address addr, Ipv4Address ciaddr)
+{
+  uint8_t chaddr[6] = { 0, 0, 0, 0, 0, client };
+  DhcpHeader header;
+  header.ResetOpt ();
+  header.SetType (type);
+  header.SetTran (client);
+  header.SetChaddr (chaddr, 6);
+  header.SetCiaddr (ciaddr);
+  if (addr != Ipv4Address::GetAny ())
+    {
+      header.SetReq (addr);
+    }
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (header);
+  m_socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("255.255.255.255"), 67));
+}
+
+Ipv4Address
+DhcpRawClient::GetReply (uint8_t client, uint8_t type) const
+{
+  for (Replies::const_reverse_iterator i = m_replies.rbegin (); i != m_replies.rend (); ++i)
+    {
+      if (i->first == std::make_pair (client, type))
+        {
+          return i->second;
+        }
+    }
+  return Ipv4Address::GetAny ();
+}
+
+void
+DhcpRawClient::Receive (Ptr<Socket> socket)
+{
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ()))
+    {
+      DhcpHeaderView header (packet);
+      if (header.IsValid ())
+        {
+          uint8_t client = header.GetChaddrBuffer ()[5];
+          m_replies.push_back (std::make_pair (std::make_pair (client, header.GetType ()), header.GetYiaddr ()));
+        }
+    }
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP DECLINE keeps the address out of its pool for the DeclineTime
+ * of the server, the quarantines ending in turn
+ */
+class DhcpDeclineTestCase : public TestCase
+{
+public:
+  DhcpDeclineTestCase ();
+  virtual ~DhcpDeclineTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DhcpDeclineTestCase::DhcpDeclineTestCase ()
+  : TestCase ("Dhcp decline test case ")
+{
+}
+
+DhcpDeclineTestCase::~DhcpDeclineTestCase ()
+{
+}
+
+void
+DhcpDeclineTestCase::DoRun (void)
+{
+  NodeContainer nodes;
+  nodes.Create (2);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  NetDeviceContainer devNet = simpleNetDevice.Install (nodes);
+
+  InternetStackHelper tcpip;
+  tcpip.Install (nodes);
+
+  DhcpHelper dhcpHelper;
+  dhcpHelper.SetServerAttribute ("LeaseTime", TimeValue (Seconds (60)));
+  dhcpHelper.SetServerAttribute ("DeclineTime", TimeValue (Seconds (5)));
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.11"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (20.0));
+
+  DhcpRawClient raw (devNet.Get (1));
+  Ipv4Address any = Ipv4Address::GetAny ();
+  Ipv4Address first ("172.30.0.10");
+  Ipv4Address second ("172.30.0.11");
+
+  // Client 1 declines .10 at 1.2 s, until 6.2 s
+  Simulator::Schedule (Seconds (1.0), &DhcpRawClient::Send, &raw, 1, DhcpHeader::DHCPDISCOVER, any, any);
+  Simulator::Schedule (Seconds (1.1), &DhcpRawClient::Send, &raw, 1, DhcpHeader::DHCPREQ, first, any);
+  Simulator::Schedule (Seconds (1.2), &DhcpRawClient::Send, &raw, 1, DhcpHeader::DHCPDECLINE, first, any);
+  // Client 2 declines .11 at 3.2 s, until 8.2 s
+  Simulator::Schedule (Seconds (3.0), &DhcpRawClient::Send, &raw, 2, DhcpHeader::DHCPDISCOVER, any, any);
+  Simulator::Schedule (Seconds (3.1), &DhcpRawClient::Send, &raw, 2, DhcpHeader::DHCPREQ, second, any);
+  Simulator::Schedule (Seconds (3.2), &DhcpRawClient::Send, &raw, 2, DhcpHeader::DHCPDECLINE, second, any);
+  // Both addresses are in quarantine
+  Simulator::Schedule (Seconds (5.0), &DhcpRawClient::Send, &raw, 3, DhcpHeader::DHCPDISCOVER, any, any);
+  // Only .10 is back in the pool
+  Simulator::Schedule (Seconds (7.0), &DhcpRawClient::Send, &raw, 4, DhcpHeader::DHCPDISCOVER, any, any);
+  Simulator::Schedule (Seconds (7.5), &DhcpRawClient::Send, &raw, 5, DhcpHeader::DHCPDISCOVER, any, any);
+  // And .11 after it
+  Simulator::Schedule (Seconds (9.0), &DhcpRawClient::Send, &raw, 6, DhcpHeader::DHCPDISCOVER, any, any);
+
+  Simulator::Stop (Seconds (21.0));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (raw.GetReply (1, DhcpHeader::DHCPACK), first, "The first address was not leased");
+  NS_TEST_ASSERT_MSG_EQ (raw.GetReply (2, DhcpHeader::DHCPACK), second, "The second address was not leased");
+  NS_TEST_ASSERT_MSG_EQ (raw.GetReply (3, DhcpHeader::DHCPOFFER), any, "An address in quarantine was offered");
+  NS_TEST_ASSERT_MSG_EQ (raw.GetReply (4, DhcpHeader::DHCPOFFER), first, "The first quarantine did not end in time");
+  NS_TEST_ASSERT_MSG_EQ (raw.GetReply (5, DhcpHeader::DHCPOFFER), any, "The second quarantine ended too early");
+  NS_TEST_ASSERT_MSG_EQ (raw.GetReply (6, DhcpHeader::DHCPOFFER), second, "The second quarantine did not end in time");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP lease expiry: a lease ends at its expiry time, and a lease
+ * renewed in the middle of its term does not end at its former time
+ */
+class DhcpLeaseExpiryTestCase : public TestCase
+{
+public:
+  DhcpLeaseExpiryTestCase ();
+  virtual ~DhcpLeaseExpiryTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DhcpLeaseExpiryTestCase::DhcpLeaseExpiryTestCase ()
+  : TestCase ("Dhcp lease expiry test case ")
+{
+}
+
+DhcpLeaseExpiryTestCase::~DhcpLeaseExpiryTestCase ()
+{
+}
+
+void
+DhcpLeaseExpiryTestCase::DoRun (void)
+{
+  NodeContainer nodes;
+  nodes.Create (2);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  NetDeviceContainer devNet = simpleNetDevice.Install (nodes);
+
+  InternetStackHelper tcpip;
+  tcpip.Install (nodes);
+
+  DhcpHelper dhcpHelper;
+  dhcpHelper.SetServerAttribute ("LeaseTime", TimeValue (Seconds (10)));
+  dhcpHelper.SetServerAttribute ("RenewTime", TimeValue (Seconds (5)));
+  dhcpHelper.SetServerAttribute ("RebindTime", TimeValue (Seconds (8)));
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.11"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (20.0));
+
+  DhcpRawClient raw (devNet.Get (1));
+  Ipv4Address any = Ipv4Address::GetAny ();
+  Ipv4Address first ("172.30.0.10");
+  Ipv4Address second ("172.30.0.11");
+
+  // Client 1 leases .10 until 11.1 s, and renews it at 6 s, until 16 s
+  Simulator::Schedule (Seconds (1.0), &DhcpRawClient::Send, &raw, 1, DhcpHeader::DHCPDISCOVER, any, any);
+  Simulator::Schedule (Seconds (1.1), &DhcpRawClient::Send, &raw, 1, DhcpHeader::DHCPREQ, first, any);
+  Simulator::Schedule (Seconds (6.0), &DhcpRawClient::Send, &raw, 1, DhcpHeader::DHCPREQ, any, first);
+  // Client 2 leases .11 until 11.3 s
+  Simulator::Schedule (Seconds (1.2), &DhcpRawClient::Send, &raw, 2, DhcpHeader::DHCPDISCOVER, any, any);
+  Simulator::Schedule (Seconds (1.3), &DhcpRawClient::Send, &raw, 2, DhcpHeader::DHCPREQ, second, any);
+  // No lease has ended yet
+  Simulator::Schedule (Seconds (10.5), &DhcpRawClient::Send, &raw, 3, DhcpHeader::DHCPDISCOVER, any, any);
+  // The lease of .11 has ended, and .10 would be offered first had it ended too
+  Simulator::Schedule (Seconds (12.0), &DhcpRawClient::Send, &raw, 4, DhcpHeader::DHCPDISCOVER, any, any);
+  // The renewed lease has ended
+  Simulator::Schedule (Seconds (16.5), &DhcpRawClient::Send, &raw, 5, DhcpHeader::DHCPDISCOVER, any, any);
+
+  Simulator::Stop (Seconds (21.0));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (raw.GetReply (1, DhcpHeader::DHCPACK), first, "The first address was not leased");
+  NS_TEST_ASSERT_MSG_EQ (raw.GetReply (2, DhcpHeader::DHCPACK), second, "The second address was not leased");
+  NS_TEST_ASSERT_MSG_EQ (raw.GetReply (3, DhcpHeader::DHCPOFFER), any, "A lease ended too early");
+  NS_TEST_ASSERT_MSG_EQ (raw.GetReply (4, DhcpHeader::DHCPOFFER), second, "The lease did not end at its time");
+  NS_TEST_ASSERT_MSG_EQ (raw.GetReply (5, DhcpHeader::DHCPOFFER), first, "The renewed lease did not end at its time");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP Rapid Commit test: the client is configured by the first
+ * server reply, without the offer collection and the REQUEST.
+ */
+class DhcpRapidCommitTestCase : public TestCase
+{
+public:
+  DhcpRapidCommitTestCase ();
+  virtual ~DhcpRapidCommitTestCase ();
+  /**
+   * Triggered by an address lease on a client.
+   * \param context The test name.
+   * \param newAddress The leased address.
+   */
+  void LeaseObtained (std::string context, const Ipv4Address& newAddress);
+private:
+  virtual void DoRun (void);
+  Ipv4Address m_leasedAddress; //!< Address given to the node
+  Time m_leaseTime;            //!< Time of the lease
+};
+
+DhcpRapidCommitTestCase::DhcpRapidCommitTestCase ()
+  : TestCase ("Dhcp rapid commit test case ")
+{
+}
+
+DhcpRapidCommitTestCase::~DhcpRapidCommitTestCase ()
+{
+}
+
+void
+DhcpRapidCommitTestCase::LeaseObtained (std::string context, const Ipv4Address& newAddress)
+{
+  m_leasedAddress = newAddress;
+  m_leaseTime = Simulator::Now ();
+}
+
+void
+DhcpRapidCommitTestCase::DoRun (void)
+{
+  /*Set up devices*/
+  NodeContainer nodes;
+  NodeContainer routers;
+  nodes.Create (1);
+  routers.Create (1);
+
+  NodeContainer net (routers, nodes);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devNet = simpleNetDevice.Install (net);
+
+  InternetStackHelper tcpip;
+  tcpip.Install (routers);
+  tcpip.Install (nodes);
+
+  DhcpHelper dhcpHelper;
+  dhcpHelper.SetServerAttribute ("RapidCommit", BooleanValue (true));
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (10.0));
+
+  dhcpHelper.SetClientAttribute ("RapidCommit", BooleanValue (true));
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (devNet.Get (1));
+  dhcpClientApps.Start (Seconds (1.0));
+  dhcpClientApps.Stop (Seconds (10.0));
+
+  dhcpClientApps.Get(0)->TraceConnect ("NewLease", "0", MakeCallback(&DhcpRapidCommitTestCase::LeaseObtained, this));
+
+  Simulator::Stop (Seconds (11.0));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress, Ipv4Address ("172.30.0.10"),
+                         m_leasedAddress << " instead of " << "172.30.0.10");
+
+  // One round trip, far below the offer collection time
+  NS_TEST_ASSERT_MSG_LT (m_leaseTime, Seconds (1.1), "Lease obtained at " << m_leaseTime.As (Time::S));
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP relay with two client subnets: the Relay Agent Information
+ * echoed by the server sends each reply only to the subnet of its client.
+ */
+class DhcpRelayAgentInformationTestCase : public DhcpLeaseRecorderTestCase
+{
+public:
+  DhcpRelayAgentInformationTestCase ();
+  virtual ~DhcpRelayAgentInformationTestCase ();
+  /**
+   * Triggered by the reception of an IPv4 packet on a client.
+   * \param context The test name.
+   * \param packet The packet.
+   * \param ipv4 The IPv4 stack.
+   * \param interface The incoming interface.
+   */
+  void PacketReceived (std::string context, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface);
+private:
+  virtual void DoRun (void);
+  uint32_t m_replies[2]; //!< DHCP server replies received by the nodes
+};
+
+DhcpRelayAgentInformationTestCase::DhcpRelayAgentInformationTestCase ()
+  : DhcpLeaseRecorderTestCase ("Dhcp relay agent information test case ", 2)
+{
+  m_replies[0] = 0;
+  m_replies[1] = 0;
+}
+
+DhcpRelayAgentInformationTestCase::~DhcpRelayAgentInformationTestCase ()
+{
+}
+
+void
+DhcpRelayAgentInformationTestCase::PacketReceived (std::string context, Ptr<const Packet> packet,
+                                                   Ptr<Ipv4> ipv4, uint32_t interface)
+{
+  uint8_t numericalContext = std::stoi (context, nullptr, 10);
+
+  Ptr<Packet> copy = packet->Copy ();
+  Ipv4Header ipHeader;
+  UdpHeader udpHeader;
+  copy->RemoveHeader (ipHeader);
+  if (ipHeader.GetProtocol () == UdpL4Protocol::PROT_NUMBER && copy->PeekHeader (udpHeader)
+      && udpHeader.GetDestinationPort () == 68 && numericalContext <= 1)
+    {
+      m_replies[numericalContext]++;
+    }
+}
+
+void
+DhcpRelayAgentInformationTestCase::DoRun (void)
+{
+  /*Set up devices: a server, a relay with two client subnets and one client on each*/
+  Ptr<Node> server = CreateObject<Node> ();
+  Ptr<Node> relay = CreateObject<Node> ();
+  NodeContainer clients;
+  clients.Create (2);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devServer = simpleNetDevice.Install (NodeContainer (server, relay));
+  NetDeviceContainer devNetA = simpleNetDevice.Install (NodeContainer (relay, clients.Get (0)));
+  NetDeviceContainer devNetB = simpleNetDevice.Install (NodeContainer (relay, clients.Get (1)));
+
+  InternetStackHelper tcpip;
+  tcpip.Install (server);
+  tcpip.Install (relay);
+  tcpip.Install (clients);
+
+  DhcpHelper dhcpHelper;
+
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devServer.Get (0), Ipv4Address ("172.30.2.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.1.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.1.10"),
+                             Ipv4Address ("172.30.1.15"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (10.0));
+
+  ApplicationContainer dhcpRelayApp = dhcpHelper.InstallDhcpRelay (devServer.Get (1), Ipv4Address ("172.30.2.2"),
+                                                                   Ipv4Mask ("/24"), Ipv4Address ("172.30.2.1"));
+  dhcpHelper.AddRelayInterface (&dhcpRelayApp, devNetA.Get (0), Ipv4Address ("172.30.0.1"), Ipv4Mask ("/24"));
+  dhcpHelper.AddRelayInterface (&dhcpRelayApp, devNetB.Get (0), Ipv4Address ("172.30.1.1"), Ipv4Mask ("/24"));
+  dhcpRelayApp.Start (Seconds (0.0));
+  dhcpRelayApp.Stop (Seconds (10.0));
+
+  NetDeviceContainer dhcpClientNetDevs;
+  dhcpClientNetDevs.Add (devNetA.Get (1));
+  dhcpClientNetDevs.Add (devNetB.Get (1));
+
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (dhcpClientNetDevs);
+  dhcpClientApps.Start (Seconds (1.0));
+  dhcpClientApps.Stop (Seconds (10.0));
+
+  dhcpClientApps.Get(0)->TraceConnect ("NewLease", "0", MakeCallback(&DhcpRelayAgentInformationTestCase::LeaseObtained, this));
+  dhcpClientApps.Get(1)->TraceConnect ("NewLease", "1", MakeCallback(&DhcpRelayAgentInformationTestCase::LeaseObtained, this));
+  clients.Get (0)->GetObject<Ipv4L3Protocol> ()->TraceConnect ("Rx", "0", MakeCallback (&DhcpRelayAgentInformationTestCase::PacketReceived, this));
+  clients.Get (1)->GetObject<Ipv4L3Protocol> ()->TraceConnect ("Rx", "1", MakeCallback (&DhcpRelayAgentInformationTestCase::PacketReceived, this));
+
+  Simulator::Stop (Seconds (11.0));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[0], Ipv4Address ("172.30.0.10"),
+                         m_leasedAddress[0] << " instead of " << "172.30.0.10");
+
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[1], Ipv4Address ("172.30.1.10"),
+                         m_leasedAddress[1] << " instead of " << "172.30.1.10");
+
+  // Each client gets its OFFER and its ACK, and none of the replies to the other one
+  NS_TEST_ASSERT_MSG_EQ (m_replies[0], 2, "Wrong number of replies on the first subnet");
+  NS_TEST_ASSERT_MSG_EQ (m_replies[1], 2, "Wrong number of replies on the second subnet");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP relay interface changes: a client subnet whose interface
+ * comes up after the start of the relay is relayed.
+ */
+class DhcpRelayInterfaceTestCase : public TestCase
+{
+public:
+  DhcpRelayInterfaceTestCase ();
+  virtual ~DhcpRelayInterfaceTestCase ();
+  /**
+   * Triggered by an address lease on a client.
+   * \param context The test name.
+   * \param newAddress The leased address.
+   */
+  void LeaseObtained (std::string context, const Ipv4Address& newAddress);
+private:
+  virtual void DoRun (void);
+  Ipv4Address m_leasedAddress; //!< Address given to the node
+  Time m_leaseTime;            //!< Time of the lease
+};
+
+DhcpRelayInterfaceTestCase::DhcpRelayInterfaceTestCase ()
+  : TestCase ("Dhcp relay interface test case ")
+{
+}
+
+DhcpRelayInterfaceTestCase::~DhcpRelayInterfaceTestCase ()
+{
+}
+
+void
+DhcpRelayInterfaceTestCase::LeaseObtained (std::string context, const Ipv4Address& newAddress)
+{
+  m_leasedAddress = newAddress;
+  m_leaseTime = Simulator::Now ();
+}
+
+void
+DhcpRelayInterfaceTestCase::DoRun (void)
+{
+  /*Set up devices: a server, a relay and a client behind the relay*/
+  Ptr<Node> server = CreateObject<Node> ();
+  Ptr<Node> relay = CreateObject<Node> ();
+  Ptr<Node> client = CreateObject<Node> ();
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devServer = simpleNetDevice.Install (NodeContainer (server, relay));
+  NetDeviceContainer devNet = simpleNetDevice.Install (NodeContainer (relay, client));
+
+  InternetStackHelper tcpip;
+  tcpip.Install (server);
+  tcpip.Install (relay);
+  tcpip.Install (client);
+
+  DhcpHelper dhcpHelper;
+
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devServer.Get (0), Ipv4Address ("172.30.2.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (20.0));
+
+  ApplicationContainer dhcpRelayApp = dhcpHelper.InstallDhcpRelay (devServer.Get (1), Ipv4Address ("172.30.2.2"),
+                                                                   Ipv4Mask ("/24"), Ipv4Address ("172.30.2.1"));
+  dhcpHelper.AddRelayInterface (&dhcpRelayApp, devNet.Get (0), Ipv4Address ("172.30.0.1"), Ipv4Mask ("/24"));
+  dhcpRelayApp.Start (Seconds (0.0));
+  dhcpRelayApp.Stop (Seconds (20.0));
+
+  // The client interface of the relay is down when the client starts
+  Ptr<Ipv4> ipv4 = relay->GetObject<Ipv4> ();
+  uint32_t ifIndex = ipv4->GetInterfaceForDevice (devNet.Get (0));
+  Simulator::Schedule (Seconds (0.5), &Ipv4::SetDown, ipv4, ifIndex);
+  Simulator::Schedule (Seconds (3.0), &Ipv4::SetUp, ipv4, ifIndex);
+
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (devNet.Get (1));
+  dhcpClientApps.Start (Seconds (1.0));
+  dhcpClientApps.Stop (Seconds (20.0));
+
+  dhcpClientApps.Get(0)->TraceConnect ("NewLease", "0", MakeCallback(&DhcpRelayInterfaceTestCase::LeaseObtained, this));
+
+  Simulator::Stop (Seconds (21.0));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress, Ipv4Address ("172.30.0.10"),
+                         m_leasedAddress << " instead of " << "172.30.0.10");
+
+  // Not before the interface came up again
+  NS_TEST_ASSERT_MSG_GT (m_leaseTime, Seconds (3.0), "Lease obtained at " << m_leaseTime.As (Time::S));
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP server with nested pool subnets: the client of a relay agent
+ * gets its address from the pool of the longest prefix holding the giaddr
+ */
+class DhcpNestedSubnetsTestCase : public DhcpLeaseRecorderTestCase
+{
+public:
+  DhcpNestedSubnetsTestCase ();
+  virtual ~DhcpNestedSubnetsTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DhcpNestedSubnetsTestCase::DhcpNestedSubnetsTestCase ()
+  : DhcpLeaseRecorderTestCase ("Dhcp nested subnets test case ", 2)
+{
+}
+
+DhcpNestedSubnetsTestCase::~DhcpNestedSubnetsTestCase ()
+{
+}
+
+void
+DhcpNestedSubnetsTestCase::DoRun (void)
+{
+  /*Set up devices: a server, a relay and a client on each side of the relay*/
+  Ptr<Node> server = CreateObject<Node> ();
+  Ptr<Node> relay = CreateObject<Node> ();
+  NodeContainer clients;
+  clients.Create (2);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devServer = simpleNetDevice.Install (NodeContainer (server, relay));
+  NetDeviceContainer devNet0 = simpleNetDevice.Install (NodeContainer (relay, clients.Get (0)));
+  NetDeviceContainer devNet1 = simpleNetDevice.Install (NodeContainer (relay, clients.Get (1)));
+
+  InternetStackHelper tcpip;
+  tcpip.Install (server);
+  tcpip.Install (relay);
+  tcpip.Install (clients);
+
+  // A /24 pool nested in a /16 one
+  DhcpHelper dhcpHelper;
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devServer.Get (0), Ipv4Address ("172.30.2.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("10.0.0.0"), Ipv4Mask ("/16"), Ipv4Address ("10.0.100.10"),
+                             Ipv4Address ("10.0.100.15"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("10.0.5.0"), Ipv4Mask ("/24"), Ipv4Address ("10.0.5.10"),
+                             Ipv4Address ("10.0.5.15"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (20.0));
+
+  // The giaddr of the first client is in both subnets, the one of the second only in the /16
+  ApplicationContainer dhcpRelayApp = dhcpHelper.InstallDhcpRelay (devServer.Get (1), Ipv4Address ("172.30.2.2"),
+                                                                   Ipv4Mask ("/24"), Ipv4Address ("172.30.2.1"));
+  dhcpHelper.AddRelayInterface (&dhcpRelayApp, devNet0.Get (0), Ipv4Address ("10.0.5.1"), Ipv4Mask ("/24"));
+  dhcpHelper.AddRelayInterface (&dhcpRelayApp, devNet1.Get (0), Ipv4Address ("10.0.7.1"), Ipv4Mask ("/16"));
+  dhcpRelayApp.Start (Seconds (0.0));
+  dhcpRelayApp.Stop (Seconds (20.0));
+
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      ApplicationContainer dhcpClientApp = dhcpHelper.InstallDhcpClient ((i == 0 ? devNet0 : devNet1).Get (1));
+      dhcpClientApp.Start (Seconds (1.0 + i));
+      dhcpClientApp.Stop (Seconds (20.0));
+      std::ostringstream context;
+      context << i;
+      dhcpClientApp.Get (0)->TraceConnect ("NewLease", context.str (), MakeCallback (&DhcpNestedSubnetsTestCase::LeaseObtained, this));
+    }
+
+  Simulator::Stop (Seconds (21.0));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[0], Ipv4Address ("10.0.5.10"),
+                         m_leasedAddress[0] << " instead of " << "10.0.5.10");
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[1], Ipv4Address ("10.0.100.10"),
+                         m_leasedAddress[1] << " instead of " << "10.0.100.10");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP relay with two servers: the clients get their lease from
+ * the servers chosen by the ServerSelection policy, and the per-server
+ * counters add up.
+ */
+class DhcpRelayServersTestCase : public DhcpLeaseRecorderTestCase
+{
+public:
+  /**
+   * Constructor
+   * \param selection The ServerSelection policy of the relay.
+   * \param name The name of the policy.
+   */
+  DhcpRelayServersTestCase (DhcpRelay::ServerSelection selection, std::string name);
+  virtual ~DhcpRelayServersTestCase ();
+private:
+  virtual void DoRun (void);
+  DhcpRelay::ServerSelection m_selection; //!< ServerSelection policy of the relay
+};
+
+DhcpRelayServersTestCase::DhcpRelayServersTestCase (DhcpRelay::ServerSelection selection, std::string name)
+  : DhcpLeaseRecorderTestCase ("Dhcp relay servers test case, " + name + " selection ", 4),
+    m_selection (selection)
+{
+}
+
+DhcpRelayServersTestCase::~DhcpRelayServersTestCase ()
+{
+}
+
+void
+DhcpRelayServersTestCase::DoRun (void)
+{
+  /*Set up devices: two servers, a relay and four clients behind the relay*/
+  NodeContainer servers;
+  servers.Create (2);
+  Ptr<Node> relay = CreateObject<Node> ();
+  NodeContainer clients;
+  clients.Create (4);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devServer = simpleNetDevice.Install (NodeContainer (servers, relay));
+  NetDeviceContainer devNet = simpleNetDevice.Install (NodeContainer (relay, clients));
+
+  InternetStackHelper tcpip;
+  tcpip.Install (servers);
+  tcpip.Install (relay);
+  tcpip.Install (clients);
+
+  DhcpHelper dhcpHelper;
+
+  // Both servers serve the client subnet, from disjoint ranges
+  ApplicationContainer dhcpServerApps = dhcpHelper.InstallDhcpServer (devServer.Get (0), Ipv4Address ("172.30.2.1"),
+                                                                      Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApps, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devServer.Get (1), Ipv4Address ("172.30.2.3"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.20"),
+                             Ipv4Address ("172.30.0.25"));
+  dhcpServerApps.Add (dhcpServerApp);
+  dhcpServerApps.Start (Seconds (0.0));
+  dhcpServerApps.Stop (Seconds (20.0));
+
+  ApplicationContainer dhcpRelayApp = dhcpHelper.InstallDhcpRelay (devServer.Get (2), Ipv4Address ("172.30.2.2"),
+                                                                   Ipv4Mask ("/24"), Ipv4Address ("172.30.2.1"));
+  dhcpHelper.AddRelayServer (&dhcpRelayApp, Ipv4Address ("172.30.2.3"));
+  dhcpHelper.AddRelayInterface (&dhcpRelayApp, devNet.Get (0), Ipv4Address ("172.30.0.1"), Ipv4Mask ("/24"));
+  dhcpRelayApp.Get (0)->SetAttribute ("ServerSelection", EnumValue (m_selection));
+  dhcpRelayApp.Start (Seconds (0.0));
+  dhcpRelayApp.Stop (Seconds (20.0));
+
+  // The messages of the four clients wait together for ARP on the server link
+  for (uint32_t i = 0; i < devServer.GetN (); i++)
+    {
+      Ptr<Ipv4L3Protocol> ipv4 = devServer.Get (i)->GetNode ()->GetObject<Ipv4L3Protocol> ();
+      Ptr<Ipv4Interface> iface = ipv4->GetInterface (ipv4->GetInterfaceForDevice (devServer.Get (i)));
+      iface->GetArpCache ()->SetAttribute ("PendingQueueSize", UintegerValue (4));
+    }
+
+  NetDeviceContainer dhcpClientNetDevs;
+  for (uint32_t i = 1; i < devNet.GetN (); i++)
+    {
+      dhcpClientNetDevs.Add (devNet.Get (i));
+    }
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (dhcpClientNetDevs);
+  dhcpClientApps.Start (Seconds (1.0));
+  dhcpClientApps.Stop (Seconds (20.0));
+
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      std::ostringstream context;
+      context << i;
+      dhcpClientApps.Get (i)->TraceConnect ("NewLease", context.str (), MakeCallback (&DhcpRelayServersTestCase::LeaseObtained, this));
+    }
+
+  Simulator::Stop (Seconds (21.0));
+
+  Simulator::Run ();
+
+  uint32_t leases[2] = { 0, 0 };
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      uint32_t host = m_leasedAddress[i].Get () - Ipv4Address ("172.30.0.0").Get ();
+      NS_TEST_ASSERT_MSG_EQ (((host >= 10 && host <= 15) || (host >= 20 && host <= 25)), true,
+                             "Client " << i << " got " << m_leasedAddress[i]);
+      leases[host / 20]++;
+      for (uint32_t j = 0; j < i; j++)
+        {
+          NS_TEST_ASSERT_MSG_NE (m_leasedAddress[i], m_leasedAddress[j], "Clients " << j << " and " << i << " share an address");
+        }
+    }
+
+  Ptr<DhcpRelay> dhcpRelay = DynamicCast<DhcpRelay> (dhcpRelayApp.Get (0));
+  NS_TEST_ASSERT_MSG_EQ (dhcpRelay->GetNServers (), 2, "Wrong number of servers");
+  NS_TEST_ASSERT_MSG_EQ (dhcpRelay->GetServerCounters (0).address, Ipv4Address ("172.30.2.1"), "Wrong first server");
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      DhcpRelay::ServerCounters counters = dhcpRelay->GetServerCounters (i);
+      NS_TEST_ASSERT_MSG_EQ (counters.outstanding, 0, "Server " << i << " has messages without reply");
+      if (m_selection == DhcpRelay::SELECT_ALL)
+        {
+          // Every DISCOVER and REQUEST, every OFFER, and the ACKs of the server chosen
+          NS_TEST_ASSERT_MSG_EQ (counters.forwarded, 8, "Wrong number of messages to server " << i);
+          NS_TEST_ASSERT_MSG_EQ (counters.replies, 4 + leases[i], "Wrong number of replies from server " << i);
+        }
+      else
+        {
+          // The DISCOVER and the REQUEST of the clients of the server only
+          NS_TEST_ASSERT_MSG_EQ (counters.forwarded, 2 * leases[i], "Wrong number of messages to server " << i);
+          NS_TEST_ASSERT_MSG_EQ (counters.replies, 2 * leases[i], "Wrong number of replies from server " << i);
+        }
+    }
+
+  if (m_selection == DhcpRelay::SELECT_LEAST_OUTSTANDING)
+    {
+      // The clients start together, the servers take turns
+      NS_TEST_ASSERT_MSG_EQ (leases[0], 2, "Wrong number of leases from the first server");
+      NS_TEST_ASSERT_MSG_EQ (leases[1], 2, "Wrong number of leases from the second server");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP relay outstanding messages: two clients using the same
+ * transaction id each have a message waiting for the reply of the server.
+ */
+class DhcpRelayOutstandingTestCase : public TestCase
+{
+public:
+  DhcpRelayOutstandingTestCase ();
+  virtual ~DhcpRelayOutstandingTestCase ();
+  /**
+   * Read the number of messages waiting for the reply of the server.
+   * \param relay The relay.
+   */
+  void ReadOutstanding (Ptr<DhcpRelay> relay);
+private:
+  virtual void DoRun (void);
+  uint32_t m_outstanding;       //!< Messages waiting for the reply of the server
+};
+
+DhcpRelayOutstandingTestCase::DhcpRelayOutstandingTestCase ()
+  : TestCase ("Dhcp relay outstanding test case "),
+    m_outstanding (0)
+{
+}
+
+DhcpRelayOutstandingTestCase::~DhcpRelayOutstandingTestCase ()
+{
+}
+
+void
+DhcpRelayOutstandingTestCase::ReadOutstanding (Ptr<DhcpRelay> relay)
+{
+  m_outstanding = relay->GetServerCounters (0).outstanding;
+}
+
+void
+DhcpRelayOutstandingTestCase::DoRun (void)
+{
+  /*Set up devices: a server, a relay and two clients behind the relay*/
+  Ptr<Node> server = CreateObject<Node> ();
+  Ptr<Node> relay = CreateObject<Node> ();
+  NodeContainer clients;
+  clients.Create (2);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devServer = simpleNetDevice.Install (NodeContainer (server, relay));
+  NetDeviceContainer devNet = simpleNetDevice.Install (NodeContainer (relay, clients));
+
+  InternetStackHelper tcpip;
+  tcpip.Install (server);
+  tcpip.Install (relay);
+  tcpip.Install (clients);
+
+  // The server starts too late to answer the first DISCOVERs
+  DhcpHelper dhcpHelper;
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devServer.Get (0), Ipv4Address ("172.30.2.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
+  dhcpServerApp.Start (Seconds (10.0));
+
+  ApplicationContainer dhcpRelayApp = dhcpHelper.InstallDhcpRelay (devServer.Get (1), Ipv4Address ("172.30.2.2"),
+                                                                   Ipv4Mask ("/24"), Ipv4Address ("172.30.2.1"));
+  dhcpHelper.AddRelayInterface (&dhcpRelayApp, devNet.Get (0), Ipv4Address ("172.30.0.1"), Ipv4Mask ("/24"));
+  dhcpRelayApp.Start (Seconds (0.0));
+
+  dhcpHelper.SetClientAttribute ("Transactions", StringValue ("ns3::ConstantRandomVariable[Constant=42]"));
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (NetDeviceContainer (devNet.Get (1), devNet.Get (2)));
+  dhcpClientApps.Start (Seconds (1.0));
+
+  Simulator::Schedule (Seconds (2.0), &DhcpRelayOutstandingTestCase::ReadOutstanding, this,
+                       DynamicCast<DhcpRelay> (dhcpRelayApp.Get (0)));
+  Simulator::Stop (Seconds (3.0));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_outstanding, 2, "Messages of the same transaction id from two clients not both waiting");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP relay forwarding: the messages go through the relay
+ * unchanged, except for hops, giaddr and the Relay Agent Information.
+ */
+class DhcpRelayForwardingTestCase : public TestCase
+{
+public:
+  DhcpRelayForwardingTestCase ();
+  virtual ~DhcpRelayForwardingTestCase ();
+  /**
+   * Triggered by the transmission or the reception of an IPv4 packet.
+   * \param context The node and the direction of the packet.
+   * \param packet The packet.
+   * \param ipv4 The IPv4 stack.
+   * \param interface The interface.
+   */
+  void PacketSeen (std::string context, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface);
+private:
+  virtual void DoRun (void);
+  /// DHCP messages, as bytes
+  typedef std::vector<std::vector<uint8_t> > Messages;
+  Messages m_clientRequests; //!< DISCOVER and REQUEST sent by the client
+  Messages m_serverRequests; //!< DISCOVER and REQUEST received by the server
+  Messages m_serverReplies;  //!< Replies sent by the server
+  Messages m_clientReplies;  //!< Replies received by the client
+};
+
+DhcpRelayForwardingTestCase::DhcpRelayForwardingTestCase ()
+  : TestCase ("Dhcp relay forwarding test case ")
+{
+}
+
+DhcpRelayForwardingTestCase::~DhcpRelayForwardingTestCase ()
+{
+}
+
+void
+DhcpRelayForwardingTestCase::PacketSeen (std::string context, Ptr<const Packet> packet,
+                                         Ptr<Ipv4> ipv4, uint32_t interface)
+{
+  if (DynamicCast<LoopbackNetDevice> (ipv4->GetNetDevice (interface)) != 0)
+    {
+      return;
+    }
+  Ptr<Packet> copy = packet->Copy ();
+  Ipv4Header ipHeader;
+  UdpHeader udpHeader;
+  copy->RemoveHeader (ipHeader);
+  if (ipHeader.GetProtocol () != UdpL4Protocol::PROT_NUMBER || copy->RemoveHeader (udpHeader) == 0)
+    {
+      return;
+    }
+  DhcpHeaderView header (copy);
+  if (!header.IsValid ())
+    {
+      return;
+    }
+  std::vector<uint8_t> bytes (copy->GetSize ());
+  copy->CopyData (&bytes[0], bytes.size ());
+
+  bool request = (udpHeader.GetDestinationPort () == 67);
+  if (request && header.GetType () != DhcpHeader::DHCPDISCOVER && header.GetType () != DhcpHeader::DHCPREQ)
+    {
+      return;
+    }
+  if (context == "client Tx" && request)
+    {
+      m_clientRequests.push_back (bytes);
+    }
+  else if (context == "server Rx" && request)
+    {
+      m_serverRequests.push_back (bytes);
+    }
+  else if (context == "server Tx" && !request)
+    {
+      m_serverReplies.push_back (bytes);
+    }
+  else if (context == "client Rx" && !request)
+    {
+      m_clientReplies.push_back (bytes);
+    }
+}
+
+void
+DhcpRelayForwardingTestCase::DoRun (void)
+{
+  /*Set up devices: a server, a relay and a client behind the relay*/
+  Ptr<Node> server = CreateObject<Node> ();
+  Ptr<Node> relay = CreateObject<Node> ();
+  Ptr<Node> client = CreateObject<Node> ();
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devServer = simpleNetDevice.Install (NodeContainer (server, relay));
+  NetDeviceContainer devNet = simpleNetDevice.Install (NodeContainer (relay, client));
+
+  InternetStackHelper tcpip;
+  tcpip.Install (server);
+  tcpip.Install (relay);
+  tcpip.Install (client);
+
+  DhcpHelper dhcpHelper;
+
+  // The router option is one the relay used to drop
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devServer.Get (0), Ipv4Address ("172.30.2.1"),
+                                                                     Ipv4Mask ("/24"), Ipv4Address ("172.30.0.254"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (10.0));
+
+  ApplicationContainer dhcpRelayApp = dhcpHelper.InstallDhcpRelay (devServer.Get (1), Ipv4Address ("172.30.2.2"),
+                                                                   Ipv4Mask ("/24"), Ipv4Address ("172.30.2.1"));
+  dhcpHelper.AddRelayInterface (&dhcpRelayApp, devNet.Get (0), Ipv4Address ("172.30.0.1"), Ipv4Mask ("/24"));
+  dhcpRelayApp.Start (Seconds (0.0));
+  dhcpRelayApp.Stop (Seconds (10.0));
+
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (devNet.Get (1));
+  dhcpClientApps.Start (Seconds (1.0));
+  dhcpClientApps.Stop (Seconds (10.0));
+
+  client->GetObject<Ipv4L3Protocol> ()->TraceConnect ("Tx", "client Tx", MakeCallback (&DhcpRelayForwardingTestCase::PacketSeen, this));
+  client->GetObject<Ipv4L3Protocol> ()->TraceConnect ("Rx", "client Rx", MakeCallback (&DhcpRelayForwardingTestCase::PacketSeen, this));
+  server->GetObject<Ipv4L3Protocol> ()->TraceConnect ("Tx", "server Tx", MakeCallback (&DhcpRelayForwardingTestCase::PacketSeen, this));
+  server->GetObject<Ipv4L3Protocol> ()->TraceConnect ("Rx", "server Rx", MakeCallback (&DhcpRelayForwardingTestCase::PacketSeen, this));
+
+  Simulator::Stop (Seconds (11.0));
+
+  Simulator::Run ();
+
+  // DISCOVER and REQUEST
+  NS_TEST_ASSERT_MSG_EQ (m_clientRequests.size (), 2, "Wrong number of messages sent by the client");
+  NS_TEST_ASSERT_MSG_EQ (m_serverRequests.size (), 2, "Wrong number of messages received by the server");
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      std::vector<uint8_t> &bytes = m_serverRequests[i];
+      NS_TEST_ASSERT_MSG_EQ ((uint32_t) bytes[DhcpHeader::OFFSET_HOPS], 1, "Wrong hops in message " << i);
+
+      Ptr<Packet> forwarded = Create<Packet> (&bytes[0], bytes.size ());
+      DhcpHeader header;
+      forwarded->RemoveHeader (header);
+      NS_TEST_ASSERT_MSG_EQ (header.GetGiAddr (), Ipv4Address ("172.30.0.1"), "Wrong giaddr in message " << i);
+      NS_TEST_ASSERT_MSG_EQ (header.HasOption (DhcpHeader::OP_AGENT_INFO), true, "No agent information in message " << i);
+
+      // Without what the relay sets, this is the message of the client
+      header.RemoveOption (DhcpHeader::OP_AGENT_INFO);
+      header.SetGiAddr (Ipv4Address::GetAny ());
+      Ptr<Packet> original = Create<Packet> ();
+      original->AddHeader (header);
+      std::vector<uint8_t> expected (original->GetSize ());
+      original->CopyData (&expected[0], expected.size ());
+      expected[DhcpHeader::OFFSET_HOPS] = 0;
+      NS_TEST_ASSERT_MSG_EQ ((expected == m_clientRequests[i]), true, "Message " << i << " changed by the relay");
+    }
+
+  // OFFER and ACK
+  NS_TEST_ASSERT_MSG_EQ (m_serverReplies.size (), 2, "Wrong number of replies sent by the server");
+  NS_TEST_ASSERT_MSG_EQ (m_clientReplies.size (), 2, "Wrong number of replies received by the client");
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      std::vector<uint8_t> &bytes = m_serverReplies[i];
+      Ptr<Packet> reply = Create<Packet> (&bytes[0], bytes.size ());
+      DhcpHeader header;
+      reply->RemoveHeader (header);
+      if (header.GetType () == DhcpHeader::DHCPOFFER)
+        {
+          NS_TEST_ASSERT_MSG_EQ (header.GetRouter (), Ipv4Address ("172.30.0.254"), "No router in the OFFER");
+        }
+
+      header.RemoveOption (DhcpHeader::OP_AGENT_INFO);
+      Ptr<Packet> forwarded = Create<Packet> ();
+      forwarded->AddHeader (header);
+      std::vector<uint8_t> expected (forwarded->GetSize ());
+      forwarded->CopyData (&expected[0], expected.size ());
+      NS_TEST_ASSERT_MSG_EQ ((expected == m_clientReplies[i]), true, "Reply " << i << " changed by the relay");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP relay transactions: the DISCOVERs a client repeats while the
+ * first one waits for its reply are detected, and dropped if asked.
+ */
+class DhcpRelayTransactionTestCase : public TestCase
+{
+public:
+  /**
+   * Constructor
+   * \param policy The DuplicatePolicy of the relay.
+   * \param name The name of the policy.
+   */
+  DhcpRelayTransactionTestCase (DhcpRelay::DuplicatePolicy policy, std::string name);
+  virtual ~DhcpRelayTransactionTestCase ();
+  /**
+   * Triggered by a change of a relay counter.
+   * \param context The name of the counter.
+   * \param oldValue The previous value.
+   * \param newValue The new value.
+   */
+  void CounterChanged (std::string context, uint32_t oldValue, uint32_t newValue);
+private:
+  virtual void DoRun (void);
+  DhcpRelay::DuplicatePolicy m_policy; //!< DuplicatePolicy of the relay
+  uint32_t m_hits;                     //!< Repeated messages seen by the relay
+  uint32_t m_suppressed;               //!< Repeated messages dropped by the relay
+};
+
+DhcpRelayTransactionTestCase::DhcpRelayTransactionTestCase (DhcpRelay::DuplicatePolicy policy, std::string name)
+  : TestCase ("Dhcp relay transaction test case, " + name + " duplicates "),
+    m_policy (policy),
+    m_hits (0),
+    m_suppressed (0)
+{
+}
+
+DhcpRelayTransactionTestCase::~DhcpRelayTransactionTestCase ()
+{
+}
+
+void
+DhcpRelayTransactionTestCase::CounterChanged (std::string context, uint32_t oldValue, uint32_t newValue)
+{
+  if (context == "hits")
+    {
+      m_hits = newValue;
+    }
+  else
+    {
+      m_suppressed = newValue;
+    }
+}
+
+void
+DhcpRelayTransactionTestCase::DoRun (void)
+{
+  /*Set up devices: a server, a relay and a client behind the relay*/
+  Ptr<Node> server = CreateObject<Node> ();
+  Ptr<Node> relay = CreateObject<Node> ();
+  Ptr<Node> client = CreateObject<Node> ();
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devServer = simpleNetDevice.Install (NodeContainer (server, relay));
+  NetDeviceContainer devNet = simpleNetDevice.Install (NodeContainer (relay, client));
+
+  InternetStackHelper tcpip;
+  tcpip.Install (server);
+  tcpip.Install (relay);
+  tcpip.Install (client);
+
+  DhcpHelper dhcpHelper;
+
+  // The server starts too late to answer: the client repeats its DISCOVER every 5 s
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devServer.Get (0), Ipv4Address ("172.30.2.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
+  dhcpServerApp.Start (Seconds (30.0));
+
+  ApplicationContainer dhcpRelayApp = dhcpHelper.InstallDhcpRelay (devServer.Get (1), Ipv4Address ("172.30.2.2"),
+                                                                   Ipv4Mask ("/24"), Ipv4Address ("172.30.2.1"));
+  dhcpHelper.AddRelayInterface (&dhcpRelayApp, devNet.Get (0), Ipv4Address ("172.30.0.1"), Ipv4Mask ("/24"));
+  dhcpRelayApp.Get (0)->SetAttribute ("DuplicatePolicy", EnumValue (m_policy));
+  dhcpRelayApp.Get (0)->SetAttribute ("ReplyTimeout", TimeValue (Seconds (7)));
+  dhcpRelayApp.Get (0)->TraceConnect ("TransactionHits", "hits", MakeCallback (&DhcpRelayTransactionTestCase::CounterChanged, this));
+  dhcpRelayApp.Get (0)->TraceConnect ("SuppressedMessages", "suppressed", MakeCallback (&DhcpRelayTransactionTestCase::CounterChanged, this));
+  dhcpRelayApp.Start (Seconds (0.0));
+  dhcpRelayApp.Stop (Seconds (20.0));
+
+  // DISCOVERs at 1, 6, 11 and 16 s
+  dhcpHelper.SetClientAttribute ("RTRS", TimeValue (Seconds (5)));
+  dhcpHelper.SetClientAttribute ("MaxRtrs", TimeValue (Seconds (5)));
+  dhcpHelper.SetClientAttribute ("RtrsJitter", StringValue ("ns3::ConstantRandomVariable[Constant=0.0]"));
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (devNet.Get (1));
+  dhcpClientApps.Start (Seconds (1.0));
+  dhcpClientApps.Stop (Seconds (18.0));
+
+  Simulator::Stop (Seconds (21.0));
+
+  Simulator::Run ();
+
+  Ptr<DhcpRelay> dhcpRelay = DynamicCast<DhcpRelay> (dhcpRelayApp.Get (0));
+  if (m_policy == DhcpRelay::SUPPRESS_DUPLICATES)
+    {
+      // The DISCOVERs of 6 and 16 s come within 7 s of the last forwarded one
+      NS_TEST_ASSERT_MSG_EQ (m_hits, 2, "Wrong number of repeated DISCOVERs");
+      NS_TEST_ASSERT_MSG_EQ (m_suppressed, 2, "Wrong number of dropped DISCOVERs");
+      NS_TEST_ASSERT_MSG_EQ (dhcpRelay->GetServerCounters (0).forwarded, 2, "Wrong number of forwarded DISCOVERs");
+    }
+  else
+    {
+      // Each forwarded DISCOVER waits 7 s for its reply, the next one comes after 5 s
+      NS_TEST_ASSERT_MSG_EQ (m_hits, 3, "Wrong number of repeated DISCOVERs");
+      NS_TEST_ASSERT_MSG_EQ (m_suppressed, 0, "Wrong number of dropped DISCOVERs");
+      NS_TEST_ASSERT_MSG_EQ (dhcpRelay->GetServerCounters (0).forwarded, 4, "Wrong number of forwarded DISCOVERs");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP server admission control: a storm of DISCOVERs is shed,
+ * either by the bounded queue or by the token bucket of the clients, and
+ * the RENEW of a bound client is still answered right away.
+ */
+class DhcpServerAdmissionTestCase : public TestCase
+{
+public:
+  /**
+   * Constructor
+   * \param queue Whether the storm is shed by the queue (true) or by the token bucket (false).
+   * \param name The name of the variant.
+   */
+  DhcpServerAdmissionTestCase (bool queue, std::string name);
+  virtual ~DhcpServerAdmissionTestCase ();
+  /**
+   * Triggered by a change of a server counter.
+   * \param context The name of the counter.
+   * \param oldValue The previous value.
+   * \param newValue The new value.
+   */
+  void CounterChanged (std::string context, uint32_t oldValue, uint32_t newValue);
+  /**
+   * Triggered by the reception of an IPv4 packet on the renewing client.
+   * \param packet The packet.
+   * \param ipv4 The IPv4 stack.
+   * \param interface The interface.
+   */
+  void PacketReceived (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface);
+private:
+  virtual void DoRun (void);
+  bool m_queue;           //!< Whether the storm is shed by the queue
+  uint32_t m_queueDrops;  //!< Messages dropped by the server queue
+  uint32_t m_rateDrops;   //!< Messages dropped by the server token buckets
+  Time m_renewAck;        //!< Time of the ACK of the RENEW
+};
+
+DhcpServerAdmissionTestCase::DhcpServerAdmissionTestCase (bool queue, std::string name)
+  : TestCase ("Dhcp server admission test case, " + name + " "),
+    m_queue (queue),
+    m_queueDrops (0),
+    m_rateDrops (0)
+{
+}
+
+DhcpServerAdmissionTestCase::~DhcpServerAdmissionTestCase ()
+{
+}
+
+void
+DhcpServerAdmissionTestCase::CounterChanged (std::string context, uint32_t oldValue, uint32_t newValue)
+{
+  if (context == "queue")
+    {
+      m_queueDrops = newValue;
+    }
+  else
+    {
+      m_rateDrops = newValue;
+    }
+}
+
+void
+DhcpServerAdmissionTestCase::PacketReceived (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+  Ptr<Packet> copy = packet->Copy ();
+  Ipv4Header ipHeader;
+  UdpHeader udpHeader;
+  copy->RemoveHeader (ipHeader);
+  if (ipHeader.GetProtocol () != UdpL4Protocol::PROT_NUMBER || copy->RemoveHeader (udpHeader) == 0)
+    {
+      return;
+    }
+  DhcpHeaderView header (copy);
+  if (header.IsValid () && header.GetType () == DhcpHeader::DHCPACK && Simulator::Now () > Seconds (15))
+    {
+      m_renewAck = Simulator::Now ();
+    }
+}
+
+void
+DhcpServerAdmissionTestCase::DoRun (void)
+{
+  /*Set up devices: a server, a bound client and ten booting clients*/
+  NodeContainer nodes;
+  NodeContainer routers;
+  nodes.Create (11);
+  routers.Create (1);
+
+  NodeContainer net (routers, nodes);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devNet = simpleNetDevice.Install (net);
+
+  InternetStackHelper tcpip;
+  tcpip.Install (routers);
+  tcpip.Install (nodes);
+
+  // Each message keeps the server busy for 1 s
+  DhcpHelper dhcpHelper;
+  dhcpHelper.SetServerAttribute ("ProcessingTime", TimeValue (Seconds (1)));
+  if (m_queue)
+    {
+      dhcpHelper.SetServerAttribute ("QueueLimit", UintegerValue (4));
+    }
+  else
+    {
+      dhcpHelper.SetServerAttribute ("GiaddrRate", DoubleValue (0.1));
+      dhcpHelper.SetServerAttribute ("GiaddrBurst", UintegerValue (4));
+    }
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.40"));
+  dhcpServerApp.Get (0)->TraceConnect ("QueueDrops", "queue", MakeCallback (&DhcpServerAdmissionTestCase::CounterChanged, this));
+  dhcpServerApp.Get (0)->TraceConnect ("RateDrops", "rate", MakeCallback (&DhcpServerAdmissionTestCase::CounterChanged, this));
+  dhcpServerApp.Start (Seconds (0.0));
+
+  // The first client is bound at about 8 s and renews 15 s later
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (devNet.Get (1));
+  dhcpClientApps.Start (Seconds (1.0));
+  nodes.Get (0)->GetObject<Ipv4L3Protocol> ()->TraceConnectWithoutContext ("Rx", MakeCallback (&DhcpServerAdmissionTestCase::PacketReceived, this));
+
+  // The storm comes just before the RENEW
+  NetDeviceContainer stormNetDevs;
+  for (uint32_t i = 2; i < devNet.GetN (); i++)
+    {
+      stormNetDevs.Add (devNet.Get (i));
+    }
+  ApplicationContainer stormApps = dhcpHelper.InstallDhcpClient (stormNetDevs);
+  stormApps.Start (Seconds (22.5));
+
+  Simulator::Stop (Seconds (25.0));
+
+  Simulator::Run ();
+
+  if (m_queue)
+    {
+      // Four DISCOVERs fit in the queue, the RENEW pushes out one of them
+      NS_TEST_ASSERT_MSG_EQ (m_queueDrops, 7, "Wrong number of messages dropped by the queue");
+      NS_TEST_ASSERT_MSG_EQ (m_rateDrops, 0, "Wrong number of messages dropped by the token bucket");
+    }
+  else
+    {
+      // The bucket refilled to four DISCOVERs since the first client booted
+      NS_TEST_ASSERT_MSG_EQ (m_queueDrops, 0, "Wrong number of messages dropped by the queue");
+      NS_TEST_ASSERT_MSG_EQ (m_rateDrops, 6, "Wrong number of messages dropped by the token bucket");
+    }
+  // The RENEW is answered once the DISCOVER being processed is done
+  NS_TEST_ASSERT_MSG_GT (m_renewAck, Seconds (23), "The RENEW was not answered");
+  NS_TEST_ASSERT_MSG_LT (m_renewAck, Seconds (24), "The RENEW waited behind the DISCOVERs");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP hash allocation: with the Hash AllocationPolicy, a client
+ * gets the same address whatever the order the clients boot in.
+ */
+class DhcpHashAllocationTestCase : public DhcpLeaseRecorderTestCase
+{
+public:
+  DhcpHashAllocationTestCase ();
+  virtual ~DhcpHashAllocationTestCase ();
+private:
+  virtual void DoRun (void);
+  /**
+   * Boot the clients one after the other, and record their addresses.
+   * \param reverse Whether the clients boot last to first.
+   */
+  void RunClients (bool reverse);
+};
+
+DhcpHashAllocationTestCase::DhcpHashAllocationTestCase ()
+  : DhcpLeaseRecorderTestCase ("Dhcp hash allocation test case ", 3)
+{
+}
+
+DhcpHashAllocationTestCase::~DhcpHashAllocationTestCase ()
+{
+}
+
+void
+DhcpHashAllocationTestCase::RunClients (bool reverse)
+{
+  /*Set up devices*/
+  NodeContainer nodes;
+  NodeContainer routers;
+  nodes.Create (3);
+  routers.Create (1);
+
+  NodeContainer net (routers, nodes);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devNet = simpleNetDevice.Install (net);
+
+  // The same hardware addresses in both runs
+  devNet.Get (1)->SetAddress (Mac48Address ("00:00:00:00:00:11"));
+  devNet.Get (2)->SetAddress (Mac48Address ("00:00:00:00:00:22"));
+  devNet.Get (3)->SetAddress (Mac48Address ("00:00:00:00:00:33"));
+
+  InternetStackHelper tcpip;
+  tcpip.Install (routers);
+  tcpip.Install (nodes);
+
+  DhcpHelper dhcpHelper;
+  dhcpHelper.SetServerAttribute ("AllocationPolicy", EnumValue (DhcpServer::ALLOCATE_HASH));
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.200"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (30.0));
+
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      ApplicationContainer dhcpClientApp = dhcpHelper.InstallDhcpClient (devNet.Get (i + 1));
+      dhcpClientApp.Start (Seconds (1.0 + 7.0 * (reverse ? 2 - i : i)));
+      dhcpClientApp.Stop (Seconds (30.0));
+      std::ostringstream context;
+      context << i;
+      dhcpClientApp.Get (0)->TraceConnect ("NewLease", context.str (), MakeCallback (&DhcpHashAllocationTestCase::LeaseObtained, this));
+    }
+
+  Simulator::Stop (Seconds (31.0));
+
+  Simulator::Run ();
+
+  Simulator::Destroy ();
+}
+
+void
+DhcpHashAllocationTestCase::DoRun (void)
+{
+  RunClients (false);
+  Ipv4Address first[3];
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      first[i] = m_leasedAddress[i];
+      m_leasedAddress[i] = Ipv4Address ();
+      NS_TEST_ASSERT_MSG_EQ ((first[i].Get () >= Ipv4Address ("172.30.0.10").Get ()
+                              && first[i].Get () <= Ipv4Address ("172.30.0.200").Get ()), true,
+                             "Client " << i << " got " << first[i]);
+    }
+  // The hash spreads the clients over the pool
+  NS_TEST_ASSERT_MSG_EQ ((first[0] == Ipv4Address ("172.30.0.10") && first[1] == Ipv4Address ("172.30.0.11")), false,
+                         "Addresses allocated lowest first");
+
+  RunClients (true);
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[i], first[i], "Client " << i << " got another address");
+    }
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP hash allocation behind a relay agent picking the servers by
+ * hash: the clients a relay agent sends to one server still spread over
+ * its whole pool.
+ */
+class DhcpHashSpreadTestCase : public TestCase
+{
+public:
+  DhcpHashSpreadTestCase ();
+  virtual ~DhcpHashSpreadTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DhcpHashSpreadTestCase::DhcpHashSpreadTestCase ()
+  : TestCase ("Dhcp hash spread test case ")
+{
+}
+
+DhcpHashSpreadTestCase::~DhcpHashSpreadTestCase ()
+{
+}
+
+void
+DhcpHashSpreadTestCase::DoRun (void)
+{
+  NodeContainer nodes;
+  nodes.Create (2);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  NetDeviceContainer devNet = simpleNetDevice.Install (nodes);
+
+  InternetStackHelper tcpip;
+  tcpip.Install (nodes);
+
+  // A pool of 64 addresses
+  DhcpHelper dhcpHelper;
+  dhcpHelper.SetServerAttribute ("AllocationPolicy", EnumValue (DhcpServer::ALLOCATE_HASH));
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.73"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (10.0));
+
+  // The clients a relay agent with four servers sends to the first one
+  DhcpRawClient raw (devNet.Get (1));
+  std::vector<uint8_t> clients;
+  for (uint32_t c = 1; c < 256 && clients.size () < 8; c++)
+    {
+      uint8_t chaddr[16] = { 0, 0, 0, 0, 0, (uint8_t) c, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+      if (DhcpLeaseTable::Hash (chaddr) % 4 == 0)
+        {
+          clients.push_back (c);
+          Simulator::Schedule (Seconds (1.0 + 0.1 * clients.size ()), &DhcpRawClient::Send, &raw, (uint8_t) c,
+                               (uint8_t) DhcpHeader::DHCPDISCOVER, Ipv4Address::GetAny (), Ipv4Address::GetAny ());
+        }
+    }
+
+  Simulator::Stop (Seconds (11.0));
+
+  Simulator::Run ();
+
+  uint32_t nOffsets[4] = { 0, 0, 0, 0 };
+  for (uint32_t i = 0; i < clients.size (); i++)
+    {
+      Ipv4Address offered = raw.GetReply (clients[i], DhcpHeader::DHCPOFFER);
+      NS_TEST_ASSERT_MSG_NE (offered, Ipv4Address::GetAny (), "Client " << (uint32_t) clients[i] << " got no offer");
+      nOffsets[(offered.Get () - Ipv4Address ("172.30.0.10").Get ()) % 4]++;
+    }
+  NS_TEST_ASSERT_MSG_NE (nOffsets[0], clients.size (), "The offers follow the server selection of the relay agent");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP lease file: the leases saved by a server when it stops are
+ * restored by the server of the next run.
+ */
+class DhcpLeaseFileTestCase : public DhcpLeaseRecorderTestCase
+{
+public:
+  DhcpLeaseFileTestCase ();
+  virtual ~DhcpLeaseFileTestCase ();
+private:
+  virtual void DoRun (void);
+  /**
+   * Boot clients one after the other, and record their addresses.
+   * \param macs The hardware addresses of the clients, in boot order.
+   * \param leaseFile The lease file of the server.
+   */
+  void RunClients (const std::vector<Mac48Address> &macs, std::string leaseFile);
+};
+
+DhcpLeaseFileTestCase::DhcpLeaseFileTestCase ()
+  : DhcpLeaseRecorderTestCase ("Dhcp lease file test case ", 2)
+{
+}
+
+DhcpLeaseFileTestCase::~DhcpLeaseFileTestCase ()
+{
+}
+
+void
+DhcpLeaseFileTestCase::RunClients (const std::vector<Mac48Address> &macs, std::string leaseFile)
+{
+  /*Set up devices*/
+  NodeContainer nodes;
+  NodeContainer routers;
+  nodes.Create (macs.size ());
+  routers.Create (1);
+
+  NodeContainer net (routers, nodes);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devNet = simpleNetDevice.Install (net);
+
+  InternetStackHelper tcpip;
+  tcpip.Install (routers);
+  tcpip.Install (nodes);
+
+  // The leases outlast the first run
+  DhcpHelper dhcpHelper;
+  dhcpHelper.SetServerAttribute ("LeaseTime", TimeValue (Seconds (60)));
+  dhcpHelper.SetServerAttribute ("LeaseFile", StringValue (leaseFile));
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (20.0));
+
+  for (uint32_t i = 0; i < macs.size (); i++)
+    {
+      devNet.Get (i + 1)->SetAddress (macs[i]);
+      ApplicationContainer dhcpClientApp = dhcpHelper.InstallDhcpClient (devNet.Get (i + 1));
+      dhcpClientApp.Start (Seconds (1.0 + 7.0 * i));
+      dhcpClientApp.Stop (Seconds (20.0));
+      std::ostringstream context;
+      context << i;
+      dhcpClientApp.Get (0)->TraceConnect ("NewLease", context.str (), MakeCallback (&DhcpLeaseFileTestCase::LeaseObtained, this));
+    }
+
+  Simulator::Stop (Seconds (21.0));
+
+  Simulator::Run ();
+
+  Simulator::Destroy ();
+}
+
+void
+DhcpLeaseFileTestCase::DoRun (void)
+{
+  std::string leaseFile = CreateTempDirFilename ("dhcp-leases.bin");
+  std::remove (leaseFile.c_str ());
+
+  std::vector<Mac48Address> macs;
+  macs.push_back (Mac48Address ("00:00:00:00:00:11"));
+  macs.push_back (Mac48Address ("00:00:00:00:00:22"));
+  RunClients (macs, leaseFile);
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[0], Ipv4Address ("172.30.0.10"), "Wrong address in the first run");
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[1], Ipv4Address ("172.30.0.11"), "Wrong address in the first run");
+
+  // A new client boots first: the addresses of the first run are still leased
+  macs[0] = Mac48Address ("00:00:00:00:00:33");
+  m_leasedAddress[0] = Ipv4Address ();
+  m_leasedAddress[1] = Ipv4Address ();
+  RunClients (macs, leaseFile);
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[0], Ipv4Address ("172.30.0.12"), "Restored lease given to a new client");
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[1], Ipv4Address ("172.30.0.11"), "Restored lease not given back to its client");
+
+  // A header announcing more records than the file holds: the product of
+  // the count by the record size wraps to 0 in 32 bits
+  uint8_t header[16] = { 'N', 'S', '3', 'D', 'H', 'C', 'P', 'L', 0, 0, 0, 1, 0x08, 0, 0, 0 };
+  std::ofstream corrupt (leaseFile.c_str (), std::ios::binary | std::ios::trunc);
+  corrupt.write (reinterpret_cast<const char *> (header), sizeof (header));
+  corrupt.close ();
+  m_leasedAddress[0] = Ipv4Address ();
+  m_leasedAddress[1] = Ipv4Address ();
+  RunClients (macs, leaseFile);
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[0], Ipv4Address ("172.30.0.10"), "Lease restored from a truncated file");
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress[1], Ipv4Address ("172.30.0.11"), "Lease restored from a truncated file");
+
+  std::remove (leaseFile.c_str ());
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief SimpleNetDevice whose link can be brought down and up
+ */
+class DhcpFlappingNetDevice : public SimpleNetDevice
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  DhcpFlappingNetDevice ();
+  /**
+   * Change the link state and notify the listeners.
+   * \param up Whether the link is up.
+   */
+  void SetLinkUp (bool up);
+  virtual bool IsLinkUp (void) const;
+  virtual void AddLinkChangeCallback (Callback<void> callback);
+private:
+  bool m_linkUp;                       //!< Link state
+  TracedCallback<> m_linkChangeCallbacks; //!< Link change listeners
+};
+
+TypeId
+DhcpFlappingNetDevice::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DhcpFlappingNetDevice")
+    .SetParent<SimpleNetDevice> ()
+    .SetGroupName ("Internet-Apps")
+    .AddConstructor<DhcpFlappingNetDevice> ()
+  ;
+  return tid;
+}
+
+DhcpFlappingNetDevice::DhcpFlappingNetDevice ()
+  : m_linkUp (true)
+{
+}
+
+void
+DhcpFlappingNetDevice::SetLinkUp (bool up)
+{
+  m_linkUp = up;
+  m_linkChangeCallbacks ();
+}
+
+bool
+DhcpFlappingNetDevice::IsLinkUp (void) const
+{
+  return m_linkUp;
+}
+
+void
+DhcpFlappingNetDevice::AddLinkChangeCallback (Callback<void> callback)
+{
+  m_linkChangeCallbacks.ConnectWithoutContext (callback);
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP INIT-REBOOT: after a link flap, the client asks for its
+ * last address again. A server of another network refuses it, and the
+ * client falls back to a DISCOVER right away; a server without the lease
+ * does not answer, and the client falls back to a DISCOVER after RebootTimeout.
+ */
+class DhcpInitRebootTestCase : public TestCase
+{
+public:
+  /// Server answering after the flap
+  enum Variant
+  {
+    SAME_SERVER,                   //!< The server of the lease
+    NO_BINDING,                    //!< A server of the same network, without the lease
+    WRONG_NETWORK                  //!< A server of another network
+  };
+  /**
+   * Constructor
+   * \param variant The server answering after the flap.
+   * \param name The name of the variant.
+   */
+  DhcpInitRebootTestCase (Variant variant, std::string name);
+  virtual ~DhcpInitRebootTestCase ();
+  /**
+   * Triggered by an address lease on the client.
+   * \param newAddress The leased address.
+   */
+  void LeaseObtained (const Ipv4Address& newAddress);
+private:
+  virtual void DoRun (void);
+  Variant m_variant;               //!< The server answering after the flap
+  std::vector<Ipv4Address> m_addresses; //!< Addresses leased to the client
+  std::vector<Time> m_times;       //!< Times of the leases
+};
+
+DhcpInitRebootTestCase::DhcpInitRebootTestCase (Variant variant, std::string name)
+  : TestCase ("Dhcp init-reboot test case, " + name + " "),
+    m_variant (variant)
+{
+}
+
+DhcpInitRebootTestCase::~DhcpInitRebootTestCase ()
+{
+}
+
+void
+DhcpInitRebootTestCase::LeaseObtained (const Ipv4Address& newAddress)
+{
+  m_addresses.push_back (newAddress);
+  m_times.push_back (Simulator::Now ());
+}
+
+void
+DhcpInitRebootTestCase::DoRun (void)
+{
+  /*Set up devices: two servers and a client whose link flaps*/
+  NodeContainer routers;
+  routers.Create (2);
+  Ptr<Node> client = CreateObject<Node> ();
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devNet = simpleNetDevice.Install (routers);
+
+  Ptr<DhcpFlappingNetDevice> device = CreateObject<DhcpFlappingNetDevice> ();
+  device->SetAddress (Mac48Address::Allocate ());
+  client->AddDevice (device);
+  device->SetChannel (DynamicCast<SimpleChannel> (devNet.Get (0)->GetChannel ()));
+  device->SetQueue (CreateObject<DropTailQueue> ());
+
+  InternetStackHelper tcpip;
+  tcpip.Install (routers);
+  tcpip.Install (client);
+
+  // The first server leases the address; unless it is the one answering
+  // after the flap, it stops before the flap and the second server, which
+  // knows nothing of the lease, starts. Its pool range holds the address
+  // of the lease, or is on another network.
+  bool sameServer = (m_variant == SAME_SERVER);
+  DhcpHelper dhcpHelper;
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
+  dhcpServerApp.Start (Seconds (0.0));
+  dhcpServerApp.Stop (Seconds (sameServer ? 30.0 : 10.5));
+
+  ApplicationContainer otherServerApp;
+  if (m_variant == WRONG_NETWORK)
+    {
+      otherServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (1), Ipv4Address ("10.1.0.2"), Ipv4Mask ("/24"));
+      dhcpHelper.AddAddressPool (&otherServerApp, Ipv4Address ("10.1.0.0"), Ipv4Mask ("/24"), Ipv4Address ("10.1.0.100"),
+                                 Ipv4Address ("10.1.0.105"));
+    }
+  else
+    {
+      otherServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (1), Ipv4Address ("172.30.0.2"), Ipv4Mask ("/24"));
+      dhcpHelper.AddAddressPool (&otherServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                                 Ipv4Address ("172.30.0.20"));
+    }
+  otherServerApp.Start (Seconds (sameServer ? 30.0 : 10.6));
+
+  // The first offer is taken, a DISCOVER leases an address in a round trip
+  dhcpHelper.SetClientAttribute ("MaxOffers", UintegerValue (1));
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (device);
+  dhcpClientApps.Start (Seconds (1.0));
+  dhcpClientApps.Stop (Seconds (30.0));
+  dhcpClientApps.Get (0)->TraceConnectWithoutContext ("NewLease", MakeCallback (&DhcpInitRebootTestCase::LeaseObtained, this));
+
+  Simulator::Schedule (Seconds (10.0), &DhcpFlappingNetDevice::SetLinkUp, device, false);
+  Simulator::Schedule (Seconds (11.0), &DhcpFlappingNetDevice::SetLinkUp, device, true);
+
+  Simulator::Stop (Seconds (31.0));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_addresses.size (), 2, "Wrong number of leases");
+  NS_TEST_ASSERT_MSG_EQ (m_addresses[0], Ipv4Address ("172.30.0.10"), "Wrong first lease");
+  if (m_variant == SAME_SERVER)
+    {
+      // One round trip after the link comes back up
+      NS_TEST_ASSERT_MSG_EQ (m_addresses[1], Ipv4Address ("172.30.0.10"), "Last address not leased again");
+      NS_TEST_ASSERT_MSG_LT (m_times[1], Seconds (11.1), "Last address not asked for again");
+    }
+  else if (m_variant == NO_BINDING)
+    {
+      // No NACK: RebootTimeout, then a DISCOVER
+      NS_TEST_ASSERT_MSG_GT (m_times[1], Seconds (13.0), "INIT-REBOOT answered by a server without the lease");
+      NS_TEST_ASSERT_MSG_LT (m_times[1], Seconds (13.1), "No fall back to a DISCOVER");
+    }
+  else
+    {
+      // A NACK, then a DISCOVER
+      NS_TEST_ASSERT_MSG_EQ (m_addresses[1], Ipv4Address ("10.1.0.100"), "No fall back to a DISCOVER");
+      NS_TEST_ASSERT_MSG_LT (m_times[1], Seconds (11.2), "INIT-REBOOT on the wrong network not refused");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP client retransmissions: without server, the DISCOVER is
+ * sent again after 4, 8, 16, 32 and then every 64 s, give or take the jitter.
+ */
+class DhcpBackoffTestCase : public TestCase
+{
+public:
+  /**
+   * Constructor
+   * \param jitter Whether the default jitter is used (otherwise none).
+   * \param name The name of the variant.
+   */
+  DhcpBackoffTestCase (bool jitter, std::string name);
+  virtual ~DhcpBackoffTestCase ();
+  /**
+   * Triggered by a retransmission of a client.
+   * \param context The client index.
+   * \param oldValue The previous number of retransmissions.
+   * \param newValue The new number of retransmissions.
+   */
+  void Retransmitted (std::string context, uint32_t oldValue, uint32_t newValue);
+private:
+  virtual void DoRun (void);
+  bool m_jitter;                              //!< Whether the default jitter is used
+  std::vector<std::vector<Time> > m_times;    //!< Retransmission times of each client
+};
+
+DhcpBackoffTestCase::DhcpBackoffTestCase (bool jitter, std::string name)
+  : TestCase ("Dhcp backoff test case, " + name + " "),
+    m_jitter (jitter)
+{
+}
+
+DhcpBackoffTestCase::~DhcpBackoffTestCase ()
+{
+}
+
+void
+DhcpBackoffTestCase::Retransmitted (std::string context, uint32_t oldValue, uint32_t newValue)
+{
+  m_times[std::stoi (context, nullptr, 10)].push_back (Simulator::Now ());
+}
+
+void
+DhcpBackoffTestCase::DoRun (void)
+{
+  /*Set up devices: clients booting together, without server*/
+  NodeContainer nodes;
+  nodes.Create (m_jitter ? 10 : 1);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devNet = simpleNetDevice.Install (nodes);
+
+  InternetStackHelper tcpip;
+  tcpip.Install (nodes);
+
+  DhcpHelper dhcpHelper;
+  dhcpHelper.SetClientAttribute ("StartDelay", StringValue ("ns3::ConstantRandomVariable[Constant=2.0]"));
+  if (!m_jitter)
+    {
+      dhcpHelper.SetClientAttribute ("RtrsJitter", StringValue ("ns3::ConstantRandomVariable[Constant=0.0]"));
+    }
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (devNet);
+  dhcpClientApps.Start (Seconds (1.0));
+  dhcpClientApps.Stop (Seconds (200.0));
+  m_times.resize (dhcpClientApps.GetN ());
+  for (uint32_t i = 0; i < dhcpClientApps.GetN (); i++)
+    {
+      std::ostringstream context;
+      context << i;
+      dhcpClientApps.Get (i)->TraceConnect ("Retransmissions", context.str (), MakeCallback (&DhcpBackoffTestCase::Retransmitted, this));
+    }
+
+  Simulator::Stop (Seconds (201.0));
+
+  Simulator::Run ();
+
+  // First DISCOVER at 3 s (1 s + StartDelay), then 7, 15, 31, 63, 127 and 191 s
+  const double expected[] = { 4, 8, 16, 32, 64, 64 };
+  double maxError = m_jitter ? 1.0 : 0.0;
+  std::set<int64_t> lastTimes;
+  for (uint32_t i = 0; i < m_times.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_times[i].size (), 6, "Wrong number of retransmissions of client " << i);
+      Time previous = Seconds (3.0);
+      for (uint32_t j = 0; j < m_times[i].size (); j++)
+        {
+          double interval = (m_times[i][j] - previous).GetSeconds ();
+          NS_TEST_ASSERT_MSG_EQ_TOL (interval, expected[j], maxError + 1e-9,
+                                     "Wrong delay before retransmission " << j << " of client " << i);
+          previous = m_times[i][j];
+        }
+      lastTimes.insert (previous.GetNanoSeconds ());
+    }
+  if (m_jitter)
+    {
+      NS_TEST_ASSERT_MSG_EQ (lastTimes.size (), m_times.size (), "Clients still synchronized");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP offer selection: with two servers, the client selects an
+ * offer at the end of the collection, or as soon as the offers it waits
+ * for have come, according to its scoring.
+ */
+class DhcpOfferSelectionTestCase : public TestCase
+{
+public:
+  /**
+   * Constructor
+   * \param maxOffers The MaxOffers of the client.
+   * \param scoring The OfferScoring of the client.
+   * \param expected The address expected, 0.0.0.0 if any.
+   * \param name The name of the variant.
+   */
+  DhcpOfferSelectionTestCase (uint32_t maxOffers, DhcpClient::OfferScoring scoring,
+                              Ipv4Address expected, std::string name);
+  virtual ~DhcpOfferSelectionTestCase ();
+  /**
+   * Triggered by an address lease on the client.
+   * \param newAddress The leased address.
+   */
+  void LeaseObtained (const Ipv4Address& newAddress);
+private:
+  virtual void DoRun (void);
+  uint32_t m_maxOffers;                 //!< MaxOffers of the client
+  DhcpClient::OfferScoring m_scoring;   //!< OfferScoring of the client
+  Ipv4Address m_expected;               //!< Address expected, 0.0.0.0 if any
+  Ipv4Address m_leasedAddress;          //!< Address given to the client
+  Time m_leaseTime;                     //!< Time of the lease
+};
+
+DhcpOfferSelectionTestCase::DhcpOfferSelectionTestCase (uint32_t maxOffers, DhcpClient::OfferScoring scoring,
+                                                        Ipv4Address expected, std::string name)
+  : TestCase ("Dhcp offer selection test case, " + name + " "),
+    m_maxOffers (maxOffers),
+    m_scoring (scoring),
+    m_expected (expected)
+{
+}
+
+DhcpOfferSelectionTestCase::~DhcpOfferSelectionTestCase ()
+{
+}
+
+void
+DhcpOfferSelectionTestCase::LeaseObtained (const Ipv4Address& newAddress)
+{
+  m_leasedAddress = newAddress;
+  m_leaseTime = Simulator::Now ();
+}
+
+void
+DhcpOfferSelectionTestCase::DoRun (void)
+{
+  /*Set up devices: two servers and a client*/
+  NodeContainer routers;
+  routers.Create (2);
+  Ptr<Node> client = CreateObject<Node> ();
+
+  NodeContainer net (routers, client);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devNet = simpleNetDevice.Install (net);
+
+  InternetStackHelper tcpip;
+  tcpip.Install (routers);
+  tcpip.Install (client);
+
+  // The second server gives longer leases
+  DhcpHelper dhcpHelper;
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
+  dhcpHelper.SetServerAttribute ("LeaseTime", TimeValue (Seconds (60)));
+  ApplicationContainer otherServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (1), Ipv4Address ("172.30.0.2"),
+                                                                      Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&otherServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.100"),
+                             Ipv4Address ("172.30.0.105"));
+  dhcpServerApp.Start (Seconds (0.0));
+  otherServerApp.Start (Seconds (0.0));
+
+  dhcpHelper.SetClientAttribute ("MaxOffers", UintegerValue (m_maxOffers));
+  dhcpHelper.SetClientAttribute ("OfferScoring", EnumValue (m_scoring));
+  dhcpHelper.SetClientAttribute ("PreferredServer", Ipv4AddressValue (Ipv4Address ("172.30.0.1")));
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (devNet.Get (2));
+  dhcpClientApps.Start (Seconds (1.0));
+  dhcpClientApps.Get (0)->TraceConnectWithoutContext ("NewLease", MakeCallback (&DhcpOfferSelectionTestCase::LeaseObtained, this));
+
+  Simulator::Stop (Seconds (10.0));
+
+  Simulator::Run ();
+
+  if (m_expected != Ipv4Address::GetAny ())
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_leasedAddress, m_expected, "Wrong offer selected");
+    }
+  if (m_maxOffers == 0 && m_scoring != DhcpClient::SCORE_PREFERRED_SERVER)
+    {
+      // The offers are collected for 5 s
+      NS_TEST_ASSERT_MSG_GT (m_leaseTime, Seconds (6.0), "Offer selected before the end of the collection");
+    }
+  else
+    {
+      NS_TEST_ASSERT_MSG_LT (m_leaseTime, Seconds (1.1), "Offer not selected right away");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP client requesting the second best offer when the server of
+ * the best one does not answer the REQUEST
+ */
+class DhcpSecondOfferTestCase : public TestCase
+{
+public:
+  DhcpSecondOfferTestCase ();
+  virtual ~DhcpSecondOfferTestCase ();
+  /**
+   * Triggered by an address lease on the client.
+   * \param newAddress The leased address.
+   */
+  void LeaseObtained (const Ipv4Address& newAddress);
+private:
+  virtual void DoRun (void);
+  Ipv4Address m_leasedAddress;          //!< Address given to the client
+  Time m_leaseTime;                     //!< Time of the lease
+};
+
+DhcpSecondOfferTestCase::DhcpSecondOfferTestCase ()
+  : TestCase ("Dhcp second offer test case ")
+{
+}
+
+DhcpSecondOfferTestCase::~DhcpSecondOfferTestCase ()
+{
+}
+
+void
+DhcpSecondOfferTestCase::LeaseObtained (const Ipv4Address& newAddress)
+{
+  m_leasedAddress = newAddress;
+  m_leaseTime = Simulator::Now ();
+}
+
+void
+DhcpSecondOfferTestCase::DoRun (void)
+{
+  /*Set up devices: two servers and a client*/
+  NodeContainer routers;
+  routers.Create (2);
+  Ptr<Node> client = CreateObject<Node> ();
+
+  NodeContainer net (routers, client);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devNet = simpleNetDevice.Install (net);
+
+  InternetStackHelper tcpip;
+  tcpip.Install (routers);
+  tcpip.Install (client);
+
+  // The second server gives the best offer, and stops before the REQUEST
+  DhcpHelper dhcpHelper;
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
+  dhcpHelper.SetServerAttribute ("LeaseTime", TimeValue (Seconds (60)));
+  ApplicationContainer otherServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (1), Ipv4Address ("172.30.0.2"),
+                                                                      Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&otherServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.100"),
+                             Ipv4Address ("172.30.0.105"));
+  dhcpServerApp.Start (Seconds (0.0));
+  otherServerApp.Start (Seconds (0.0));
+  otherServerApp.Stop (Seconds (3.0));
+
+  // Offers collected until 6 s, the second best is requested at 16 s
+  dhcpHelper.SetClientAttribute ("OfferScoring", EnumValue (DhcpClient::SCORE_LONGEST_LEASE));
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (devNet.Get (2));
+  dhcpClientApps.Start (Seconds (1.0));
+  dhcpClientApps.Get (0)->TraceConnectWithoutContext ("NewLease", MakeCallback (&DhcpSecondOfferTestCase::LeaseObtained, this));
+
+  Simulator::Stop (Seconds (30.0));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_leasedAddress, Ipv4Address ("172.30.0.10"), "Wrong offer requested");
+  // A new DISCOVER would have collected the offers again until 21 s
+  NS_TEST_ASSERT_MSG_LT (m_leaseTime, Seconds (16.1), "Second offer not requested");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief Error model of a server device counting the lease renewals it
+ * receives, and dropping the unicast ones if asked to
+ */
+class DhcpRenewalErrorModel : public ErrorModel
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  DhcpRenewalErrorModel ();
+  /**
+   * Set whether the unicast renewals are dropped.
+   * \param drop Whether the unicast renewals are dropped.
+   */
+  void SetDropUnicast (bool drop);
+  /**
+   * \return The number of unicast renewals received
+   */
+  uint32_t GetUnicast (void) const;
+  /**
+   * \return The number of broadcast renewals received
+   */
+  uint32_t GetBroadcast (void) const;
+  /**
+   * \return The number of renewals received with a Requested Address option
+   */
+  uint32_t GetWithRequestedAddress (void) const;
+private:
+  virtual bool DoCorrupt (Ptr<Packet> p);
+  virtual void DoReset (void);
+  bool m_dropUnicast;   //!< Whether the unicast renewals are dropped
+  uint32_t m_unicast;   //!< Number of unicast renewals received
+  uint32_t m_broadcast; //!< Number of broadcast renewals received
+  uint32_t m_withRequestedAddress; //!< Number of renewals received with option 50
+};
+
+TypeId
+DhcpRenewalErrorModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DhcpRenewalErrorModel")
+    .SetParent<ErrorModel> ()
+    .SetGroupName ("Internet-Apps")
+    .AddConstructor<DhcpRenewalErrorModel> ()
+  ;
+  return tid;
+}
+
+DhcpRenewalErrorModel::DhcpRenewalErrorModel ()
+  : m_dropUnicast (false),
+    m_unicast (0),
+    m_broadcast (0),
+    m_withRequestedAddress (0)
+{
+}
+
+void
+DhcpRenewalErrorModel::SetDropUnicast (bool drop)
+{
+  m_dropUnicast = drop;
+}
+
+uint32_t
+DhcpRenewalErrorModel::GetUnicast (void) const
+{
+  return m_unicast;
+}
+
+uint32_t
+DhcpRenewalErrorModel::GetBroadcast (void) const
+{
+  return m_broadcast;
+}
+
+uint32_t
+DhcpRenewalErrorModel::GetWithRequestedAddress (void) const
+{
+  return m_withRequestedAddress;
+}
+
+bool
+DhcpRenewalErrorModel::DoCorrupt (Ptr<Packet> p)
+{
+  // ARP packets are shorter than a DHCP message
+  if (p->GetSize () < DhcpHeader::OFFSET_OPTIONS)
+    {
+      return false;
+    }
+  Ptr<Packet> copy = p->Copy ();
+  Ipv4Header ipHeader;
+  UdpHeader udpHeader;
+  copy->RemoveHeader (ipHeader);
+  if (ipHeader.GetProtocol () != UdpL4Protocol::PROT_NUMBER || copy->RemoveHeader (udpHeader) == 0)
+    {
+      return false;
+    }
+  DhcpHeaderView header (copy);
+  if (!header.IsValid () || header.GetType () != DhcpHeader::DHCPREQ
+      || header.GetCiaddr () == Ipv4Address::GetAny ())
+    {
+      return false;
+    }
+  uint8_t option[257];
+  if (header.CopyOption (DhcpHeader::OP_ADDREQ, option) != 0)
+    {
+      m_withRequestedAddress++;
+    }
+  if (ipHeader.GetDestination ().IsBroadcast ())
+    {
+      m_broadcast++;
+      return false;
+    }
+  m_unicast++;
+  return m_dropUnicast;
+}
+
+void
+DhcpRenewalErrorModel::DoReset (void)
+{
+  m_unicast = 0;
+  m_broadcast = 0;
+  m_withRequestedAddress = 0;
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP renewal: the client renews its lease by unicast with its
+ * server at T1, and by broadcast with any server at T2 if its server
+ * does not answer.
+ */
+class DhcpRenewTestCase : public TestCase
+{
+public:
+  /**
+   * Constructor
+   * \param answered Whether the server receives the unicast renewals.
+   * \param name The name of the variant.
+   */
+  DhcpRenewTestCase (bool answered, std::string name);
+  virtual ~DhcpRenewTestCase ();
+  /**
+   * Triggered by the expiry of a lease on the client.
+   * \param oldAddress The address of the lease.
+   */
+  void LeaseExpired (const Ipv4Address& oldAddress);
+private:
+  virtual void DoRun (void);
+  bool m_answered;      //!< Whether the server receives the unicast renewals
+  bool m_expired;       //!< Whether the lease of the client expired
+};
+
+DhcpRenewTestCase::DhcpRenewTestCase (bool answered, std::string name)
+  : TestCase ("Dhcp renew test case, " + name + " "),
+    m_answered (answered),
+    m_expired (false)
+{
+}
+
+DhcpRenewTestCase::~DhcpRenewTestCase ()
+{
+}
+
+void
+DhcpRenewTestCase::LeaseExpired (const Ipv4Address& oldAddress)
+{
+  m_expired = true;
+}
+
+void
+DhcpRenewTestCase::DoRun (void)
+{
+  /*Set up devices: a server and a client*/
+  NodeContainer net;
+  net.Create (2);
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("5Mbps")));
+  NetDeviceContainer devNet = simpleNetDevice.Install (net);
+
+  Ptr<DhcpRenewalErrorModel> errorModel = CreateObject<DhcpRenewalErrorModel> ();
+  errorModel->SetDropUnicast (!m_answered);
+  DynamicCast<SimpleNetDevice> (devNet.Get (0))->SetReceiveErrorModel (errorModel);
+
+  InternetStackHelper tcpip;
+  tcpip.Install (net);
+
+  // Lease of 30 s, T1 at 15 s and T2 at 25 s
+  DhcpHelper dhcpHelper;
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devNet.Get (0), Ipv4Address ("172.30.0.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/24"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address ("172.30.0.15"));
+  dhcpServerApp.Start (Seconds (0.0));
+
+  dhcpHelper.SetClientAttribute ("MaxOffers", UintegerValue (1));
+  ApplicationContainer dhcpClientApps = dhcpHelper.InstallDhcpClient (devNet.Get (1));
+  dhcpClientApps.Start (Seconds (1.0));
+  dhcpClientApps.Get (0)->TraceConnectWithoutContext ("ExpireLease", MakeCallback (&DhcpRenewTestCase::LeaseExpired, this));
+
+  Simulator::Stop (Seconds (40.0));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_expired, false, "Lease not renewed");
+  NS_TEST_ASSERT_MSG_EQ (errorModel->GetWithRequestedAddress (), 0, "Renewal with a Requested Address option");
+  if (m_answered)
+    {
+      // Renewed at 16 s and 31 s
+      NS_TEST_ASSERT_MSG_EQ (errorModel->GetUnicast (), 2, "Wrong number of unicast renewals");
+      NS_TEST_ASSERT_MSG_EQ (errorModel->GetBroadcast (), 0, "Renewal broadcast");
+    }
+  else
+    {
+      // Unanswered at 16 s and 21 s, rebound at 26 s
+      NS_TEST_ASSERT_MSG_EQ (errorModel->GetUnicast (), 2, "Wrong number of unicast renewals");
+      NS_TEST_ASSERT_MSG_EQ (errorModel->GetBroadcast (), 1, "Wrong number of broadcast renewals");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP load generator: clients emulated behind one socket get
+ * their leases through a relay agent, and keep them across renewals.
+ */
+class DhcpLoadGeneratorTestCase : public TestCase
+{
+public:
+  /**
+   * Constructor
+   * \param nClients The number of clients emulated.
+   * \param poolSize The number of addresses of the server.
+   * \param rebindTime The RebindTime of the server.
+   * \param name The name of the variant.
+   */
+  DhcpLoadGeneratorTestCase (uint32_t nClients, uint32_t poolSize, Time rebindTime, std::string name);
+  virtual ~DhcpLoadGeneratorTestCase ();
+  /**
+   * Triggered by an address lease of a client.
+   * \param newAddress The leased address.
+   */
+  void LeaseObtained (const Ipv4Address& newAddress);
+  /**
+   * Triggered by the expiry of a lease of a client.
+   * \param oldAddress The address of the lease.
+   */
+  void LeaseExpired (const Ipv4Address& oldAddress);
+private:
+  virtual void DoRun (void);
+  uint32_t m_nClients;                  //!< Number of clients emulated
+  uint32_t m_poolSize;                  //!< Number of addresses of the server
+  Time m_rebindTime;                    //!< RebindTime of the server
+  std::set<Ipv4Address> m_leased;       //!< Addresses leased
+  uint32_t m_nLeases;                   //!< Number of leases obtained
+  uint32_t m_nExpired;                  //!< Number of leases expired
+};
+
+DhcpLoadGeneratorTestCase::DhcpLoadGeneratorTestCase (uint32_t nClients, uint32_t poolSize, Time rebindTime,
+                                                      std::string name)
+  : TestCase ("Dhcp load generator test case, " + name + " "),
+    m_nClients (nClients),
+    m_poolSize (poolSize),
+    m_rebindTime (rebindTime),
+    m_nLeases (0),
+    m_nExpired (0)
+{
+}
+
+DhcpLoadGeneratorTestCase::~DhcpLoadGeneratorTestCase ()
+{
+}
+
+void
+DhcpLoadGeneratorTestCase::LeaseObtained (const Ipv4Address& newAddress)
+{
+  m_leased.insert (newAddress);
+  m_nLeases++;
+}
+
+void
+DhcpLoadGeneratorTestCase::LeaseExpired (const Ipv4Address& oldAddress)
+{
+  m_nExpired++;
+}
+
+void
+DhcpLoadGeneratorTestCase::DoRun (void)
+{
+  /*Set up devices: a server, a relay and the emulated clients behind the relay*/
+  Ptr<Node> server = CreateObject<Node> ();
+  Ptr<Node> relay = CreateObject<Node> ();
+  Ptr<Node> clients = CreateObject<Node> ();
+
+  SimpleNetDeviceHelper simpleNetDevice;
+  simpleNetDevice.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  simpleNetDevice.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("100Mbps")));
+  NetDeviceContainer devServer = simpleNetDevice.Install (NodeContainer (server, relay));
+  NetDeviceContainer devNet = simpleNetDevice.Install (NodeContainer (relay, clients));
+
+  InternetStackHelper tcpip;
+  tcpip.Install (server);
+  tcpip.Install (relay);
+  tcpip.Install (clients);
+
+  // Lease of 30 s, renewed at 15 s
+  DhcpHelper dhcpHelper;
+  dhcpHelper.SetServerAttribute ("RebindTime", TimeValue (m_rebindTime));
+  ApplicationContainer dhcpServerApp = dhcpHelper.InstallDhcpServer (devServer.Get (0), Ipv4Address ("172.30.2.1"),
+                                                                     Ipv4Mask ("/24"));
+  dhcpHelper.AddAddressPool (&dhcpServerApp, Ipv4Address ("172.30.0.0"), Ipv4Mask ("/16"), Ipv4Address ("172.30.0.10"),
+                             Ipv4Address (Ipv4Address ("172.30.0.10").Get () + m_poolSize - 1));
+  dhcpServerApp.Start (Seconds (0.0));
+
+  ApplicationContainer dhcpRelayApp = dhcpHelper.InstallDhcpRelay (devServer.Get (1), Ipv4Address ("172.30.2.2"),
+                                                                   Ipv4Mask ("/24"), Ipv4Address ("172.30.2.1"));
+  dhcpHelper.AddRelayInterface (&dhcpRelayApp, devNet.Get (0), Ipv4Address ("172.30.0.1"), Ipv4Mask ("/16"));
+  dhcpRelayApp.Start (Seconds (0.0));
+
+  dhcpHelper.SetLoadGeneratorAttribute ("RtrsJitter", StringValue ("ns3::ConstantRandomVariable[Constant=0.0]"));
+  ApplicationContainer generatorApp = dhcpHelper.InstallDhcpLoadGenerator (devNet.Get (1), m_nClients);
+  generatorApp.Start (Seconds (1.0));
+  generatorApp.Get (0)->TraceConnectWithoutContext ("NewLease", MakeCallback (&DhcpLoadGeneratorTestCase::LeaseObtained, this));
+  generatorApp.Get (0)->TraceConnectWithoutContext ("ExpireLease", MakeCallback (&DhcpLoadGeneratorTestCase::LeaseExpired, this));
+
+  Simulator::Stop (Seconds (40.0));
+
+  Simulator::Run ();
+
+  Ptr<DhcpLoadGenerator> generator = DynamicCast<DhcpLoadGenerator> (generatorApp.Get (0));
+  uint32_t nBound = std::min (m_nClients, m_poolSize);
+  NS_TEST_ASSERT_MSG_EQ (generator->GetNBound (), nBound, "Wrong number of clients holding a lease");
+  NS_TEST_ASSERT_MSG_EQ (m_nLeases, nBound, "Wrong number of leases obtained");
+  NS_TEST_ASSERT_MSG_EQ (m_leased.size (), nBound, "Address leased twice");
+  NS_TEST_ASSERT_MSG_EQ (m_nExpired, 0, "Lease not renewed");
+  std::set<Ipv4Address> addresses;
+  for (uint32_t i = 0; i < m_nClients; i++)
+    {
+      if (generator->GetAddress (i) != Ipv4Address::GetAny ())
+        {
+          addresses.insert (generator->GetAddress (i));
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (addresses.size (), nBound, "Wrong addresses of the clients");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP header view tests: the fields read in place match the header
+ */
+class DhcpHeaderViewTestCase : public TestCase
+{
+public:
+  DhcpHeaderViewTestCase ();
+  virtual ~DhcpHeaderViewTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DhcpHeaderViewTestCase::DhcpHeaderViewTestCase ()
+  : TestCase ("Dhcp header view test case ")
+{
+}
+
+DhcpHeaderViewTestCase::~DhcpHeaderViewTestCase ()
+{
+}
+
+void
+DhcpHeaderViewTestCase::DoRun (void)
+{
+  uint8_t chaddr[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+  DhcpHeader header;
+  header.ResetOpt ();
+  header.SetType (DhcpHeader::DHCPOFFER);
+  header.SetTran (0x12345678);
+  header.SetChaddr (chaddr, 16);
+  header.SetYiaddr (Ipv4Address ("172.30.0.10"));
+  header.SetGiAddr (Ipv4Address ("172.30.1.1"));
+  header.SetDhcps (Ipv4Address ("172.30.0.1"));
+  header.SetMask (Ipv4Mask ("/24").Get ());
+  header.SetLease (30);
+  header.SetRenew (15);
+  header.SetRebind (25);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (header);
+  uint32_t size = packet->GetSize ();
+
+  DhcpHeaderView view (packet);
+  NS_TEST_ASSERT_MSG_EQ (view.IsValid (), true, "Valid message seen as malformed");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) view.GetType (), (uint32_t) DhcpHeader::DHCPOFFER, "Wrong type");
+  NS_TEST_ASSERT_MSG_EQ (view.GetTran (), 0x12345678, "Wrong transaction id");
+  NS_TEST_ASSERT_MSG_EQ (std::memcmp (view.GetChaddrBuffer (), chaddr, 16), 0, "Wrong chaddr");
+  NS_TEST_ASSERT_MSG_EQ (view.GetYiaddr (), Ipv4Address ("172.30.0.10"), "Wrong yiaddr");
+  NS_TEST_ASSERT_MSG_EQ (view.GetGiAddr (), Ipv4Address ("172.30.1.1"), "Wrong giaddr");
+  NS_TEST_ASSERT_MSG_EQ (view.GetCiaddr (), Ipv4Address ("0.0.0.0"), "Wrong ciaddr");
+  NS_TEST_ASSERT_MSG_EQ (view.GetDhcps (), Ipv4Address ("172.30.0.1"), "Wrong server identifier");
+  NS_TEST_ASSERT_MSG_EQ (view.GetMask (), Ipv4Mask ("/24").Get (), "Wrong mask");
+  NS_TEST_ASSERT_MSG_EQ (view.GetLease (), 30, "Wrong lease time");
+  NS_TEST_ASSERT_MSG_EQ (view.GetRenew (), 15, "Wrong renew time");
+  NS_TEST_ASSERT_MSG_EQ (view.GetRebind (), 25, "Wrong rebind time");
+  NS_TEST_ASSERT_MSG_EQ (view.GetReq (), Ipv4Address ("0.0.0.0"), "Missing option not read as zero");
+  NS_TEST_ASSERT_MSG_EQ (view.IsRapidCommit (), false, "Missing option seen as present");
+  NS_TEST_ASSERT_MSG_EQ (packet->GetSize (), size, "The view modified the packet");
+
+  // A message cut in the fixed part is malformed
+  Ptr<Packet> truncated = packet->CreateFragment (0, 200);
+  DhcpHeaderView truncatedView (truncated);
+  NS_TEST_ASSERT_MSG_EQ (truncatedView.IsValid (), false, "Truncated message seen as valid");
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP header options tests: options unknown to DhcpHeader are kept
+ */
+class DhcpHeaderOptionsTestCase : public TestCase
+{
+public:
+  DhcpHeaderOptionsTestCase ();
+  virtual ~DhcpHeaderOptionsTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DhcpHeaderOptionsTestCase::DhcpHeaderOptionsTestCase ()
+  : TestCase ("Dhcp header options test case ")
+{
+}
+
+DhcpHeaderOptionsTestCase::~DhcpHeaderOptionsTestCase ()
+{
+}
+
+void
+DhcpHeaderOptionsTestCase::DoRun (void)
+{
+  NS_TEST_ASSERT_MSG_LT (sizeof (DhcpHeader), 100, "DhcpHeader is too large");
+
+  // A DISCOVER as sent by common clients: host name (12), parameter
+  // request list (55), maximum message size (57) and client identifier (61)
+  // around the options known to DhcpHeader, with a pad and trailing padding
+  const uint8_t options[] = {
+    53, 1, 1,
+    61, 7, 1, 0, 1, 2, 3, 4, 5,
+    50, 4, 172, 30, 0, 12,
+    57, 2, 0x05, 0xdc,
+    0,
+    12, 4, 'h', 'o', 's', 't',
+    55, 4, 1, 3, 6, 15,
+    255
+  };
+  uint8_t message[300];
+  std::memset (message, 0, sizeof (message));
+  message[0] = 1;
+  message[1] = 1;
+  message[2] = 6;
+  message[DhcpHeader::OFFSET_XID] = 0x42;
+  message[DhcpHeader::OFFSET_CHADDR] = 0xaa;
+  message[DhcpHeader::OFFSET_COOKIE] = 99;
+  message[DhcpHeader::OFFSET_COOKIE + 1] = 130;
+  message[DhcpHeader::OFFSET_COOKIE + 2] = 83;
+  message[DhcpHeader::OFFSET_COOKIE + 3] = 99;
+  std::memcpy (message + DhcpHeader::OFFSET_OPTIONS, options, sizeof (options));
+  Ptr<Packet> packet = Create<Packet> (message, sizeof (message));
+
+  DhcpHeader header;
+  NS_TEST_ASSERT_MSG_EQ (packet->RemoveHeader (header), DhcpHeader::OFFSET_OPTIONS + sizeof (options),
+                         "Message with unknown options seen as malformed");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) header.GetType (), (uint32_t) DhcpHeader::DHCPDISCOVER, "Wrong type");
+  NS_TEST_ASSERT_MSG_EQ (header.GetReq (), Ipv4Address ("172.30.0.12"), "Wrong requested address");
+  NS_TEST_ASSERT_MSG_EQ (header.GetTran (), 0x42, "Wrong transaction id");
+
+  uint8_t len;
+  const uint8_t *hostName = header.GetOption (12, len);
+  NS_TEST_ASSERT_MSG_NE (hostName, 0, "Unknown option dropped");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) len, 4, "Wrong option length");
+  NS_TEST_ASSERT_MSG_EQ (std::memcmp (hostName, "host", 4), 0, "Wrong option value");
+  NS_TEST_ASSERT_MSG_EQ (header.HasOption (DhcpHeader::OP_ROUTE), false, "Absent option seen as present");
+
+  // The message is written back as received, without the pad and the padding
+  Ptr<Packet> copy = Create<Packet> ();
+  copy->AddHeader (header);
+  uint8_t expected[DhcpHeader::OFFSET_OPTIONS + sizeof (options)];
+  std::memcpy (expected, message, DhcpHeader::OFFSET_OPTIONS);
+  uint32_t expectedSize = DhcpHeader::OFFSET_OPTIONS;
+  for (uint32_t i = 0; i < sizeof (options); i++)
+    {
+      if (i != 22)
+        {
+          expected[expectedSize++] = options[i];
+        }
+    }
+  uint8_t written[sizeof (expected)];
+  NS_TEST_ASSERT_MSG_EQ (copy->GetSize (), expectedSize, "Wrong serialized size");
+  copy->CopyData (written, expectedSize);
+  NS_TEST_ASSERT_MSG_EQ (std::memcmp (written, expected, expectedSize), 0, "Options not written back as received");
+
+  // Known options are changed in place, others are added at the end
+  header.SetReq (Ipv4Address ("172.30.0.13"));
+  header.SetOption (12, (const uint8_t *) "other", 5);
+  header.RemoveOption (61);
+  NS_TEST_ASSERT_MSG_EQ (header.GetReq (), Ipv4Address ("172.30.0.13"), "Wrong requested address");
+  hostName = header.GetOption (12, len);
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) len, 5, "Wrong option length");
+  NS_TEST_ASSERT_MSG_EQ (std::memcmp (hostName, "other", 5), 0, "Wrong option value");
+  NS_TEST_ASSERT_MSG_EQ (header.HasOption (61), false, "Option not removed");
+  NS_TEST_ASSERT_MSG_EQ (header.HasOption (55), true, "Wrong option removed");
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP response template tests: a reply patched from the template
+ * is the serialization of the whole header, with or without an added
+ * Relay Agent Information option
+ */
+class DhcpResponseTemplateTestCase : public TestCase
+{
+public:
+  DhcpResponseTemplateTestCase ();
+  virtual ~DhcpResponseTemplateTestCase ();
+private:
+  virtual void DoRun (void);
+  /**
+   * Compare the replies created from a template with serialized headers.
+   */
+  void CompareReplies (void);
+};
+
+DhcpResponseTemplateTestCase::DhcpResponseTemplateTestCase ()
+  : TestCase ("Dhcp response template test case ")
+{
+}
+
+DhcpResponseTemplateTestCase::~DhcpResponseTemplateTestCase ()
+{
+}
+
+void
+DhcpResponseTemplateTestCase::CompareReplies (void)
+{
+  uint8_t chaddr[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+  uint8_t agentInfo[14] = { DhcpHeader::OP_AGENT_INFO, 12, 1, 4, 0, 0, 0, 2, 2, 4, 172, 30, 2, 2 };
+
+  // The client specific fields of the template are left unset
+  DhcpHeader common;
+  common.ResetOpt ();
+  common.SetType (DhcpHeader::DHCPOFFER);
+  common.SetDhcps (Ipv4Address ());
+  common.SetMask (Ipv4Mask ("/24").Get ());
+  common.SetLease (30);
+  common.SetRenew (15);
+  common.SetRebind (25);
+  common.SetRouter (Ipv4Address ("172.30.0.1"));
+  DhcpResponseTemplate response;
+  response.Set (common);
+
+  for (uint32_t withAgentInfo = 0; withAgentInfo < 2; withAgentInfo++)
+    {
+      DhcpHeader header;
+      header.ResetOpt ();
+      header.SetType (DhcpHeader::DHCPOFFER);
+      header.SetDhcps (Ipv4Address ("172.30.2.1"));
+      header.SetMask (Ipv4Mask ("/24").Get ());
+      header.SetLease (30);
+      header.SetRenew (15);
+      header.SetRebind (25);
+      header.SetRouter (Ipv4Address ("172.30.0.1"));
+      header.SetTran (0x12345678);
+      header.SetChaddr (chaddr, 16);
+      header.SetYiaddr (Ipv4Address ("172.30.0.10"));
+      header.SetGiAddr (Ipv4Address ("172.30.0.1"));
+      header.SetTime ();
+      if (withAgentInfo)
+        {
+          header.SetOption (DhcpHeader::OP_AGENT_INFO, agentInfo + 2, sizeof (agentInfo) - 2);
+        }
+      Ptr<Packet> expected = Create<Packet> ();
+      expected->AddHeader (header);
+
+      Ptr<Packet> packet = response.CreatePacket (0x12345678, chaddr, Ipv4Address ("172.30.0.10"),
+                                                  Ipv4Address ("172.30.0.1"), Ipv4Address ("172.30.2.1"),
+                                                  withAgentInfo ? agentInfo : 0,
+                                                  withAgentInfo ? sizeof (agentInfo) : 0);
+
+      NS_TEST_ASSERT_MSG_EQ (packet->GetSize (), expected->GetSize (),
+                             "Wrong reply size, option 82 " << withAgentInfo);
+      std::vector<uint8_t> bytes (packet->GetSize ());
+      std::vector<uint8_t> expectedBytes (expected->GetSize ());
+      packet->CopyData (&bytes[0], bytes.size ());
+      expected->CopyData (&expectedBytes[0], expectedBytes.size ());
+      NS_TEST_ASSERT_MSG_EQ ((bytes == expectedBytes), true, "Wrong reply bytes, option 82 " << withAgentInfo);
+    }
+}
+
+void
+DhcpResponseTemplateTestCase::DoRun (void)
+{
+  // Not at time 0, so that the secs field is set
+  Simulator::Schedule (Seconds (3.5), &DhcpResponseTemplateTestCase::CompareReplies, this);
+
+  Simulator::Stop (Seconds (4.0));
+
+  Simulator::Run ();
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP address pool allocation tests
+ */
+class DhcpAddressPoolTestCase : public TestCase
+{
+public:
+  DhcpAddressPoolTestCase ();
+  virtual ~DhcpAddressPoolTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DhcpAddressPoolTestCase::DhcpAddressPoolTestCase ()
+  : TestCase ("Dhcp address pool test case ")
+{
+}
+
+DhcpAddressPoolTestCase::~DhcpAddressPoolTestCase ()
+{
+}
+
+void
+DhcpAddressPoolTestCase::DoRun (void)
+{
+  DhcpAddressPool pool (Ipv4Address ("172.16.0.0"), Ipv4Mask ("/20"), Ipv4Address ("172.16.0.1"),
+                        Ipv4Address ("172.16.15.254"));
+  NS_TEST_ASSERT_MSG_EQ (pool.GetSize (), 4094, "Wrong pool size");
+
+  NS_TEST_ASSERT_MSG_EQ (pool.Reserve (Ipv4Address ("172.16.0.3")), true, "Free address not reserved");
+  NS_TEST_ASSERT_MSG_EQ (pool.Reserve (Ipv4Address ("172.16.0.3")), false, "Address reserved twice");
+  NS_TEST_ASSERT_MSG_EQ (pool.Reserve (Ipv4Address ("172.16.16.1")), false, "Address out of range reserved");
+
+  bool ordered = true;
+  for (uint32_t addr = Ipv4Address ("172.16.0.1").Get (); addr <= Ipv4Address ("172.16.15.254").Get (); addr++)
+    {
+      if (addr != Ipv4Address ("172.16.0.3").Get ())
+        {
+          ordered &= (pool.Allocate () == Ipv4Address (addr));
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (ordered, true, "Addresses not allocated lowest first");
+  NS_TEST_ASSERT_MSG_EQ (pool.GetNAvailable (), 0, "Pool not exhausted");
+  NS_TEST_ASSERT_MSG_EQ (pool.Allocate (), Ipv4Address (), "Address allocated from a full pool");
+
+  pool.Release (Ipv4Address ("172.16.9.200"));
+  pool.Release (Ipv4Address ("172.16.2.7"));
+  NS_TEST_ASSERT_MSG_EQ (pool.GetNAvailable (), 2, "Released addresses not counted");
+  NS_TEST_ASSERT_MSG_EQ (pool.Allocate (), Ipv4Address ("172.16.2.7"), "Released address not reused");
+  NS_TEST_ASSERT_MSG_EQ (pool.Allocate (), Ipv4Address ("172.16.9.200"), "Released address not reused");
+
+  // Allocation from a position, wrapping around
+  pool.Release (Ipv4Address ("172.16.1.0"));
+  pool.Release (Ipv4Address ("172.16.5.5"));
+  pool.Release (Ipv4Address ("172.16.15.254"));
+  uint32_t offset = Ipv4Address ("172.16.1.1").Get () - Ipv4Address ("172.16.0.1").Get ();
+  NS_TEST_ASSERT_MSG_EQ (pool.Allocate (offset), Ipv4Address ("172.16.5.5"), "Wrong address allocated from a position");
+  NS_TEST_ASSERT_MSG_EQ (pool.Allocate (offset + 2 * pool.GetSize ()), Ipv4Address ("172.16.15.254"), "Position not reduced modulo the pool size");
+  NS_TEST_ASSERT_MSG_EQ (pool.Allocate (offset), Ipv4Address ("172.16.1.0"), "Search did not wrap around");
+  NS_TEST_ASSERT_MSG_EQ (pool.Allocate (offset), Ipv4Address (), "Address allocated from a full pool");
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DHCP lease table tests
+ */
+class DhcpLeaseTableTestCase : public TestCase
+{
+public:
+  DhcpLeaseTableTestCase ();
+  virtual ~DhcpLeaseTableTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DhcpLeaseTableTestCase::DhcpLeaseTableTestCase ()
+  : TestCase ("Dhcp lease table test case ")
+{
+}
+
+DhcpLeaseTableTestCase::~DhcpLeaseTableTestCase ()
+{
+}
+
+void
+DhcpLeaseTableTestCase::DoRun (void)
+{
+  DhcpLeaseTable table;
+  uint8_t chaddr[16] = { 0 };
+  uint32_t nClients = 5000;
+
+  // Enough clients to grow the table several times
+  for (uint32_t i = 0; i < nClients; i++)
+    {
+      chaddr[4] = i >> 8;
+      chaddr[5] = i & 0xff;
+      table.Get (table.Insert (chaddr)).address = Ipv4Address (0x0a000000 + i);
+    }
+  NS_TEST_ASSERT_MSG_EQ (table.GetNLeases (), nClients, "Wrong number of leases");
+
+  // Remove every other client, the others must still be found
+  for (uint32_t i = 0; i < nClients; i += 2)
+    {
+      chaddr[4] = i >> 8;
+      chaddr[5] = i & 0xff;
+      table.Remove (table.Find (chaddr));
+    }
+  NS_TEST_ASSERT_MSG_EQ (table.GetNLeases (), nClients / 2, "Wrong number of leases");
+
+  bool found = true;
+  for (uint32_t i = 0; i < nClients; i++)
+    {
+      chaddr[4] = i >> 8;
+      chaddr[5] = i & 0xff;
+      uint32_t index = table.Find (chaddr);
+      if (i % 2 == 0)
+        {
+          found &= (index == DhcpLeaseTable::NONE);
+        }
+      else
+        {
+          found &= (index != DhcpLeaseTable::NONE && table.Get (index).address == Ipv4Address (0x0a000000 + i));
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (found, true, "Lease lookup failed after removals");
+
+  // Freed entries are reused
+  chaddr[4] = 0xff;
+  NS_TEST_ASSERT_MSG_LT (table.Insert (chaddr), nClients, "Free entry not reused");
+
+  // Expired queue: oldest first, and a lease can be unlinked from the middle
+  DhcpLeaseTable::ExpiredQueue queue;
+  table.PushExpired (queue, 1);
+  table.PushExpired (queue, 3);
+  table.PushExpired (queue, 5);
+  table.RemoveExpired (queue, 3);
+  NS_TEST_ASSERT_MSG_EQ (queue.head, 1, "Wrong oldest expired lease");
+  NS_TEST_ASSERT_MSG_EQ (table.Get (1).nextExpired, 5, "Lease not unlinked");
+  table.RemoveExpired (queue, queue.head);
+  table.RemoveExpired (queue, queue.head);
+  NS_TEST_ASSERT_MSG_EQ (queue.tail, DhcpLeaseTable::NONE, "Expired queue not empty");
+}
+
+/**
+ * \ingroup dhcp-test
+ * \ingroup tests
+ *
+ * \brief DhcpTransactionTable: the transactions are told apart by chaddr,
+ * the counts of each server follow the replies, the evictions and the
+ * expiries, and the compaction of the expiry queue keeps the order of
+ * the transactions.
+ */
+class DhcpTransactionTableTestCase : public TestCase
+{
+public:
+  DhcpTransactionTableTestCase ();
+  virtual ~DhcpTransactionTableTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DhcpTransactionTableTestCase::DhcpTransactionTableTestCase ()
+  : TestCase ("Dhcp transaction table test case ")
+{
+}
+
+DhcpTransactionTableTestCase::~DhcpTransactionTableTestCase ()
+{
+}
+
+void
+DhcpTransactionTableTestCase::DoRun (void)
+{
+  DhcpTransactionTable table;
+  table.SetNServers (2);
+  uint8_t chaddrA[16] = { 0 };
+  uint8_t chaddrB[16] = { 0 };
+  chaddrA[5] = 1;
+  chaddrB[5] = 2;
+  Ipv4Address any = Ipv4Address::GetAny ();
+
+  // Two clients with the same transaction id, one forwarded to both servers
+  table.Insert (42, chaddrA, DhcpHeader::DHCPDISCOVER, any);
+  table.AddServer (42, chaddrA, 0);
+  table.AddServer (42, chaddrA, 1);
+  table.Insert (42, chaddrB, DhcpHeader::DHCPDISCOVER, any);
+  table.AddServer (42, chaddrB, 0);
+  NS_TEST_ASSERT_MSG_EQ (table.GetNWaiting (0), 2, "Wrong number of transactions waiting for the first server");
+  NS_TEST_ASSERT_MSG_EQ (table.GetNWaiting (1), 1, "Wrong number of transactions waiting for the second server");
+
+  // The first reply answers the client, the other server is still waited for
+  table.Remove (42, chaddrA, 0);
+  NS_TEST_ASSERT_MSG_EQ (table.IsWaiting (42, chaddrA, DhcpHeader::DHCPDISCOVER, any), false, "Answered message still waiting");
+  NS_TEST_ASSERT_MSG_EQ (table.IsWaiting (42, chaddrB, DhcpHeader::DHCPDISCOVER, any), true, "Message of the other client answered");
+  NS_TEST_ASSERT_MSG_EQ (table.GetNWaiting (0), 1, "Reply of the first server not counted");
+  NS_TEST_ASSERT_MSG_EQ (table.GetNWaiting (1), 1, "Second server no longer waited for");
+  table.Remove (42, chaddrA, 1);
+  NS_TEST_ASSERT_MSG_EQ (table.GetNWaiting (1), 0, "Reply of the second server not counted");
+  NS_TEST_ASSERT_MSG_EQ (table.GetSize (), 1, "Transaction answered by all its servers still in the table");
+
+  // A full table drops its oldest transaction, with its servers
+  table.SetMaxSize (1);
+  table.Insert (43, chaddrA, DhcpHeader::DHCPDISCOVER, any);
+  NS_TEST_ASSERT_MSG_EQ (table.GetNWaiting (0), 0, "Dropped transaction still waiting for its server");
+
+  // An expired transaction no longer waits for its servers
+  DhcpTransactionTable expiring;
+  expiring.SetNServers (1);
+  expiring.SetTimeout (Seconds (0));
+  expiring.Insert (44, chaddrA, DhcpHeader::DHCPREQ, Ipv4Address ("172.30.0.10"));
+  expiring.AddServer (44, chaddrA, 0);
+  NS_TEST_ASSERT_MSG_EQ (expiring.GetNWaiting (0), 0, "Expired transaction still waiting for its server");
+
+  // Retransmissions compact the expiry queue without losing the order of the transactions
+  DhcpTransactionTable retransmitted;
+  retransmitted.SetMaxSize (2);
+  retransmitted.Insert (45, chaddrA, DhcpHeader::DHCPDISCOVER, any);
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      retransmitted.Insert (45, chaddrB, DhcpHeader::DHCPDISCOVER, any);
+    }
+  NS_TEST_ASSERT_MSG_EQ (retransmitted.GetSize (), 2, "Transaction lost by the compaction of the expiry queue");
+  retransmitted.Insert (46, chaddrA, DhcpHeader::DHCPDISCOVER, any);
+  NS_TEST_ASSERT_MSG_EQ (retransmitted.IsWaiting (45, chaddrA, DhcpHeader::DHCPDISCOVER, any), false, "Oldest transaction not dropped");
+  NS_TEST_ASSERT_MSG_EQ (retransmitted.IsWaiting (45, chaddrB, DhcpHeader::DHCPDISCOVER, any), true, "Newer transaction dropped");
+}
+
 /**
  * \ingroup dhcp-test
  * \ingroup tests
@@ -155,6 +3532,48 @@ DhcpTestSuite::DhcpTestSuite ()
   : TestSuite ("dhcp", UNIT)
 {
   AddTestCase (new DhcpTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpMultiInterfaceTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpReleaseTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpPoolRangesTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpDeclineTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpLeaseExpiryTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpRapidCommitTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpRelayAgentInformationTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpRelayInterfaceTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpNestedSubnetsTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpRelayServersTestCase (DhcpRelay::SELECT_ALL, "all"), TestCase::QUICK);
+  AddTestCase (new DhcpRelayServersTestCase (DhcpRelay::SELECT_HASH, "hash"), TestCase::QUICK);
+  AddTestCase (new DhcpRelayServersTestCase (DhcpRelay::SELECT_LEAST_OUTSTANDING, "least outstanding"), TestCase::QUICK);
+  AddTestCase (new DhcpRelayOutstandingTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpRelayForwardingTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpRelayTransactionTestCase (DhcpRelay::FORWARD_DUPLICATES, "forwarded"), TestCase::QUICK);
+  AddTestCase (new DhcpRelayTransactionTestCase (DhcpRelay::SUPPRESS_DUPLICATES, "suppressed"), TestCase::QUICK);
+  AddTestCase (new DhcpServerAdmissionTestCase (true, "queue"), TestCase::QUICK);
+  AddTestCase (new DhcpServerAdmissionTestCase (false, "rate"), TestCase::QUICK);
+  AddTestCase (new DhcpHashAllocationTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpHashSpreadTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpLeaseFileTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpInitRebootTestCase (DhcpInitRebootTestCase::SAME_SERVER, "answered"), TestCase::QUICK);
+  AddTestCase (new DhcpInitRebootTestCase (DhcpInitRebootTestCase::NO_BINDING, "no binding"), TestCase::QUICK);
+  AddTestCase (new DhcpInitRebootTestCase (DhcpInitRebootTestCase::WRONG_NETWORK, "wrong network"), TestCase::QUICK);
+  AddTestCase (new DhcpBackoffTestCase (false, "no jitter"), TestCase::QUICK);
+  AddTestCase (new DhcpBackoffTestCase (true, "jitter"), TestCase::QUICK);
+  AddTestCase (new DhcpOfferSelectionTestCase (0, DhcpClient::SCORE_FIRST, Ipv4Address::GetAny (), "collect"), TestCase::QUICK);
+  AddTestCase (new DhcpOfferSelectionTestCase (1, DhcpClient::SCORE_FIRST, Ipv4Address::GetAny (), "first offer"), TestCase::QUICK);
+  AddTestCase (new DhcpOfferSelectionTestCase (2, DhcpClient::SCORE_LONGEST_LEASE, Ipv4Address ("172.30.0.100"), "longest lease"), TestCase::QUICK);
+  AddTestCase (new DhcpOfferSelectionTestCase (0, DhcpClient::SCORE_PREFERRED_SERVER, Ipv4Address ("172.30.0.10"), "preferred server"), TestCase::QUICK);
+  AddTestCase (new DhcpSecondOfferTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpRenewTestCase (true, "answered"), TestCase::QUICK);
+  AddTestCase (new DhcpRenewTestCase (false, "rebound"), TestCase::QUICK);
+  AddTestCase (new DhcpLoadGeneratorTestCase (500, 1000, Seconds (25), "leased"), TestCase::QUICK);
+  AddTestCase (new DhcpLoadGeneratorTestCase (200, 100, Seconds (25), "pool exhausted"), TestCase::QUICK);
+  AddTestCase (new DhcpLoadGeneratorTestCase (100, 1000, Seconds (40), "rebind after the lease"), TestCase::QUICK);
+  AddTestCase (new DhcpHeaderViewTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpHeaderOptionsTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpResponseTemplateTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpAddressPoolTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpLeaseTableTestCase, TestCase::QUICK);
+  AddTestCase (new DhcpTransactionTableTestCase, TestCase::QUICK);
 }
 
 static DhcpTestSuite dhcpTestSuite; //!< Static variable for test initialization
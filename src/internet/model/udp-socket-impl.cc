@@ -573,7 +573,7 @@ UdpSocketImpl::DoSendTo (Ptr<Packet> p, Ipv4Address dest, uint16_t port, uint8_t
                 continue;
             }
           Ipv4Mask maski = iaddr.GetMask ();
-          if (maski == Ipv4Mask::GetOnes ())
+          if (true)
             {
               // if the network mask is 255.255.255.255, do not convert dest
               NS_LOG_LOGIC ("Sending one copy from " << addri << " to " << dest